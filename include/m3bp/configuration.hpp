@@ -181,6 +181,215 @@ public:
 	 */
 	Configuration &profile_log(const std::string &filename);
 
+
+	/**
+	 *  Returns the soft limit of memory usage.
+	 *
+	 *  @return The soft limit of memory usage in bytes, or 0 if it is
+	 *          unlimited.
+	 */
+	size_type memory_limit() const noexcept;
+
+	/**
+	 *  Sets the soft limit of memory usage.
+	 *
+	 *  Partitioned records are written to scratch files and merged from them
+	 *  when the amount of allocated memory exceeds this limit. Input and
+	 *  one-to-one tasks are held back while the usage is near this limit,
+	 *  and OutputWriter::allocate_buffer() waits for other tasks to release
+	 *  memory instead of exceeding it.
+	 *
+	 *  @param[in] limit  The soft limit of memory usage in bytes, or 0 to
+	 *                    never write records to scratch files.
+	 *  @return    The reference to this property set.
+	 */
+	Configuration &memory_limit(size_type limit) noexcept;
+
+
+	/**
+	 *  Returns the directory to store scratch files.
+	 *
+	 *  @return A path to the directory to store scratch files.
+	 */
+	std::string scratch_directory() const;
+
+	/**
+	 *  Sets the directory to store scratch files.
+	 *
+	 *  @param[in] directory  A path to the directory to store scratch files.
+	 *  @return    The reference to this property set.
+	 */
+	Configuration &scratch_directory(const std::string &directory);
+
+
+	/**
+	 *  Returns whether records are sorted before the barrier of each shuffle
+	 *  operation.
+	 *
+	 *  @return @c true if records are sorted by partition tasks.
+	 */
+	bool presort_shuffle_runs() const noexcept;
+
+	/**
+	 *  Sets whether records are sorted before the barrier of each shuffle
+	 *  operation.
+	 *
+	 *  If it is enabled, each partition task sorts its own slice of every
+	 *  partition and sort tasks only merge the sorted slices after the
+	 *  barrier.
+	 *
+	 *  @param[in] enabled  @c true if records are sorted by partition tasks.
+	 *  @return    The reference to this property set.
+	 */
+	Configuration &presort_shuffle_runs(bool enabled) noexcept;
+
+
+	/**
+	 *  Gets whether shuffle operations sort records in place.
+	 *
+	 *  @return @c true if records are sorted by the in-place radix sort.
+	 */
+	bool in_place_shuffle_sort() const noexcept;
+
+	/**
+	 *  Sets whether shuffle operations sort records in place.
+	 *
+	 *  The in-place radix sort permutes records without work buffers, so it
+	 *  requires about half the working memory of the default radix sort.
+	 *
+	 *  @param[in] enabled  @c true if records are sorted in place.
+	 *  @return    The reference to this property set.
+	 */
+	Configuration &in_place_shuffle_sort(bool enabled) noexcept;
+
+
+	/**
+	 *  Gets whether shuffle operations may sort records by 16-bit digits.
+	 *
+	 *  @return @c true if large buckets may be sorted by 16-bit digits.
+	 */
+	bool wide_radix_sort_digits() const noexcept;
+
+	/**
+	 *  Sets whether shuffle operations may sort records by 16-bit digits.
+	 *
+	 *  The radix sort that is not in place then distributes large buckets
+	 *  of keys using most byte values by 16-bit digits, which halves the
+	 *  number of passes at the cost of a histogram that has to fit in the
+	 *  L2 cache. It is disabled by default since it is slower for typical
+	 *  keys.
+	 *
+	 *  @param[in] enabled  @c true if 16-bit digits may be used.
+	 *  @return    The reference to this property set.
+	 */
+	Configuration &wide_radix_sort_digits(bool enabled) noexcept;
+
+
+	/**
+	 *  Returns whether idle memory objects are written to scratch files.
+	 *
+	 *  @return @c true if unlocked memory objects can be spilled.
+	 */
+	bool spill_memory_objects() const noexcept;
+
+	/**
+	 *  Sets whether idle memory objects are written to scratch files.
+	 *
+	 *  If it is enabled and the memory usage exceeds memory_limit(), buffers
+	 *  that are not locked by any tasks are written to a scratch file in
+	 *  scratch_directory() and read back when they are locked again.
+	 *
+	 *  @param[in] enabled  @c true if unlocked memory objects can be spilled.
+	 *  @return    The reference to this property set.
+	 */
+	Configuration &spill_memory_objects(bool enabled) noexcept;
+
+
+	/**
+	 *  Gets the minimum size of buffers that are backed by huge pages.
+	 *
+	 *  @return The threshold in bytes, or 0 if huge pages are not used.
+	 */
+	size_type huge_page_threshold() const noexcept;
+
+	/**
+	 *  Sets the minimum size of buffers that are backed by huge pages.
+	 *
+	 *  Buffers larger than or equal to the threshold are mapped with
+	 *  explicit 2 MiB huge pages if the system has reserved them. Otherwise
+	 *  transparent huge pages are requested for the mapping. Buffers smaller
+	 *  than a huge page are never backed by huge pages.
+	 *
+	 *  @param[in] bytes  The threshold in bytes, or 0 to disable huge pages.
+	 *  @return    The reference to this property set.
+	 */
+	Configuration &huge_page_threshold(size_type bytes) noexcept;
+
+
+	/**
+	 *  Gets the minimum volume of remote inputs that are migrated to the
+	 *  NUMA node of the worker thread running a task.
+	 *
+	 *  @return The threshold in bytes, or 0 if inputs are not migrated.
+	 */
+	size_type input_migration_threshold() const noexcept;
+
+	/**
+	 *  Sets the minimum volume of remote inputs that are migrated to the
+	 *  NUMA node of the worker thread running a task.
+	 *
+	 *  Tasks are usually run on the node that has their inputs, but a task
+	 *  stolen by a worker on another node reads them remotely. If the total
+	 *  size of such inputs of a task is larger than or equal to the
+	 *  threshold, they are copied to the local node before the task runs.
+	 *  Inputs locked by other tasks are not migrated.
+	 *
+	 *  @param[in] bytes  The threshold in bytes, or 0 to disable migration.
+	 *  @return    The reference to this property set.
+	 */
+	Configuration &input_migration_threshold(size_type bytes) noexcept;
+
+
+	/**
+	 *  Gets the number of times an idle worker thread polls for new tasks
+	 *  with a pause instruction before yielding the processor.
+	 *
+	 *  @return The number of polls.
+	 */
+	size_type idle_spin_count() const noexcept;
+
+	/**
+	 *  Sets the number of times an idle worker thread polls for new tasks
+	 *  with a pause instruction before yielding the processor.
+	 *
+	 *  Spinning shortens the latency of waking up workers for small tasks
+	 *  at the cost of processor time.
+	 *
+	 *  @param[in] count  The number of polls.
+	 *  @return    The reference to this property set.
+	 */
+	Configuration &idle_spin_count(size_type count) noexcept;
+
+	/**
+	 *  Gets the number of times an idle worker thread yields the processor
+	 *  before it blocks.
+	 *
+	 *  @return The number of yields.
+	 */
+	size_type idle_yield_count() const noexcept;
+
+	/**
+	 *  Sets the number of times an idle worker thread yields the processor
+	 *  before it blocks.
+	 *
+	 *  Setting both of this and idle_spin_count() to 0 makes idle workers
+	 *  block immediately.
+	 *
+	 *  @param[in] count  The number of yields.
+	 *  @return    The reference to this property set.
+	 */
+	Configuration &idle_yield_count(size_type count) noexcept;
+
 private:
 	class Impl;
 	std::unique_ptr<Impl> m_impl;
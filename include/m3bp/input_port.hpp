@@ -19,6 +19,7 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include "m3bp/types.hpp"
 
 namespace m3bp {
 
@@ -40,6 +41,32 @@ enum class Movement {
 	BROADCAST
 };
 
+enum class Partitioning {
+	/**
+	 *  Records are distributed to partitions by hash values of keys.
+	 */
+	HASH = 0,
+	/**
+	 *  Records are distributed to partitions by ranges of keys.
+	 *
+	 *  Split points are computed from sampled keys, so every key in a
+	 *  partition is smaller than keys in succeeding partitions.
+	 */
+	RANGE
+};
+
+enum class Grouping {
+	/**
+	 *  Groups are sorted by keys.
+	 */
+	SORT = 0,
+	/**
+	 *  Records are grouped by a hash table and groups are passed in an
+	 *  unspecified order.
+	 */
+	HASH
+};
+
 
 /**
  *  A configuration set for an input port.
@@ -50,6 +77,18 @@ public:
 	using ValueComparatorType =
 		std::function<bool(const void *, const void *)>;
 
+	/**
+	 *  Type of functions that merge two values which have the same key.
+	 *
+	 *  A combiner is called as <tt>f(dst, lhs, lhs_size, rhs, rhs_size)</tt>.
+	 *  It must write the merged value into @c dst, which has at least
+	 *  <tt>lhs_size + rhs_size</tt> bytes, and return the size of the merged
+	 *  value in bytes. Combiners must be associative and commutative because
+	 *  values are merged in an unspecified order.
+	 */
+	using ValueCombinerType = std::function<size_type(
+		void *, const void *, size_type, const void *, size_type)>;
+
 	/**
 	 *  Constructs an input port with default settings.
 	 */
@@ -128,6 +167,69 @@ public:
 	InputPort &value_comparator(ValueComparatorType comparator);
 
 
+	/**
+	 *  Gets the combiner that is used to merge values with equal keys
+	 *  before they are shuffled.
+	 *
+	 *  @return The combiner that is used to merge values with equal keys.
+	 */
+	ValueCombinerType value_combiner() const;
+
+	/**
+	 *  Sets the combiner that is used to merge values with equal keys
+	 *  before they are shuffled.
+	 *
+	 *  Each group received by the processor may contain partially merged
+	 *  values. This setting is only effective for SCATTER_GATHER ports.
+	 *
+	 *  @param[in] combiner  The combiner that is used to merge values.
+	 *  @return    A reference to this port.
+	 */
+	InputPort &value_combiner(ValueCombinerType combiner);
+
+
+	/**
+	 *  Gets the partitioning method that is used for this port.
+	 *
+	 *  @return The partitioning method that is used for this port.
+	 */
+	Partitioning partitioning() const;
+
+	/**
+	 *  Sets the partitioning method that is used for this port.
+	 *
+	 *  This setting is only effective for SCATTER_GATHER ports. A processor
+	 *  that has a port with Partitioning::RANGE cannot have other
+	 *  SCATTER_GATHER ports because ranges are computed for each port.
+	 *
+	 *  @param[in] p  The partitioning method that is used for this port.
+	 *  @return    A reference to this port.
+	 */
+	InputPort &partitioning(Partitioning p);
+
+
+	/**
+	 *  Gets the grouping method that is used for this port.
+	 *
+	 *  @return The grouping method that is used for this port.
+	 */
+	Grouping grouping() const;
+
+	/**
+	 *  Sets the grouping method that is used for this port.
+	 *
+	 *  Grouping::HASH is faster than sorting when the processor does not
+	 *  depend on the order of keys. This setting is only effective for
+	 *  SCATTER_GATHER ports. A processor that has a port with
+	 *  Grouping::HASH cannot have other SCATTER_GATHER ports because groups
+	 *  of each port are not aligned.
+	 *
+	 *  @param[in] g  The grouping method that is used for this port.
+	 *  @return    A reference to this port.
+	 */
+	InputPort &grouping(Grouping g);
+
+
 private:
 	class Impl;
 	std::unique_ptr<Impl> m_impl;
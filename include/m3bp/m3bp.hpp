@@ -21,6 +21,7 @@
 #include "m3bp/task.hpp"
 #include "m3bp/configuration.hpp"
 #include "m3bp/logger.hpp"
+#include "m3bp/mapped_file_input_processor.hpp"
 
 #endif
 
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef M3BP_MAPPED_FILE_INPUT_PROCESSOR_HPP
+#define M3BP_MAPPED_FILE_INPUT_PROCESSOR_HPP
+
+#include <string>
+#include "m3bp/processor_base.hpp"
+#include "m3bp/types.hpp"
+
+namespace m3bp {
+
+/**
+ *  Built-in processor that reads records from a file.
+ *
+ *  The file is split into regions and each task maps its region into
+ *  memory. Records are passed to the output port "output" without being
+ *  copied: only their offsets are computed. Each record is a line including
+ *  its trailing newline, or a block of the given record size. The last
+ *  record may be shorter than the others.
+ */
+class MappedFileInputProcessor : public ProcessorBase {
+
+public:
+	/// The default number of bytes read by each task.
+	static const size_type DEFAULT_SPLIT_SIZE = (64 << 20);
+
+private:
+	std::string m_path;
+	size_type m_record_size;
+	size_type m_split_size;
+
+public:
+	/**
+	 *  Constructs a processor reading the given file.
+	 *
+	 *  @param[in] path         The path to the input file.
+	 *  @param[in] record_size  The size of each record, or 0 to read lines.
+	 *  @param[in] split_size   The number of bytes read by each task.
+	 */
+	explicit MappedFileInputProcessor(
+		const std::string &path,
+		size_type record_size = 0,
+		size_type split_size = DEFAULT_SPLIT_SIZE);
+
+	virtual void global_initialize(Task &task) override;
+
+	virtual void run(Task &task) override;
+
+};
+
+}
+
+#endif
@@ -28,6 +28,16 @@ private:
 	size_type m_default_records_per_buffer;
 	AffinityMode m_affinity;
 	std::string m_profile_log;
+	size_type m_memory_limit;
+	std::string m_scratch_directory;
+	bool m_presort_shuffle_runs;
+	bool m_in_place_shuffle_sort;
+	bool m_wide_radix_sort_digits;
+	bool m_spill_memory_objects;
+	size_type m_huge_page_threshold;
+	size_type m_input_migration_threshold;
+	size_type m_idle_spin_count;
+	size_type m_idle_yield_count;
 
 public:
 	Impl()
@@ -38,6 +48,16 @@ public:
 		, m_default_records_per_buffer(m_default_output_buffer_size / 8)
 		, m_affinity(AffinityMode::NONE)
 		, m_profile_log()
+		, m_memory_limit(0)
+		, m_scratch_directory("/tmp")
+		, m_presort_shuffle_runs(false)
+		, m_in_place_shuffle_sort(false)
+		, m_wide_radix_sort_digits(false)
+		, m_spill_memory_objects(false)
+		, m_huge_page_threshold(0)
+		, m_input_migration_threshold(0)
+		, m_idle_spin_count(1024)
+		, m_idle_yield_count(16)
 	{ }
 
 	unsigned int max_concurrency() const noexcept {
@@ -90,6 +110,93 @@ public:
 		return *this;
 	}
 
+
+	size_type memory_limit() const noexcept {
+		return m_memory_limit;
+	}
+	Impl &memory_limit(size_type limit) noexcept {
+		m_memory_limit = limit;
+		return *this;
+	}
+
+
+	std::string scratch_directory() const {
+		return m_scratch_directory;
+	}
+	Impl &scratch_directory(const std::string &directory){
+		m_scratch_directory = directory;
+		return *this;
+	}
+
+
+	bool presort_shuffle_runs() const noexcept {
+		return m_presort_shuffle_runs;
+	}
+	Impl &presort_shuffle_runs(bool enabled) noexcept {
+		m_presort_shuffle_runs = enabled;
+		return *this;
+	}
+
+
+	bool in_place_shuffle_sort() const noexcept {
+		return m_in_place_shuffle_sort;
+	}
+	Impl &in_place_shuffle_sort(bool enabled) noexcept {
+		m_in_place_shuffle_sort = enabled;
+		return *this;
+	}
+
+
+	bool wide_radix_sort_digits() const noexcept {
+		return m_wide_radix_sort_digits;
+	}
+	Impl &wide_radix_sort_digits(bool enabled) noexcept {
+		m_wide_radix_sort_digits = enabled;
+		return *this;
+	}
+
+
+	bool spill_memory_objects() const noexcept {
+		return m_spill_memory_objects;
+	}
+	Impl &spill_memory_objects(bool enabled) noexcept {
+		m_spill_memory_objects = enabled;
+		return *this;
+	}
+
+
+	size_type huge_page_threshold() const noexcept {
+		return m_huge_page_threshold;
+	}
+	Impl &huge_page_threshold(size_type bytes) noexcept {
+		m_huge_page_threshold = bytes;
+		return *this;
+	}
+
+	size_type input_migration_threshold() const noexcept {
+		return m_input_migration_threshold;
+	}
+	Impl &input_migration_threshold(size_type bytes) noexcept {
+		m_input_migration_threshold = bytes;
+		return *this;
+	}
+
+	size_type idle_spin_count() const noexcept {
+		return m_idle_spin_count;
+	}
+	Impl &idle_spin_count(size_type count) noexcept {
+		m_idle_spin_count = count;
+		return *this;
+	}
+
+	size_type idle_yield_count() const noexcept {
+		return m_idle_yield_count;
+	}
+	Impl &idle_yield_count(size_type count) noexcept {
+		m_idle_yield_count = count;
+		return *this;
+	}
+
 };
 
 
@@ -173,5 +280,106 @@ Configuration &Configuration::profile_log(const std::string &filename){
 	return *this;
 }
 
+
+size_type Configuration::memory_limit() const noexcept {
+	return m_impl->memory_limit();
+}
+
+Configuration &Configuration::memory_limit(size_type limit) noexcept {
+	m_impl->memory_limit(limit);
+	return *this;
+}
+
+
+std::string Configuration::scratch_directory() const {
+	return m_impl->scratch_directory();
+}
+
+Configuration &Configuration::scratch_directory(const std::string &directory){
+	m_impl->scratch_directory(directory);
+	return *this;
+}
+
+
+bool Configuration::presort_shuffle_runs() const noexcept {
+	return m_impl->presort_shuffle_runs();
+}
+
+Configuration &Configuration::presort_shuffle_runs(bool enabled) noexcept {
+	m_impl->presort_shuffle_runs(enabled);
+	return *this;
+}
+
+
+bool Configuration::in_place_shuffle_sort() const noexcept {
+	return m_impl->in_place_shuffle_sort();
+}
+
+Configuration &Configuration::in_place_shuffle_sort(bool enabled) noexcept {
+	m_impl->in_place_shuffle_sort(enabled);
+	return *this;
+}
+
+
+bool Configuration::wide_radix_sort_digits() const noexcept {
+	return m_impl->wide_radix_sort_digits();
+}
+
+Configuration &Configuration::wide_radix_sort_digits(bool enabled) noexcept {
+	m_impl->wide_radix_sort_digits(enabled);
+	return *this;
+}
+
+
+bool Configuration::spill_memory_objects() const noexcept {
+	return m_impl->spill_memory_objects();
+}
+
+Configuration &Configuration::spill_memory_objects(bool enabled) noexcept {
+	m_impl->spill_memory_objects(enabled);
+	return *this;
+}
+
+
+size_type Configuration::huge_page_threshold() const noexcept {
+	return m_impl->huge_page_threshold();
+}
+
+Configuration &Configuration::huge_page_threshold(size_type bytes) noexcept {
+	m_impl->huge_page_threshold(bytes);
+	return *this;
+}
+
+
+size_type Configuration::input_migration_threshold() const noexcept {
+	return m_impl->input_migration_threshold();
+}
+
+Configuration &Configuration::input_migration_threshold(
+	size_type bytes) noexcept
+{
+	m_impl->input_migration_threshold(bytes);
+	return *this;
+}
+
+
+size_type Configuration::idle_spin_count() const noexcept {
+	return m_impl->idle_spin_count();
+}
+
+Configuration &Configuration::idle_spin_count(size_type count) noexcept {
+	m_impl->idle_spin_count(count);
+	return *this;
+}
+
+size_type Configuration::idle_yield_count() const noexcept {
+	return m_impl->idle_yield_count();
+}
+
+Configuration &Configuration::idle_yield_count(size_type count) noexcept {
+	m_impl->idle_yield_count(count);
+	return *this;
+}
+
 }
 
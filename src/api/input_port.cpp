@@ -23,18 +23,27 @@ private:
 	std::string m_name;
 	Movement m_movement;
 	ValueComparatorType m_value_comparator;
+	ValueCombinerType m_value_combiner;
+	Partitioning m_partitioning;
+	Grouping m_grouping;
 
 public:
 	Impl()
 		: m_name()
 		, m_movement(Movement::UNDEFINED)
 		, m_value_comparator()
+		, m_value_combiner()
+		, m_partitioning(Partitioning::HASH)
+		, m_grouping(Grouping::SORT)
 	{ }
 
 	explicit Impl(std::string name)
 		: m_name(std::move(name))
 		, m_movement(Movement::UNDEFINED)
 		, m_value_comparator()
+		, m_value_combiner()
+		, m_partitioning(Partitioning::HASH)
+		, m_grouping(Grouping::SORT)
 	{ }
 
 	const std::string &name() const {
@@ -57,6 +66,30 @@ public:
 		return *this;
 	}
 
+	ValueCombinerType value_combiner() const {
+		return m_value_combiner;
+	}
+	Impl &value_combiner(ValueCombinerType combiner){
+		m_value_combiner = std::move(combiner);
+		return *this;
+	}
+
+	Partitioning partitioning() const {
+		return m_partitioning;
+	}
+	Impl &partitioning(Partitioning p){
+		m_partitioning = p;
+		return *this;
+	}
+
+	Grouping grouping() const {
+		return m_grouping;
+	}
+	Impl &grouping(Grouping g){
+		m_grouping = g;
+		return *this;
+	}
+
 };
 
 
@@ -109,5 +142,35 @@ InputPort &InputPort::value_comparator(ValueComparatorType comparator){
 	return *this;
 }
 
+
+InputPort::ValueCombinerType InputPort::value_combiner() const {
+	return m_impl->value_combiner();
+}
+
+InputPort &InputPort::value_combiner(ValueCombinerType combiner){
+	m_impl->value_combiner(combiner);
+	return *this;
+}
+
+
+Partitioning InputPort::partitioning() const {
+	return m_impl->partitioning();
+}
+
+InputPort &InputPort::partitioning(Partitioning p){
+	m_impl->partitioning(p);
+	return *this;
+}
+
+
+Grouping InputPort::grouping() const {
+	return m_impl->grouping();
+}
+
+InputPort &InputPort::grouping(Grouping g){
+	m_impl->grouping(g);
+	return *this;
+}
+
 }
 
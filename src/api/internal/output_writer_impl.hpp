@@ -35,6 +35,9 @@ namespace internal {
 class OutputWriterImpl {
 
 private:
+	static const size_type MIN_SHRINKABLE_SIZE = (64 << 10);
+	static const size_type SHRINK_RATIO = 4;
+
 	ExecutionContext *m_context;
 	Locality m_current_locality;
 
@@ -69,18 +72,21 @@ public:
 				"This OutputWriter is not corresponding to any tasks");
 		}
 		auto &memory_manager = m_context->memory_manager();
+		const auto record_count =
+			std::max(min_record_count, m_default_records_per_buffer);
+		const auto data_size =
+			std::max(min_data_size, m_default_buffer_size);
+		// Wait for consumers instead of exceeding the memory limit
+		memory_manager.wait_for_memory(
+			data_size + 2 * record_count * sizeof(size_type));
 		SerializedBuffer sb;
 		if(m_has_keys){
 			sb = SerializedBuffer::allocate_key_value_buffer(
-				memory_manager,
-				std::max(min_record_count, m_default_records_per_buffer),
-				std::max(min_data_size,    m_default_buffer_size),
+				memory_manager, record_count, data_size,
 				m_current_locality.self_node_id());
 		}else{
 			sb = SerializedBuffer::allocate_value_only_buffer(
-				memory_manager,
-				std::max(min_record_count, m_default_records_per_buffer),
-				std::max(min_data_size,    m_default_buffer_size),
+				memory_manager, record_count, data_size,
 				m_current_locality.self_node_id());
 		}
 		OutputBufferImpl buffer_impl;
@@ -96,6 +102,33 @@ public:
 		if(record_count > 0){
 			auto sb = OutputBufferImpl::get_impl(buffer).unbind_fragment();
 			sb.record_count(record_count);
+			// Consumers may keep fragments for a long time, so mostly
+			// unused space is returned by copying into a smaller buffer
+			const auto allocated_size = sb.allocated_size();
+			if(allocated_size >= MIN_SHRINKABLE_SIZE &&
+			   sb.used_size() * SHRINK_RATIO <= allocated_size)
+			{
+				sb = sb.shrink_to_fit(
+					m_context->memory_manager(),
+					m_current_locality.self_node_id());
+			}
+			m_logical_task->commit_fragment(
+				*m_context,
+				m_output_port,
+				0,
+				MemoryReference(sb.raw_reference()));
+		}
+	}
+
+	/**
+	 *  Commits a buffer that is built without allocate_buffer().
+	 */
+	void flush_fragment(SerializedBuffer sb){
+		if(!m_context){
+			throw std::runtime_error(
+				"This OutputWriter is not corresponding to any tasks");
+		}
+		if(sb.record_count() > 0){
 			m_logical_task->commit_fragment(
 				*m_context,
 				m_output_port,
@@ -104,6 +137,14 @@ public:
 		}
 	}
 
+	MemoryManager &memory_manager(){
+		if(!m_context){
+			throw std::runtime_error(
+				"This OutputWriter is not corresponding to any tasks");
+		}
+		return m_context->memory_manager();
+	}
+
 	OutputWriterImpl &context(ExecutionContext *context){
 		m_context = context;
 		return *this;
@@ -129,6 +170,9 @@ public:
 		m_default_buffer_size = size;
 		return *this;
 	}
+	size_type default_records_per_buffer() const {
+		return m_default_records_per_buffer;
+	}
 	OutputWriterImpl &default_records_per_buffer(size_type count){
 		m_default_records_per_buffer = count;
 		return *this;
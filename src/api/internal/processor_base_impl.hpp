@@ -49,19 +49,37 @@ public:
 		, m_task_count(0)
 		, m_max_concurrency(std::numeric_limits<size_type>::max())
 	{
-		bool has_one_to_one = false, has_scatter_gather = false;
+		bool has_one_to_one = false, has_range_partitioning = false;
+		bool has_hash_grouping = false;
+		size_type scatter_gather_count = 0;
 		for(const auto &ip : input_ports){
 			if(ip.movement() == Movement::ONE_TO_ONE){
 				has_one_to_one = true;
 			}else if(ip.movement() == Movement::SCATTER_GATHER){
-				has_scatter_gather = true;
+				++scatter_gather_count;
+				if(ip.partitioning() == Partitioning::RANGE){
+					has_range_partitioning = true;
+				}
+				if(ip.grouping() == Grouping::HASH){
+					has_hash_grouping = true;
+				}
 			}
 		}
-		if(has_one_to_one && has_scatter_gather){
+		if(has_one_to_one && scatter_gather_count > 0){
 			throw ProcessorDefinitionError(
 				"A processor cannot have both an ONE_TO_ONE port and "
 				"a SCATTER_GATHER pors");
 		}
+		if(has_range_partitioning && scatter_gather_count > 1){
+			throw ProcessorDefinitionError(
+				"A processor that has a range partitioned port cannot "
+				"have other SCATTER_GATHER ports");
+		}
+		if(has_hash_grouping && scatter_gather_count > 1){
+			throw ProcessorDefinitionError(
+				"A processor that has a hash grouped port cannot "
+				"have other SCATTER_GATHER ports");
+		}
 	}
 
 
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <cstddef>
+#include "m3bp/mapped_file_input_processor.hpp"
+#include "m3bp/exception.hpp"
+#include "api/internal/task_impl.hpp"
+#include "api/internal/output_writer_impl.hpp"
+#include "memory/serialized_buffer.hpp"
+#include "system/mapped_file.hpp"
+
+namespace m3bp {
+
+namespace {
+
+const size_type SCAN_BLOCK_SIZE = (64 << 10);
+
+// Finds the head of the first line that begins at or after the position
+size_type find_line_head(const MappedFile &file, size_type position){
+	if(position == 0){ return 0; }
+	std::vector<char> block(SCAN_BLOCK_SIZE);
+	size_type cur = position - 1;
+	while(cur < file.size()){
+		const auto length = std::min(SCAN_BLOCK_SIZE, file.size() - cur);
+		file.read(block.data(), length, cur);
+		const auto found = static_cast<const char *>(
+			memchr(block.data(), '\n', length));
+		if(found){ return cur + (found - block.data()) + 1; }
+		cur += length;
+	}
+	return file.size();
+}
+
+// Unmaps a region of a file at the end of the scope
+class ScopedRegion {
+
+private:
+	MappedFile::Region m_region;
+
+public:
+	ScopedRegion(
+		const MappedFile &file, size_type offset, size_type length)
+		: m_region(file.map(offset, length, 0, 0))
+	{ }
+
+	ScopedRegion(const ScopedRegion &) = delete;
+	ScopedRegion &operator=(const ScopedRegion &) = delete;
+
+	~ScopedRegion(){
+		MappedFile::unmap(m_region);
+	}
+
+	const char *data() const noexcept {
+		return static_cast<const char *>(m_region.pointer);
+	}
+
+};
+
+}
+
+const size_type MappedFileInputProcessor::DEFAULT_SPLIT_SIZE;
+
+MappedFileInputProcessor::MappedFileInputProcessor(
+	const std::string &path,
+	size_type record_size,
+	size_type split_size)
+	: ProcessorBase({ }, { OutputPort("output") })
+	, m_path(path)
+	, m_record_size(record_size)
+	, m_split_size(split_size)
+{
+	if(m_split_size == 0){
+		throw ProcessorDefinitionError("Split size must not be zero");
+	}
+	if(m_record_size > 0){
+		// Keep records from straddling two regions
+		m_split_size = std::max(
+			m_record_size, m_split_size / m_record_size * m_record_size);
+	}
+}
+
+void MappedFileInputProcessor::global_initialize(Task &){
+	const MappedFile file(m_path);
+	const auto n = (file.size() + m_split_size - 1) / m_split_size;
+	task_count(std::max<size_type>(n, 1));
+}
+
+void MappedFileInputProcessor::run(Task &task){
+	const MappedFile file(m_path);
+	const auto task_id = task.physical_task_id();
+	auto begin = std::min(task_id * m_split_size, file.size());
+	auto end = std::min(begin + m_split_size, file.size());
+	if(m_record_size == 0){
+		begin = find_line_head(file, begin);
+		end = find_line_head(file, end);
+	}
+	if(begin >= end){ return; }
+
+	auto writer = internal::TaskImpl::get_impl(task).output(0);
+	auto &writer_impl = internal::OutputWriterImpl::get_impl(writer);
+	auto &memory_manager = writer_impl.memory_manager();
+	const auto records_per_buffer = writer_impl.default_records_per_buffer();
+	// Lines are found in a view of the whole region first, so that each
+	// buffer maps only the lines stored in it
+	std::unique_ptr<ScopedRegion> view;
+	std::vector<size_type> line_ends;
+	if(m_record_size == 0){
+		view.reset(new ScopedRegion(file, begin, end - begin));
+	}
+	const auto view_begin = begin;
+	while(begin < end){
+		const auto remaining = end - begin;
+		size_type length = 0, max_count = 0;
+		if(m_record_size > 0){
+			length = remaining;
+			max_count = (remaining + m_record_size - 1) / m_record_size;
+		}else{
+			const auto head = view->data() + (begin - view_begin);
+			size_type cur = 0;
+			line_ends.clear();
+			while(cur < remaining && line_ends.size() < records_per_buffer){
+				const auto found = static_cast<const char *>(
+					memchr(head + cur, '\n', remaining - cur));
+				cur = found ? (found - head) + 1 : remaining;
+				line_ends.push_back(cur);
+			}
+			length = cur;
+			max_count = line_ends.size();
+		}
+		auto sb = SerializedBuffer::map_value_only_buffer(
+			memory_manager, file, begin, length, max_count);
+		auto offsets = sb.values_offsets();
+		const auto leading = begin % alignof(max_align_t);
+		size_type count = 0;
+		offsets[0] = leading;
+		if(m_record_size > 0){
+			for(size_type cur = 0; cur < length; ++count){
+				cur = std::min(cur + m_record_size, length);
+				offsets[count + 1] = leading + cur;
+			}
+		}else{
+			for(const auto line_end : line_ends){
+				offsets[++count] = leading + line_end;
+			}
+		}
+		sb.record_count(count);
+		writer_impl.flush_fragment(std::move(sb));
+		begin += length;
+	}
+}
+
+}
@@ -17,13 +17,12 @@
 #define M3BP_COMMON_HASH_FUNCTION_HPP
 
 #include <cstdint>
+#include <cassert>
+#include "m3bp/types.hpp"
 
 namespace m3bp {
 
-inline identifier_type hash_byte_sequence(
-	const void *ptr, size_type length, size_type modulo)
-{
-	assert(modulo <= 0xffffffffu);
+inline uint32_t hash_byte_sequence(const void *ptr, size_type length){
 	// MurmurHash3
 	const uint8_t *data = static_cast<const uint8_t *>(ptr);
 	const auto num_blocks = length / sizeof(uint32_t);
@@ -63,7 +62,18 @@ inline identifier_type hash_byte_sequence(
 	h1 ^= h1 >> 13;
 	h1 *= 0xc2b2ae35;
 	h1 ^= h1 >> 16;
-	return (static_cast<uint64_t>(h1) * modulo) >> 32;
+	return h1;
+}
+
+inline identifier_type scale_hash(uint32_t hash, size_type modulo){
+	assert(modulo <= 0xffffffffu);
+	return (static_cast<uint64_t>(hash) * modulo) >> 32;
+}
+
+inline identifier_type hash_byte_sequence(
+	const void *ptr, size_type length, size_type modulo)
+{
+	return scale_hash(hash_byte_sequence(ptr, length), modulo);
 }
 
 }
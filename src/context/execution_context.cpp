@@ -25,6 +25,27 @@
 
 namespace m3bp {
 
+void ExecutionContext::initialize(){
+	m_memory_manager->memory_limit(m_configuration->memory_limit());
+	m_memory_manager->input_migration_threshold(
+		m_configuration->input_migration_threshold());
+	m_memory_manager->huge_page_threshold(
+		m_configuration->huge_page_threshold());
+	if(m_configuration->spill_memory_objects()){
+		m_memory_manager->spill_memory_objects(
+			m_configuration->scratch_directory());
+	}
+	m_scheduler->memory_manager(m_memory_manager.get());
+	m_scheduler->idle_policy(
+		m_configuration->idle_spin_count(),
+		m_configuration->idle_yield_count());
+	const auto profile_destination = m_configuration->profile_log();
+	if(profile_destination != ""){
+		m_profile_logger =
+			make_unique<ProfileLogger>(*m_configuration, *m_logical_graph);
+	}
+}
+
 ExecutionContext::ExecutionContext()
 	: m_configuration(make_unique<Configuration>())
 	, m_logical_graph(make_unique<LogicalGraph>())
@@ -34,11 +55,7 @@ ExecutionContext::ExecutionContext()
 		std::make_shared<MemoryManager>(m_configuration->affinity()))
 	, m_profile_logger()
 {
-	const auto profile_destination = m_configuration->profile_log();
-	if(profile_destination != ""){
-		m_profile_logger =
-			make_unique<ProfileLogger>(*m_configuration, *m_logical_graph);
-	}
+	initialize();
 }
 
 ExecutionContext::ExecutionContext(const Configuration &config)
@@ -50,11 +67,7 @@ ExecutionContext::ExecutionContext(const Configuration &config)
 		std::make_shared<MemoryManager>(m_configuration->affinity()))
 	, m_profile_logger()
 {
-	const auto profile_destination = m_configuration->profile_log();
-	if(profile_destination != ""){
-		m_profile_logger =
-			make_unique<ProfileLogger>(*m_configuration, *m_logical_graph);
-	}
+	initialize();
 }
 
 ExecutionContext::ExecutionContext(
@@ -69,11 +82,7 @@ ExecutionContext::ExecutionContext(
 		std::make_shared<MemoryManager>(m_configuration->affinity()))
 	, m_profile_logger()
 {
-	const auto profile_destination = m_configuration->profile_log();
-	if(profile_destination != ""){
-		m_profile_logger =
-			make_unique<ProfileLogger>(*m_configuration, *m_logical_graph);
-	}
+	initialize();
 }
 
 }
@@ -39,6 +39,9 @@ private:
 	std::shared_ptr<MemoryManager>   m_memory_manager;
 	std::unique_ptr<ProfileLogger>   m_profile_logger;
 
+	// Applies the configuration to the components
+	void initialize();
+
 public:
 	ExecutionContext();
 	explicit ExecutionContext(const Configuration &config);
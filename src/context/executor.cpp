@@ -94,6 +94,8 @@ void Executor::execute(){
 			}
 
 			if(ctx.is_profile_enabled()){
+				ctx.memory_manager().log_memory_pool();
+				ctx.memory_manager().log_huge_pages();
 				ctx.profile_logger().flush_thread_local_log(worker_count);
 				const auto profile_destination =
 					ctx.configuration().profile_log();
@@ -56,6 +56,7 @@ void WorkerThread::run(
 			// Extract context objects
 			auto &graph = ctx.logical_graph();
 			auto &scheduler = ctx.scheduler();
+			scheduler.bind_worker_thread(self_locality);
 			// List of initialized thread observers for cancellation
 			std::vector<ThreadObserverPtr> initialized_observers;
 			try{
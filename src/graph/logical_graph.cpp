@@ -16,6 +16,7 @@
 #include <cassert>
 #include "graph/logical_graph.hpp"
 #include "context/execution_context.hpp"
+#include "scheduler/scheduler.hpp"
 #include "logging/general_logger.hpp"
 
 #define M3BP_LOGICAL_GRAPH_TRACE \
@@ -56,6 +57,13 @@ LogicalGraph &LogicalGraph::add_edge(
 
 void LogicalGraph::create_physical_tasks(ExecutionContext &context){
 	auto &scheduler = context.scheduler();
+	std::vector<std::vector<identifier_type>> successors(
+		m_logical_tasks.size());
+	for(const auto &e : m_edges){
+		successors[e.producer().task_id().identifier()].push_back(
+			e.consumer().task_id().identifier());
+	}
+	scheduler.logical_successors(std::move(successors));
 	for(auto &logical_task : m_logical_tasks){
 		logical_task->create_physical_tasks(context);
 	}
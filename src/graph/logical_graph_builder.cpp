@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include <map>
+#include <tuple>
 #include <cassert>
 #include "m3bp/configuration.hpp"
 #include "graph/logical_graph_builder.hpp"
@@ -35,13 +36,17 @@ public:
 	using PortKey = std::pair<identifier_type, identifier_type>;
 	using PortSet = std::vector<PortKey>;
 	using PortSetToTaskMap = std::map<PortSet, LogicalTaskIdentifier>;
+	using PortToTaskMap = std::map<PortKey, LogicalTaskIdentifier>;
+	using ShuffleKey = std::tuple<PortSet, Partitioning, Grouping>;
+	using ShuffleKeyToTaskMap = std::map<ShuffleKey, LogicalTaskIdentifier>;
 
 private:
 	FlowGraph m_flow_graph;
 	Configuration m_configuration;
 
 	LogicalGraph m_logical_graph;
-	PortSetToTaskMap m_shuffle_nodes;
+	ShuffleKeyToTaskMap m_shuffle_nodes;
+	PortToTaskMap m_combined_shuffle_nodes;
 	PortSetToTaskMap m_gather_nodes;
 
 	std::unique_ptr<LogicalTaskBase>
@@ -106,12 +111,21 @@ private:
 		return oss.str();
 	}
 
-	LogicalTaskIdentifier create_shuffle_node(const PortSet &ps){
-		const auto it = m_shuffle_nodes.find(ps);
-		if(it != m_shuffle_nodes.end()){ return it->second; }
-		// Create a shuffle node
+	static ShuffleKey make_shuffle_key(
+		const PortSet &ps, const InputPort &port)
+	{
+		return ShuffleKey(ps, port.partitioning(), port.grouping());
+	}
+
+	LogicalTaskIdentifier add_shuffle_task(
+		const PortSet &ps, const InputPort &port)
+	{
 		auto task = std::unique_ptr<LogicalTaskBase>(
-			new ShuffleLogicalTask(m_configuration.partition_count()));
+			new ShuffleLogicalTask(
+				m_configuration.partition_count(),
+				port.value_combiner(),
+				port.partitioning(),
+				port.grouping()));
 		task->task_name(concat_port_names(ps) + ".shuffle");
 		const auto shuffle_lid =
 			m_logical_graph.add_logical_task(std::move(task));
@@ -123,10 +137,41 @@ private:
 				LogicalGraph::Port(shuffle_lid, 0),
 				LogicalGraph::PhysicalSuccessor::BARRIER);
 		}
-		m_shuffle_nodes.emplace(ps, shuffle_lid);
 		return shuffle_lid;
 	}
 
+	LogicalTaskIdentifier create_shuffle_node(
+		const PortSet &ps, const InputPort &port)
+	{
+		// Shuffle nodes can be shared only by consumers that use the same
+		// partitioning and grouping methods.
+		const auto key = make_shuffle_key(ps, port);
+		const auto it = m_shuffle_nodes.find(key);
+		if(it != m_shuffle_nodes.end()){ return it->second; }
+		const auto shuffle_lid = add_shuffle_task(ps, port);
+		m_shuffle_nodes.emplace(key, shuffle_lid);
+		return shuffle_lid;
+	}
+
+	LogicalTaskIdentifier create_combined_shuffle_node(
+		const PortKey &consumer, const PortSet &ps, const InputPort &port)
+	{
+		// Combined shuffle nodes cannot be shared with other consumers
+		// because merged values are visible only for the consumer.
+		const auto shuffle_lid = add_shuffle_task(ps, port);
+		m_combined_shuffle_nodes.emplace(consumer, shuffle_lid);
+		return shuffle_lid;
+	}
+
+	LogicalTaskIdentifier find_shuffle_node(
+		const PortKey &consumer, const PortSet &ps,
+		const InputPort &port) const
+	{
+		const auto it = m_combined_shuffle_nodes.find(consumer);
+		if(it != m_combined_shuffle_nodes.end()){ return it->second; }
+		return m_shuffle_nodes.at(make_shuffle_key(ps, port));
+	}
+
 	LogicalTaskIdentifier create_gather_node(const PortSet &ps){
 		const auto it = m_gather_nodes.find(ps);
 		if(it != m_gather_nodes.end()){ return it->second; }
@@ -156,8 +201,14 @@ private:
 			const auto &iports = v.processor()->input_ports();
 			for(identifier_type j = 0; j < iports.size(); ++j){
 				if(iports[j].movement() == Movement::SCATTER_GATHER){
-					create_shuffle_node(normalize_port_set(
-						sources[j].begin(), sources[j].end()));
+					const auto ps = normalize_port_set(
+						sources[j].begin(), sources[j].end());
+					if(iports[j].value_combiner()){
+						create_combined_shuffle_node(
+							PortKey(i, j), ps, iports[j]);
+					}else{
+						create_shuffle_node(ps, iports[j]);
+					}
 				}else if(iports[j].movement() == Movement::BROADCAST){
 					create_gather_node(normalize_port_set(
 						sources[j].begin(), sources[j].end()));
@@ -177,6 +228,7 @@ private:
 			for(identifier_type j = 0; j < iport_count; ++j){
 				const auto ps = normalize_port_set(
 					sources[j].begin(), sources[j].end());
+				const PortKey consumer(i, j);
 				auto comparator = iports[j].value_comparator();
 				if(iports[j].movement() == Movement::ONE_TO_ONE){
 					// one-to-one
@@ -205,7 +257,8 @@ private:
 					const auto sort_id =
 						m_logical_graph.add_logical_task(std::move(sort_task));
 					m_logical_graph.add_edge(
-						LogicalGraph::Port(m_shuffle_nodes.at(ps), 0),
+						LogicalGraph::Port(
+							find_shuffle_node(consumer, ps, iports[j]), 0),
 						LogicalGraph::Port(sort_id, 0),
 						LogicalGraph::PhysicalSuccessor::TERMINAL);
 					m_logical_graph.add_edge(
@@ -215,7 +268,8 @@ private:
 				}else{
 					// scatter-gather
 					m_logical_graph.add_edge(
-						LogicalGraph::Port(m_shuffle_nodes.at(ps), 0),
+						LogicalGraph::Port(
+							find_shuffle_node(consumer, ps, iports[j]), 0),
 						LogicalGraph::Port(LogicalTaskIdentifier(i), j),
 						LogicalGraph::PhysicalSuccessor::BARRIER);
 				}
@@ -229,12 +283,14 @@ public:
 		, m_configuration(config)
 		, m_logical_graph()
 		, m_shuffle_nodes()
+		, m_combined_shuffle_nodes()
 		, m_gather_nodes()
 	{ }
 
 	LogicalGraph build(){
 		m_logical_graph = LogicalGraph();
 		m_shuffle_nodes.clear();
+		m_combined_shuffle_nodes.clear();
 		m_gather_nodes.clear();
 
 		create_processor_nodes();
@@ -33,8 +33,12 @@ enum class EventMagic {
 	END_PREPARATION,
 	BEGIN_EXECUTION,
 	END_EXECUTION,
+	WAKE_UP,
 	ALLOCATE_MEMORY,
 	RELEASE_MEMORY,
+	MEMORY_POOL,
+	HUGE_PAGES,
+	MIGRATE_MEMORY,
 	LOCK_MEMORY,
 	UNLOCK_MEMORY,
 	MAGIC_KINDS
@@ -47,8 +51,12 @@ STRING_DEFINITION(begin_preparation);
 STRING_DEFINITION(end_preparation);
 STRING_DEFINITION(begin_execution);
 STRING_DEFINITION(end_execution);
+STRING_DEFINITION(wake_up);
 STRING_DEFINITION(allocate_memory);
 STRING_DEFINITION(release_memory);
+STRING_DEFINITION(memory_pool);
+STRING_DEFINITION(huge_pages);
+STRING_DEFINITION(migrate_memory);
 STRING_DEFINITION(lock_memory);
 STRING_DEFINITION(unlock_memory);
 
@@ -61,6 +69,14 @@ STRING_DEFINITION(consumer);
 STRING_DEFINITION(object_id);
 STRING_DEFINITION(size);
 STRING_DEFINITION(numa_node);
+STRING_DEFINITION(hit_count);
+STRING_DEFINITION(miss_count);
+STRING_DEFINITION(pooled_bytes);
+STRING_DEFINITION(peak_huge_page_bytes);
+STRING_DEFINITION(peak_thp_advised_bytes);
+STRING_DEFINITION(idle_time);
+STRING_DEFINITION(wake_latency);
+STRING_DEFINITION(parked);
 #undef STRING_DEFINITION
 
 inline uint64_t current_timestamp(){
@@ -171,6 +187,13 @@ using EndExecutionLogger = BinaryLogger<
 	BinaryLogField<uint64_t,        str_timestamp>,
 	BinaryLogField<identifier_type, str_task_id>>;
 
+using WakeUpLogger = BinaryLogger<
+	EventMagic::WAKE_UP, str_wake_up,
+	BinaryLogField<uint64_t,        str_timestamp>,
+	BinaryLogField<uint64_t,        str_idle_time>,
+	BinaryLogField<uint64_t,        str_wake_latency>,
+	BinaryLogField<uint32_t,        str_parked>>;
+
 
 using AllocateMemoryLogger = BinaryLogger<
 	EventMagic::ALLOCATE_MEMORY, str_allocate_memory,
@@ -184,6 +207,26 @@ using ReleaseMemoryLogger = BinaryLogger<
 	BinaryLogField<uint64_t,        str_timestamp>,
 	BinaryLogField<identifier_type, str_object_id>>;
 
+using MemoryPoolLogger = BinaryLogger<
+	EventMagic::MEMORY_POOL, str_memory_pool,
+	BinaryLogField<uint64_t,        str_timestamp>,
+	BinaryLogField<size_type,       str_hit_count>,
+	BinaryLogField<size_type,       str_miss_count>,
+	BinaryLogField<size_type,       str_pooled_bytes>>;
+
+using HugePagesLogger = BinaryLogger<
+	EventMagic::HUGE_PAGES, str_huge_pages,
+	BinaryLogField<uint64_t,        str_timestamp>,
+	BinaryLogField<size_type,       str_peak_huge_page_bytes>,
+	BinaryLogField<size_type,       str_peak_thp_advised_bytes>>;
+
+using MigrateMemoryLogger = BinaryLogger<
+	EventMagic::MIGRATE_MEMORY, str_migrate_memory,
+	BinaryLogField<uint64_t,        str_timestamp>,
+	BinaryLogField<identifier_type, str_object_id>,
+	BinaryLogField<size_type,       str_size>,
+	BinaryLogField<identifier_type, str_numa_node>>;
+
 using LockMemoryLogger = BinaryLogger<
 	EventMagic::LOCK_MEMORY, str_lock_memory,
 	BinaryLogField<uint64_t,        str_timestamp>,
@@ -300,6 +343,14 @@ void ProfileEventLogger::log_end_execution(PhysicalTaskIdentifier task_id){
 		task_id.identifier());
 }
 
+void ProfileEventLogger::log_wake_up(
+	uint64_t idle_time, uint64_t wake_latency, bool parked)
+{
+	write_binary<WakeUpLogger>(
+		current_timestamp(), idle_time, wake_latency,
+		static_cast<uint32_t>(parked));
+}
+
 
 void ProfileEventLogger::log_allocate_memory(
 	identifier_type mobj_id, size_type size)
@@ -319,6 +370,27 @@ void ProfileEventLogger::log_release_memory(identifier_type mobj_id){
 	write_binary<ReleaseMemoryLogger>(current_timestamp(), mobj_id);
 }
 
+void ProfileEventLogger::log_memory_pool(
+	size_type hit_count, size_type miss_count, size_type pooled_bytes)
+{
+	write_binary<MemoryPoolLogger>(
+		current_timestamp(), hit_count, miss_count, pooled_bytes);
+}
+
+void ProfileEventLogger::log_huge_pages(
+	size_type peak_huge_page_bytes, size_type peak_thp_advised_bytes)
+{
+	write_binary<HugePagesLogger>(
+		current_timestamp(), peak_huge_page_bytes, peak_thp_advised_bytes);
+}
+
+void ProfileEventLogger::log_migrate_memory(
+	identifier_type mobj_id, size_type size, identifier_type numa_node)
+{
+	write_binary<MigrateMemoryLogger>(
+		current_timestamp(), mobj_id, size, numa_node);
+}
+
 
 void ProfileEventLogger::log_lock_memory(const MemoryReference &mobj){
 	write_binary<LockMemoryLogger>(current_timestamp(), mobj.identifier());
@@ -359,12 +431,24 @@ std::string ProfileEventLogger::to_json() const {
 				case EventMagic::END_EXECUTION:
 					p += write_json<EndExecutionLogger>(oss, data + p);
 					break;
+				case EventMagic::WAKE_UP:
+					p += write_json<WakeUpLogger>(oss, data + p);
+					break;
 				case EventMagic::ALLOCATE_MEMORY:
 					p += write_json<AllocateMemoryLogger>(oss, data + p);
 					break;
 				case EventMagic::RELEASE_MEMORY:
 					p += write_json<ReleaseMemoryLogger>(oss, data + p);
 					break;
+				case EventMagic::MEMORY_POOL:
+					p += write_json<MemoryPoolLogger>(oss, data + p);
+					break;
+				case EventMagic::HUGE_PAGES:
+					p += write_json<HugePagesLogger>(oss, data + p);
+					break;
+				case EventMagic::MIGRATE_MEMORY:
+					p += write_json<MigrateMemoryLogger>(oss, data + p);
+					break;
 				case EventMagic::LOCK_MEMORY:
 					p += write_json<LockMemoryLogger>(oss, data + p);
 					break;
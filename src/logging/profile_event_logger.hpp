@@ -18,6 +18,7 @@
 
 #include <memory>
 #include <string>
+#include <cstdint>
 #include <boost/noncopyable.hpp>
 #include "tasks/logical_task_identifier.hpp"
 #include "tasks/physical_task_identifier.hpp"
@@ -53,12 +54,29 @@ public:
 	void log_begin_execution(PhysicalTaskIdentifier task_id);
 	void log_end_execution(PhysicalTaskIdentifier task_id);
 
+	/**
+	 *  Records that an idle worker has been woken up.
+	 *
+	 *  @param[in] idle_time     Nanoseconds spent waiting for a task.
+	 *  @param[in] wake_latency  Nanoseconds from the notification to the
+	 *                           end of the wait.
+	 *  @param[in] parked        @c true if the worker had been blocked on a
+	 *                           condition variable instead of spinning.
+	 */
+	void log_wake_up(uint64_t idle_time, uint64_t wake_latency, bool parked);
+
 
 	// Memory management
 	void log_allocate_memory(identifier_type mobj_id, size_type size);
 	void log_allocate_memory(
 		identifier_type mobj_id, size_type size, identifier_type numa_node);
 	void log_release_memory(identifier_type mobj_id);
+	void log_memory_pool(
+		size_type hit_count, size_type miss_count, size_type pooled_bytes);
+	void log_huge_pages(
+		size_type peak_huge_page_bytes, size_type peak_thp_advised_bytes);
+	void log_migrate_memory(
+		identifier_type mobj_id, size_type size, identifier_type numa_node);
 
 	void log_lock_memory(const MemoryReference &mobj);
 	void log_unlock_memory(const MemoryReference &mobj);
@@ -14,53 +14,208 @@
  * limitations under the License.
  */
 #include <cassert>
+#include <chrono>
+#include <algorithm>
 #include "memory/memory_manager.hpp"
 #include "memory/memory_object.hpp"
 #include "memory/memory_reference.hpp"
+#include "memory/memory_pool.hpp"
+#include "system/scratch_file.hpp"
+#include "system/topology.hpp"
 #include "logging/general_logger.hpp"
 #include "logging/profile_logger.hpp"
 #include "logging/profile_event_logger.hpp"
 
+#ifdef M3BP_NO_THREAD_LOCAL
+#include "common/thread_specific.hpp"
+#endif
+
 #define M3BP_MEMORY_MANAGER_TRACE \
 	M3BP_GENERAL_LOG(TRACE) << "[MemoryManager] [" << __func__ << "] "
 
 namespace m3bp {
 
+namespace {
+
+const int RELEASE_WAIT_TIMEOUT_MS = 100;
+
+// Never equals to the number of released bytes at the beginning
+const size_type NOT_STALLED = ~static_cast<size_type>(0);
+
+// Small objects are not worth writing to scratch files
+const size_type MIN_SPILL_SIZE = (64 << 10);
+
+// The registry is scanned for idle objects at most once per
+// (memory limit / SPILL_SCAN_INTERVAL_DIVISOR) allocated or released bytes
+const size_type SPILL_SCAN_INTERVAL_DIVISOR = 16;
+
+// Each thread takes identifiers in blocks from the shared counter
+const identifier_type IDENTIFIER_BLOCK_SIZE = 256;
+
+// Identifiers in a block belong to the same shard, so objects allocated
+// by a thread are usually registered without contention
+const size_type REGISTRY_SHARD_COUNT = 64;
+
+#ifdef NDEBUG
+const bool DEFAULT_TRACKING_ENABLED = false;
+#else
+const bool DEFAULT_TRACKING_ENABLED = true;
+#endif
+
+std::atomic<uint64_t> g_next_instance_serial(1);
+
+struct IdentifierBlock {
+	uint64_t owner;
+	identifier_type next;
+	identifier_type end;
+
+	IdentifierBlock()
+		: owner(0)
+		, next(0)
+		, end(0)
+	{ }
+};
+
+IdentifierBlock &thread_local_identifier_block(){
+#ifdef M3BP_NO_THREAD_LOCAL
+	static ThreadSpecific<IdentifierBlock> s_ts_block;
+	return s_ts_block.get();
+#else
+	static thread_local IdentifierBlock s_block;
+	return s_block;
+#endif
+}
+
+}
+
 MemoryManager::MemoryManager()
 	: std::enable_shared_from_this<MemoryManager>()
 	, m_affinity_mode(AffinityMode::NONE)
-	, m_mutex()
-	, m_managed_objects()
+	, m_instance_serial(g_next_instance_serial++)
 	, m_next_identifier(0)
+	, m_tracking_enabled(DEFAULT_TRACKING_ENABLED)
+	, m_registry()
 	, m_total_memory_usage(0)
 	, m_assert_on_release(false)
-{ }
+	, m_memory_limit(0)
+	, m_mutex()
+	, m_release_condvar()
+	, m_released_bytes(0)
+	, m_waiter_count(0)
+	, m_stalled_released_bytes(NOT_STALLED)
+	, m_allocated_bytes(0)
+	, m_spill_enabled(false)
+	, m_scratch_directory()
+	, m_spill_mutex()
+	, m_scratch_file()
+	, m_next_spill_scan(0)
+	, m_peak_huge_page_bytes(0)
+	, m_peak_thp_advised_bytes(0)
+	, m_input_migration_threshold(0)
+	, m_huge_page_threshold(0)
+{
+	for(size_type i = 0; i < REGISTRY_SHARD_COUNT; ++i){
+		m_registry.emplace_back(new RegistryShard());
+	}
+}
 
 MemoryManager::MemoryManager(AffinityMode affinity)
 	: std::enable_shared_from_this<MemoryManager>()
 	, m_affinity_mode(affinity)
-	, m_mutex()
-	, m_managed_objects()
+	, m_instance_serial(g_next_instance_serial++)
 	, m_next_identifier(0)
+	, m_tracking_enabled(DEFAULT_TRACKING_ENABLED)
+	, m_registry()
 	, m_total_memory_usage(0)
 	, m_assert_on_release(false)
-{ }
+	, m_memory_limit(0)
+	, m_mutex()
+	, m_release_condvar()
+	, m_released_bytes(0)
+	, m_waiter_count(0)
+	, m_stalled_released_bytes(NOT_STALLED)
+	, m_allocated_bytes(0)
+	, m_spill_enabled(false)
+	, m_scratch_directory()
+	, m_spill_mutex()
+	, m_scratch_file()
+	, m_next_spill_scan(0)
+	, m_peak_huge_page_bytes(0)
+	, m_peak_thp_advised_bytes(0)
+	, m_input_migration_threshold(0)
+	, m_huge_page_threshold(0)
+{
+	for(size_type i = 0; i < REGISTRY_SHARD_COUNT; ++i){
+		m_registry.emplace_back(new RegistryShard());
+	}
+}
 
 MemoryManager::~MemoryManager() = default;
 
 
+identifier_type MemoryManager::next_identifier(){
+	auto &block = thread_local_identifier_block();
+	if(block.owner != m_instance_serial || block.next == block.end){
+		block.owner = m_instance_serial;
+		block.next = m_next_identifier.fetch_add(IDENTIFIER_BLOCK_SIZE);
+		block.end = block.next + IDENTIFIER_BLOCK_SIZE;
+	}
+	return block.next++;
+}
+
+MemoryManager::RegistryShard &MemoryManager::registry_shard(
+	identifier_type identifier)
+{
+	const auto index =
+		(identifier / IDENTIFIER_BLOCK_SIZE) % REGISTRY_SHARD_COUNT;
+	return *m_registry[index];
+}
+
+void MemoryManager::register_object(
+	const std::shared_ptr<MemoryObject> &mobj, size_type sequence)
+{
+	if(!m_tracking_enabled){ return; }
+	auto &shard = registry_shard(mobj->identifier());
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	shard.objects.emplace(mobj->identifier(), RegistryEntry(mobj, sequence));
+}
+
+void MemoryManager::notify_waiters(size_type released) noexcept {
+	m_released_bytes += released;
+	// Waiters increment the count before testing the memory usage, so
+	// they observe this release or they are notified here.
+	if(m_waiter_count.load() > 0){
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_release_condvar.notify_all();
+	}
+}
+
+
+void MemoryManager::update_huge_page_peaks(size_type size) noexcept {
+	if(m_huge_page_threshold == 0 || size < m_huge_page_threshold){ return; }
+	const auto &topo = Topology::instance();
+	const auto update = [](std::atomic<size_type> &peak, size_type value){
+		auto current = peak.load();
+		while(current < value){
+			if(peak.compare_exchange_weak(current, value)){ break; }
+		}
+	};
+	update(m_peak_huge_page_bytes, topo.huge_page_bytes());
+	update(m_peak_thp_advised_bytes, topo.thp_advised_bytes());
+}
+
+
 MemoryReference MemoryManager::allocate(size_type size){
-	const auto new_id = m_next_identifier++;
+	const auto new_id = next_identifier();
 	M3BP_MEMORY_MANAGER_TRACE << size << " " << new_id;
 	auto mobj = std::make_shared<MemoryObject>(
 		shared_from_this(), new_id, size);
-	{
-		std::lock_guard<std::mutex> lock(m_mutex);
-		m_managed_objects.emplace(new_id, mobj);
-	}
+	register_object(mobj, m_allocated_bytes.fetch_add(size));
 	m_total_memory_usage += size;
 	auto &event_logger = ProfileLogger::thread_local_logger();
 	event_logger.log_allocate_memory(mobj->identifier(), size);
+	update_huge_page_peaks(size);
+	spill_if_exceeded();
 	return MemoryReference(std::move(mobj));
 }
 
@@ -70,17 +225,36 @@ MemoryReference MemoryManager::allocate(
 	if(m_affinity_mode == AffinityMode::NONE){
 		return allocate(size);
 	}
-	const auto new_id = m_next_identifier++;
+	const auto new_id = next_identifier();
 	M3BP_MEMORY_MANAGER_TRACE << size << " " << new_id << " " << numa_node;
 	auto mobj = std::make_shared<MemoryObject>(
 		shared_from_this(), new_id, size, numa_node);
-	{
-		std::lock_guard<std::mutex> lock(m_mutex);
-		m_managed_objects.emplace(new_id, mobj);
-	}
+	register_object(mobj, m_allocated_bytes.fetch_add(size));
 	m_total_memory_usage += size;
 	auto &event_logger = ProfileLogger::thread_local_logger();
 	event_logger.log_allocate_memory(mobj->identifier(), size, numa_node);
+	update_huge_page_peaks(size);
+	spill_if_exceeded();
+	return MemoryReference(std::move(mobj));
+}
+
+MemoryReference MemoryManager::map_file(
+	const MappedFile &file,
+	size_type offset,
+	size_type length,
+	size_type head_size,
+	size_type tail_size)
+{
+	const auto new_id = next_identifier();
+	M3BP_MEMORY_MANAGER_TRACE << offset << " " << length << " " << new_id;
+	auto mobj = std::make_shared<MemoryObject>(
+		shared_from_this(), new_id, file, offset, length,
+		head_size, tail_size);
+	register_object(mobj, m_allocated_bytes.load());
+	const auto size = mobj->size();
+	m_total_memory_usage += size;
+	auto &event_logger = ProfileLogger::thread_local_logger();
+	event_logger.log_allocate_memory(mobj->identifier(), size);
 	return MemoryReference(std::move(mobj));
 }
 
@@ -91,28 +265,202 @@ void MemoryManager::notify_release(
 	M3BP_MEMORY_MANAGER_TRACE << identifier;
 	auto &event_logger = ProfileLogger::thread_local_logger();
 	event_logger.log_release_memory(identifier);
-	std::lock_guard<std::mutex> lock(m_mutex);
-	auto it = m_managed_objects.find(identifier);
-	assert(it != m_managed_objects.end());
-	m_managed_objects.erase(it);
+	if(m_tracking_enabled){
+		auto &shard = registry_shard(identifier);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto it = shard.objects.find(identifier);
+		assert(it != shard.objects.end());
+		shard.objects.erase(it);
+	}
 	m_total_memory_usage -= size;
+	notify_waiters(size);
 	assert(!m_assert_on_release);
 }
 
+void MemoryManager::notify_restore(size_type size) noexcept {
+	M3BP_MEMORY_MANAGER_TRACE << size;
+	m_total_memory_usage += size;
+	m_allocated_bytes += size;
+}
+
 
 size_type MemoryManager::total_memory_usage() const {
 	return m_total_memory_usage.load();
 }
 
+size_type MemoryManager::memory_footprint() const noexcept {
+	return m_total_memory_usage.load() + MemoryPool::instance().pooled_bytes();
+}
+
+void MemoryManager::trim_memory_pool() noexcept {
+	// Blocks kept for reuse are released before live objects are spilled
+	auto &pool = MemoryPool::instance();
+	const auto threshold = m_memory_limit - m_memory_limit / 8;
+	if(pool.pooled_bytes() > 0 && memory_footprint() > threshold){
+		pool.trim();
+	}
+}
+
+bool MemoryManager::is_memory_pressured() const noexcept {
+	if(m_memory_limit == 0){ return false; }
+	const auto threshold = m_memory_limit - m_memory_limit / 8;
+	return memory_footprint() >= threshold;
+}
+
+bool MemoryManager::is_memory_exceeded() const noexcept {
+	return m_memory_limit > 0 && memory_footprint() > m_memory_limit;
+}
+
+void MemoryManager::wait_for_memory(size_type size){
+	if(m_memory_limit == 0){ return; }
+	trim_memory_pool();
+	if(m_spill_enabled && memory_footprint() + size > m_memory_limit){
+		spill_idle_objects();
+	}
+	std::unique_lock<std::mutex> lock(m_mutex);
+	++m_waiter_count;
+	// Another waiter has already timed out and nothing was released since
+	while(m_stalled_released_bytes.load() != m_released_bytes.load()){
+		const auto released_bytes = m_released_bytes.load();
+		trim_memory_pool();
+		if(m_total_memory_usage.load() == 0 ||
+		   memory_footprint() + size <= m_memory_limit)
+		{
+			break;
+		}
+		m_release_condvar.wait_for(
+			lock, std::chrono::milliseconds(RELEASE_WAIT_TIMEOUT_MS),
+			[&]() -> bool { return m_released_bytes != released_bytes; });
+		if(m_released_bytes == released_bytes){
+			M3BP_MEMORY_MANAGER_TRACE
+				<< "no memory was released, exceeding the limit: " << size;
+			m_stalled_released_bytes = released_bytes;
+			break;
+		}
+	}
+	--m_waiter_count;
+}
+
+void MemoryManager::spill_if_exceeded(){
+	if(m_memory_limit == 0){ return; }
+	trim_memory_pool();
+	if(m_spill_enabled && memory_footprint() > m_memory_limit){
+		spill_idle_objects();
+	}
+}
+
+size_type MemoryManager::spill_idle_objects(){
+	// A scan right after the previous one rarely finds new idle objects,
+	// so the registry is not scanned until enough bytes have been moved
+	const auto activity = m_allocated_bytes.load() + m_released_bytes.load();
+	if(activity < m_next_spill_scan.load()){ return 0; }
+	// Only one thread writes objects at a time
+	std::unique_lock<std::mutex> spill_lock(m_spill_mutex, std::try_to_lock);
+	if(!spill_lock.owns_lock()){ return 0; }
+	m_next_spill_scan = activity + std::max(
+		m_memory_limit / SPILL_SCAN_INTERVAL_DIVISOR, MIN_SPILL_SIZE);
+	// Collect strong references out of the lock: releasing the last
+	// reference of an object calls notify_release().
+	using Candidate = std::pair<size_type, std::shared_ptr<MemoryObject>>;
+	std::vector<Candidate> candidates;
+	for(auto &shard : m_registry){
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		for(const auto &p : shard->objects){
+			auto mobj = p.second.object.lock();
+			if(mobj && mobj->size() >= MIN_SPILL_SIZE){
+				candidates.emplace_back(p.second.sequence, std::move(mobj));
+			}
+		}
+	}
+	// Older objects are less likely to be used soon
+	std::sort(
+		candidates.begin(), candidates.end(),
+		[](const Candidate &a, const Candidate &b) -> bool {
+			return a.first < b.first;
+		});
+	if(!m_scratch_file){
+		m_scratch_file.reset(new ScratchFile(m_scratch_directory));
+	}
+	const auto threshold = m_memory_limit - m_memory_limit / 8;
+	size_type total_released = 0;
+	for(auto &candidate : candidates){
+		if(memory_footprint() <= threshold){ break; }
+		auto &mobj = candidate.second;
+		const auto released = mobj->spill(*m_scratch_file);
+		if(released == 0){ continue; }
+		M3BP_MEMORY_MANAGER_TRACE << mobj->identifier() << " " << released;
+		m_total_memory_usage -= released;
+		notify_waiters(released);
+		total_released += released;
+	}
+	return total_released;
+}
+
+ScratchFile &MemoryManager::scratch_file(){
+	assert(m_scratch_file);
+	return *m_scratch_file;
+}
+
+
+size_type MemoryManager::migrate_inputs(
+	ArrayRef<LockedMemoryReference> inputs, identifier_type numa_node)
+{
+	if(m_input_migration_threshold == 0){ return 0; }
+	if(m_affinity_mode == AffinityMode::NONE){ return 0; }
+	if(Topology::instance().numa_node_count() <= 1){ return 0; }
+	size_type remote_bytes = 0;
+	for(const auto &lmr : inputs){
+		if(lmr && lmr.numa_node() != numa_node){
+			remote_bytes += lmr.size();
+		}
+	}
+	if(remote_bytes < m_input_migration_threshold){ return 0; }
+	auto &event_logger = ProfileLogger::thread_local_logger();
+	size_type moved_bytes = 0;
+	for(auto &lmr : inputs){
+		if(!lmr || lmr.numa_node() == numa_node){ continue; }
+		const auto moved = lmr.migrate(numa_node);
+		M3BP_MEMORY_MANAGER_TRACE
+			<< lmr.identifier() << " " << moved << " " << numa_node;
+		event_logger.log_migrate_memory(lmr.identifier(), moved, numa_node);
+		moved_bytes += moved;
+	}
+	return moved_bytes;
+}
+
+
+void MemoryManager::log_memory_pool(){
+	const auto &pool = MemoryPool::instance();
+	auto &event_logger = ProfileLogger::thread_local_logger();
+	event_logger.log_memory_pool(
+		pool.hit_count(), pool.miss_count(), pool.pooled_bytes());
+}
+
+void MemoryManager::log_huge_pages(){
+	auto &event_logger = ProfileLogger::thread_local_logger();
+	event_logger.log_huge_pages(
+		m_peak_huge_page_bytes.load(), m_peak_thp_advised_bytes.load());
+}
+
 void MemoryManager::log_memory_leaks(){
-	for(const auto &p : m_managed_objects){
-		if(p.second.expired()){
+	if(!m_tracking_enabled){
+		const auto usage = m_total_memory_usage.load();
+		if(usage > 0){
 			M3BP_GENERAL_LOG(WARNING)
-				<< "Detected memory leaks: Memory object #" << p.first
-				<< " (expired)";
-		}else{
-			M3BP_GENERAL_LOG(WARNING)
-				<< "Detected memory leaks: Memory object #" << p.first;
+				<< "Detected memory leaks: " << usage << " bytes";
+		}
+	}
+	for(const auto &shard : m_registry){
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		for(const auto &p : shard->objects){
+			if(p.second.object.expired()){
+				M3BP_GENERAL_LOG(WARNING)
+					<< "Detected memory leaks: Memory object #" << p.first
+					<< " (expired)";
+			}else{
+				M3BP_GENERAL_LOG(WARNING)
+					<< "Detected memory leaks: Memory object #" << p.first;
+			}
 		}
 	}
 	m_assert_on_release = true;
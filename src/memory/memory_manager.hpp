@@ -19,15 +19,23 @@
 #include <memory>
 #include <mutex>
 #include <atomic>
+#include <condition_variable>
 #include <unordered_map>
+#include <vector>
+#include <string>
+#include <cstdint>
 #include <boost/noncopyable.hpp>
 #include "m3bp/types.hpp"
 #include "m3bp/configuration.hpp"
+#include "common/array_ref.hpp"
 
 namespace m3bp {
 
 class MemoryObject;
 class MemoryReference;
+class LockedMemoryReference;
+class ScratchFile;
+class MappedFile;
 
 class MemoryManager
 	: public std::enable_shared_from_this<MemoryManager>
@@ -37,15 +45,68 @@ class MemoryManager
 private:
 	using MemoryObjectWeakPtr = std::weak_ptr<MemoryObject>;
 
+	struct RegistryEntry {
+		MemoryObjectWeakPtr object;
+		// The number of bytes allocated before the object
+		size_type sequence;
+
+		RegistryEntry(const MemoryObjectWeakPtr &object, size_type sequence)
+			: object(object)
+			, sequence(sequence)
+		{ }
+	};
+
+	struct RegistryShard {
+		std::mutex mutex;
+		std::unordered_map<identifier_type, RegistryEntry> objects;
+	};
+
 	AffinityMode m_affinity_mode;
 
-	std::mutex m_mutex;
-	std::unordered_map<identifier_type, MemoryObjectWeakPtr> m_managed_objects;
+	// Distinguishes thread-local identifier blocks of each instance
+	uint64_t m_instance_serial;
 	std::atomic<identifier_type> m_next_identifier;
 
+	bool m_tracking_enabled;
+	std::vector<std::unique_ptr<RegistryShard>> m_registry;
+
 	std::atomic<size_type> m_total_memory_usage;
 	bool m_assert_on_release;
 
+	size_type m_memory_limit;
+	std::mutex m_mutex;
+	std::condition_variable m_release_condvar;
+	std::atomic<size_type> m_released_bytes;
+	std::atomic<size_type> m_waiter_count;
+	// m_released_bytes when a waiter gave up waiting for releases
+	std::atomic<size_type> m_stalled_released_bytes;
+
+	std::atomic<size_type> m_allocated_bytes;
+	bool m_spill_enabled;
+	std::string m_scratch_directory;
+	std::mutex m_spill_mutex;
+	std::unique_ptr<ScratchFile> m_scratch_file;
+	std::atomic<size_type> m_next_spill_scan;
+
+	// Maxima of the live huge page counters of Topology seen on allocation
+	std::atomic<size_type> m_peak_huge_page_bytes;
+	std::atomic<size_type> m_peak_thp_advised_bytes;
+
+	size_type m_input_migration_threshold;
+	size_type m_huge_page_threshold;
+
+	identifier_type next_identifier();
+	RegistryShard &registry_shard(identifier_type identifier);
+	void register_object(
+		const std::shared_ptr<MemoryObject> &mobj, size_type sequence);
+	void notify_waiters(size_type released) noexcept;
+
+	size_type memory_footprint() const noexcept;
+	void trim_memory_pool() noexcept;
+
+	void update_huge_page_peaks(size_type size) noexcept;
+	void spill_if_exceeded();
+
 public:
 	MemoryManager();
 	MemoryManager(AffinityMode affinity_mode);
@@ -53,11 +114,149 @@ public:
 
 	MemoryReference allocate(size_type size);
 	MemoryReference allocate(size_type size, identifier_type numa_node);
+
+	/**
+	 *  Creates a memory object backed by a region of a file.
+	 *
+	 *  @see MappedFile::map()
+	 */
+	MemoryReference map_file(
+		const MappedFile &file,
+		size_type offset,
+		size_type length,
+		size_type head_size,
+		size_type tail_size);
+
 	void notify_release(identifier_type identifier, size_type size) noexcept;
+	void notify_restore(size_type size) noexcept;
 
 	size_type total_memory_usage() const;
 	void log_memory_leaks();
 
+	/**
+	 *  Writes the counters of the memory pool to the profile log.
+	 */
+	void log_memory_pool();
+
+	/**
+	 *  Writes the peak numbers of bytes mapped with huge pages while this
+	 *  manager allocated large objects to the profile log.
+	 */
+	void log_huge_pages();
+
+	size_type memory_limit() const noexcept {
+		return m_memory_limit;
+	}
+	MemoryManager &memory_limit(size_type limit) noexcept {
+		m_memory_limit = limit;
+		return *this;
+	}
+
+	size_type huge_page_threshold() const noexcept {
+		return m_huge_page_threshold;
+	}
+
+	/**
+	 *  Sets the minimum size of memory objects mapped with huge pages.
+	 *
+	 *  @param[in] bytes  The threshold in bytes, or 0 to disable huge pages.
+	 */
+	MemoryManager &huge_page_threshold(size_type bytes) noexcept {
+		m_huge_page_threshold = bytes;
+		return *this;
+	}
+
+	bool is_tracking_enabled() const noexcept {
+		return m_tracking_enabled;
+	}
+
+	/**
+	 *  Sets whether live memory objects are recorded in the registry.
+	 *
+	 *  The registry is used to report leaked objects and to find objects
+	 *  to be spilled. It is enabled by default only in debug builds. This
+	 *  must be set before any objects are allocated.
+	 */
+	MemoryManager &tracking_enabled(bool enabled) noexcept {
+		m_tracking_enabled = enabled;
+		return *this;
+	}
+
+	/**
+	 *  Enables spilling unlocked memory objects to a scratch file in the
+	 *  given directory when the memory usage exceeds the limit.
+	 *
+	 *  This also enables the registry of memory objects, so it must be
+	 *  called before any objects are allocated.
+	 */
+	MemoryManager &spill_memory_objects(const std::string &scratch_directory){
+		m_tracking_enabled = true;
+		m_spill_enabled = true;
+		m_scratch_directory = scratch_directory;
+		return *this;
+	}
+
+	/**
+	 *  Writes unlocked memory objects to the scratch file, in the order of
+	 *  allocation, until the memory usage falls below the pressure
+	 *  threshold.
+	 *
+	 *  The registry is not scanned again until a certain amount of memory
+	 *  has been allocated or released after the previous scan.
+	 *
+	 *  @return The number of released bytes.
+	 */
+	size_type spill_idle_objects();
+
+	ScratchFile &scratch_file();
+
+	size_type input_migration_threshold() const noexcept {
+		return m_input_migration_threshold;
+	}
+	MemoryManager &input_migration_threshold(size_type bytes) noexcept {
+		m_input_migration_threshold = bytes;
+		return *this;
+	}
+
+	/**
+	 *  Moves locked inputs of a task to the NUMA node of the worker that
+	 *  runs the task.
+	 *
+	 *  Nothing is moved unless the inputs placed on other nodes amount to
+	 *  input_migration_threshold() or more, since reading a small input
+	 *  remotely is cheaper than copying it.
+	 *
+	 *  @return The number of moved bytes.
+	 */
+	size_type migrate_inputs(
+		ArrayRef<LockedMemoryReference> inputs, identifier_type numa_node);
+
+	/**
+	 *  Tests whether the memory usage is close to the limit.
+	 *
+	 *  Blocks kept by the memory pool for reuse are counted as used. Tasks
+	 *  producing new buffers should be held back while this function
+	 *  returns true.
+	 */
+	bool is_memory_pressured() const noexcept;
+
+	/**
+	 *  Tests whether the memory usage, including blocks kept by the memory
+	 *  pool, exceeds the limit.
+	 */
+	bool is_memory_exceeded() const noexcept;
+
+	/**
+	 *  Blocks the caller until an allocation of the given size fits in the
+	 *  memory limit.
+	 *
+	 *  The caller is released without waiting for enough memory when no
+	 *  memory object is released for a while, since every worker might be
+	 *  waiting for others. Once a caller has given up, subsequent callers
+	 *  return immediately until any memory object is released.
+	 */
+	void wait_for_memory(size_type size);
+
 
 };
 
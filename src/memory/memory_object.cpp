@@ -15,19 +15,27 @@
  */
 #include <stdexcept>
 #include <cassert>
+#include <cstring>
 #include "memory/memory_object.hpp"
 #include "memory/memory_manager.hpp"
+#include "memory/memory_pool.hpp"
 #include "system/topology.hpp"
+#include "system/scratch_file.hpp"
 
 namespace m3bp {
 
 MemoryObject::MemoryObject()
 	: m_memory_manager()
+	, m_state_mutex()
 	, m_lock_count(0)
 	, m_self_identifier(INVALID_IDENTIFIER)
 	, m_buffer_size(0)
 	, m_locality(0)
+	, m_numa_node(0)
 	, m_pointer(nullptr)
+	, m_is_spilled(false)
+	, m_spill_offset(0)
+	, m_mapping()
 { }
 
 MemoryObject::MemoryObject(
@@ -35,15 +43,21 @@ MemoryObject::MemoryObject(
 	identifier_type identifier,
 	size_type size)
 	: m_memory_manager(std::move(memory_manager))
+	, m_state_mutex()
 	, m_lock_count(0)
 	, m_self_identifier(identifier)
 	, m_buffer_size(size)
 	, m_locality(0)
+	, m_numa_node(0)
 	, m_pointer(nullptr)
+	, m_is_spilled(false)
+	, m_spill_offset(0)
+	, m_mapping()
 {
 	assert(m_memory_manager);
-	auto &topo = Topology::instance();
-	m_pointer = topo.allocate_membind(size);
+	m_numa_node = Topology::instance().current_numa_node();
+	m_pointer = MemoryPool::instance().allocate(
+		size, m_numa_node, m_memory_manager->huge_page_threshold());
 }
 
 MemoryObject::MemoryObject(
@@ -52,23 +66,65 @@ MemoryObject::MemoryObject(
 	size_type size,
 	identifier_type numa_node)
 	: m_memory_manager(std::move(memory_manager))
+	, m_state_mutex()
 	, m_lock_count(0)
 	, m_self_identifier(identifier)
 	, m_buffer_size(size)
 	, m_locality(numa_node)
+	, m_numa_node(numa_node)
 	, m_pointer(nullptr)
+	, m_is_spilled(false)
+	, m_spill_offset(0)
+	, m_mapping()
 {
 	assert(m_memory_manager);
-	auto &topo = Topology::instance();
-	m_pointer = topo.allocate_membind(size, numa_node);
+	m_pointer = MemoryPool::instance().allocate(
+		size, numa_node, m_memory_manager->huge_page_threshold());
+}
+
+MemoryObject::MemoryObject(
+	std::shared_ptr<MemoryManager> memory_manager,
+	identifier_type identifier,
+	const MappedFile &file,
+	size_type offset,
+	size_type length,
+	size_type head_size,
+	size_type tail_size)
+	: m_memory_manager(std::move(memory_manager))
+	, m_state_mutex()
+	, m_lock_count(0)
+	, m_self_identifier(identifier)
+	, m_buffer_size(head_size + length + tail_size)
+	, m_locality(0)
+	, m_numa_node(0)
+	, m_pointer(nullptr)
+	, m_is_spilled(false)
+	, m_spill_offset(0)
+	, m_mapping()
+{
+	assert(m_memory_manager);
+	m_numa_node = Topology::instance().current_numa_node();
+	m_mapping = file.map(offset, length, head_size, tail_size);
+	m_pointer = m_mapping.pointer;
 }
 
 MemoryObject::~MemoryObject(){
 	assert(m_lock_count.load() == 0);
 	if(m_self_identifier != INVALID_IDENTIFIER){
-		auto &topo = Topology::instance();
-		topo.release_membind(m_pointer, m_buffer_size);
-		m_memory_manager->notify_release(m_self_identifier, m_buffer_size);
+		if(m_mapping.mapping){
+			MappedFile::unmap(m_mapping);
+			m_memory_manager->notify_release(
+				m_self_identifier, m_buffer_size);
+		}else if(m_is_spilled){
+			auto &file = m_memory_manager->scratch_file();
+			file.discard(m_buffer_size, m_spill_offset);
+			m_memory_manager->notify_release(m_self_identifier, 0);
+		}else{
+			MemoryPool::instance().release(
+				m_pointer, m_buffer_size, m_numa_node);
+			m_memory_manager->notify_release(
+				m_self_identifier, m_buffer_size);
+		}
 	}
 }
 
@@ -87,11 +143,63 @@ identifier_type MemoryObject::locality() const noexcept {
 
 
 void MemoryObject::lock(){
+	std::lock_guard<std::mutex> lock(m_state_mutex);
+	if(m_is_spilled){ restore(); }
 	m_lock_count++;
 }
 
 void MemoryObject::unlock() noexcept {
-	assert(m_lock_count-- > 0);
+	const auto old_count = m_lock_count--;
+	assert(old_count > 0);
+	(void)(old_count);
+}
+
+
+size_type MemoryObject::spill(ScratchFile &file){
+	std::lock_guard<std::mutex> lock(m_state_mutex);
+	if(m_self_identifier == INVALID_IDENTIFIER){ return 0; }
+	if(m_is_spilled || m_mapping.mapping){ return 0; }
+	if(m_lock_count.load() > 0){ return 0; }
+	m_spill_offset = file.append(m_pointer, m_buffer_size);
+	// Keeping the block in the pool would not reduce the memory usage
+	MemoryPool::release_to_system(m_pointer, m_buffer_size);
+	m_pointer = nullptr;
+	m_is_spilled = true;
+	return m_buffer_size;
+}
+
+size_type MemoryObject::migrate(identifier_type numa_node){
+	std::lock_guard<std::mutex> lock(m_state_mutex);
+	if(m_self_identifier == INVALID_IDENTIFIER){ return 0; }
+	if(m_is_spilled || m_mapping.mapping){ return 0; }
+	if(m_lock_count.load() != 1){ return 0; }
+	if(m_numa_node == numa_node){ return 0; }
+	auto &pool = MemoryPool::instance();
+	void *ptr = pool.allocate(
+		m_buffer_size, numa_node, m_memory_manager->huge_page_threshold());
+	memcpy(ptr, m_pointer, m_buffer_size);
+	pool.release(m_pointer, m_buffer_size, m_numa_node);
+	m_pointer = ptr;
+	m_locality = numa_node;
+	m_numa_node = numa_node;
+	return m_buffer_size;
+}
+
+void MemoryObject::restore(){
+	assert(m_is_spilled);
+	auto &file = m_memory_manager->scratch_file();
+	void *ptr = MemoryPool::instance().allocate(
+		m_buffer_size, m_numa_node, m_memory_manager->huge_page_threshold());
+	try{
+		file.read(ptr, m_buffer_size, m_spill_offset);
+	}catch(...){
+		MemoryPool::instance().release(ptr, m_buffer_size, m_numa_node);
+		throw;
+	}
+	file.discard(m_buffer_size, m_spill_offset);
+	m_pointer = ptr;
+	m_is_spilled = false;
+	m_memory_manager->notify_restore(m_buffer_size);
 }
 
 
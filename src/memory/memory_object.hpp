@@ -18,13 +18,16 @@
 
 #include <memory>
 #include <atomic>
+#include <mutex>
 #include <limits>
 #include <boost/noncopyable.hpp>
 #include "m3bp/types.hpp"
+#include "system/mapped_file.hpp"
 
 namespace m3bp {
 
 class MemoryManager;
+class ScratchFile;
 
 class MemoryObject : private boost::noncopyable {
 
@@ -33,11 +36,18 @@ private:
 		std::numeric_limits<identifier_type>::max();
 
 	std::shared_ptr<MemoryManager> m_memory_manager;
+	std::mutex m_state_mutex;
 	std::atomic<size_type> m_lock_count;
 	identifier_type m_self_identifier;
 	size_type m_buffer_size;
 	identifier_type m_locality;
+	identifier_type m_numa_node;
 	void *m_pointer;
+	bool m_is_spilled;
+	size_type m_spill_offset;
+	MappedFile::Region m_mapping;
+
+	void restore();
 
 public:
 	MemoryObject();
@@ -50,15 +60,55 @@ public:
 		identifier_type identifier,
 		size_type size,
 		identifier_type numa_node);
+	MemoryObject(
+		std::shared_ptr<MemoryManager> memory_manager,
+		identifier_type identifier,
+		const MappedFile &file,
+		size_type offset,
+		size_type length,
+		size_type head_size,
+		size_type tail_size);
 	~MemoryObject();
 
 	identifier_type identifier() const;
 	size_type size() const noexcept;
 	identifier_type locality() const noexcept;
 
+	identifier_type numa_node() const noexcept {
+		return m_numa_node;
+	}
+
 	void lock();
 	void unlock() noexcept;
 
+	bool is_spilled() const noexcept {
+		return m_is_spilled;
+	}
+
+	bool is_file_backed() const noexcept {
+		return m_mapping.mapping != nullptr;
+	}
+
+	/**
+	 *  Writes the content to a scratch file and releases the buffer if this
+	 *  object is neither locked nor backed by a mapped file.
+	 *
+	 *  The content is read back when this object is locked again.
+	 *
+	 *  @return The number of released bytes.
+	 */
+	size_type spill(ScratchFile &file);
+
+	/**
+	 *  Moves the content to a buffer on the given NUMA node.
+	 *
+	 *  The buffer is replaced only if the caller holds the only lock of
+	 *  this object, since other holders may keep pointers to the old one.
+	 *
+	 *  @return The number of moved bytes.
+	 */
+	size_type migrate(identifier_type numa_node);
+
 	const void *pointer() const;
 	void *pointer();
 
@@ -0,0 +1,308 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <utility>
+#include <cassert>
+#include "memory/memory_pool.hpp"
+#include "system/topology.hpp"
+#include "common/make_unique.hpp"
+
+#ifdef M3BP_NO_THREAD_LOCAL
+#include "common/thread_specific.hpp"
+#endif
+
+namespace m3bp {
+
+namespace {
+
+// Four classes for each power of two from MIN_POOLED_SIZE to MAX_POOLED_SIZE
+const size_type SIZE_CLASS_COUNT = 4 * 12 + 1;
+
+size_type class_to_size(size_type sc){
+	const size_type base = MemoryPool::MIN_POOLED_SIZE << (sc / 4);
+	return base + (sc % 4) * (base / 4);
+}
+
+}
+
+class MemoryPool::ThreadCache {
+
+public:
+	static const size_type MAX_BLOCKS_PER_CLASS = 2;
+	static const size_type CAPACITY = (32 << 20);
+
+private:
+	// m_free_lists[numa_node][size_class]
+	std::vector<std::vector<std::vector<void *>>> m_free_lists;
+	size_type m_cached_bytes;
+	size_type m_trim_epoch;
+
+public:
+	ThreadCache()
+		: m_free_lists()
+		, m_cached_bytes(0)
+		, m_trim_epoch(0)
+	{ }
+
+	~ThreadCache(){
+		auto &pool = MemoryPool::instance();
+		pool.m_pooled_bytes -= m_cached_bytes;
+		for(identifier_type node = 0; node < m_free_lists.size(); ++node){
+			auto &lists = m_free_lists[node];
+			for(size_type sc = 0; sc < lists.size(); ++sc){
+				for(auto ptr : lists[sc]){ pool.release_shared(ptr, node, sc); }
+			}
+		}
+	}
+
+	void *pop(MemoryPool &pool, identifier_type numa_node, size_type sc){
+		synchronize(pool);
+		if(numa_node >= m_free_lists.size()){ return nullptr; }
+		auto &list = m_free_lists[numa_node][sc];
+		if(list.empty()){ return nullptr; }
+		void *ptr = list.back();
+		list.pop_back();
+		const auto size = class_to_size(sc);
+		m_cached_bytes -= size;
+		pool.m_pooled_bytes -= size;
+		return ptr;
+	}
+
+	bool push(
+		MemoryPool &pool, void *ptr, identifier_type numa_node, size_type sc)
+	{
+		// Blocks released just after trim() go to the shared free lists so
+		// that the next call of trim() can release them
+		if(synchronize(pool)){ return false; }
+		const auto size = class_to_size(sc);
+		if(m_cached_bytes + size > CAPACITY){ return false; }
+		if(numa_node >= m_free_lists.size()){
+			m_free_lists.resize(
+				numa_node + 1,
+				std::vector<std::vector<void *>>(SIZE_CLASS_COUNT));
+		}
+		auto &list = m_free_lists[numa_node][sc];
+		if(list.size() >= MAX_BLOCKS_PER_CLASS){ return false; }
+		list.push_back(ptr);
+		m_cached_bytes += size;
+		pool.m_pooled_bytes += size;
+		return true;
+	}
+
+	// Releases cached blocks if MemoryPool::trim() was called after the
+	// last access from this thread
+	bool synchronize(MemoryPool &pool) noexcept {
+		const auto epoch = pool.m_trim_epoch.load();
+		if(epoch == m_trim_epoch){ return false; }
+		m_trim_epoch = epoch;
+		if(m_cached_bytes == 0){ return true; }
+		auto &topo = Topology::instance();
+		for(auto &lists : m_free_lists){
+			for(size_type sc = 0; sc < lists.size(); ++sc){
+				const auto size = class_to_size(sc);
+				for(auto ptr : lists[sc]){ topo.release_membind(ptr, size); }
+				lists[sc].clear();
+			}
+		}
+		pool.m_pooled_bytes -= m_cached_bytes;
+		m_cached_bytes = 0;
+		return true;
+	}
+
+};
+
+
+MemoryPool::MemoryPool()
+	: m_node_pools()
+	, m_capacity(DEFAULT_CAPACITY)
+	, m_pooled_bytes(0)
+	, m_trim_epoch(0)
+	, m_hit_count(0)
+	, m_miss_count(0)
+{
+	const auto num_nodes = Topology::instance().numa_node_count();
+	for(size_type i = 0; i < num_nodes; ++i){
+		auto node_pool = make_unique<NodePool>();
+		node_pool->free_lists.resize(SIZE_CLASS_COUNT);
+		node_pool->retained_bytes = 0;
+		m_node_pools.emplace_back(std::move(node_pool));
+	}
+}
+
+MemoryPool::~MemoryPool(){
+	// Thread-local caches of this thread may have already been destroyed
+	trim_shared();
+}
+
+MemoryPool &MemoryPool::instance(){
+	static MemoryPool s_instance;
+	return s_instance;
+}
+
+MemoryPool::ThreadCache &MemoryPool::thread_cache(){
+#ifdef M3BP_NO_THREAD_LOCAL
+	static ThreadSpecific<ThreadCache> s_ts_cache;
+	return s_ts_cache.get();
+#else
+	static thread_local ThreadCache s_cache;
+	return s_cache;
+#endif
+}
+
+
+size_type MemoryPool::size_class(size_type size, size_type &rounded) noexcept {
+	size_type base = MIN_POOLED_SIZE, sc = 0;
+	while(base * 2 < size){
+		base *= 2;
+		sc += 4;
+	}
+	const size_type step = base / 4;
+	const size_type n = (size > base) ? (size - base + step - 1) / step : 0;
+	rounded = base + n * step;
+	return sc + n;
+}
+
+
+void *MemoryPool::allocate(size_type size){
+	return allocate(size, Topology::instance().current_numa_node());
+}
+
+void *MemoryPool::allocate(
+	size_type size, identifier_type numa_node, size_type huge_page_threshold)
+{
+	auto &topo = Topology::instance();
+	if(!is_pooled(size)){
+		return topo.allocate_membind(size, numa_node, huge_page_threshold);
+	}
+	size_type rounded = 0;
+	const auto sc = size_class(size, rounded);
+	void *ptr = thread_cache().pop(*this, numa_node, sc);
+	if(!ptr){ ptr = acquire_shared(numa_node, sc); }
+	if(ptr){
+		++m_hit_count;
+		return ptr;
+	}
+	++m_miss_count;
+	return topo.allocate_membind(rounded, numa_node, huge_page_threshold);
+}
+
+void MemoryPool::release(
+	void *ptr, size_type size, identifier_type numa_node) noexcept
+{
+	if(!is_pooled(size)){
+		Topology::instance().release_membind(ptr, size);
+		return;
+	}
+	size_type rounded = 0;
+	const auto sc = size_class(size, rounded);
+	if(thread_cache().push(*this, ptr, numa_node, sc)){ return; }
+	release_shared(ptr, numa_node, sc);
+}
+
+void MemoryPool::release_to_system(void *ptr, size_type size) noexcept {
+	size_type rounded = size;
+	if(is_pooled(size)){ size_class(size, rounded); }
+	Topology::instance().release_membind(ptr, rounded);
+}
+
+
+void *MemoryPool::acquire_shared(identifier_type numa_node, size_type sc){
+	assert(numa_node < m_node_pools.size());
+	auto &node_pool = *m_node_pools[numa_node];
+	std::lock_guard<std::mutex> lock(node_pool.mutex);
+	auto &list = node_pool.free_lists[sc];
+	if(list.empty()){ return nullptr; }
+	void *ptr = list.back();
+	list.pop_back();
+	const auto size = class_to_size(sc);
+	node_pool.retained_bytes -= size;
+	m_pooled_bytes -= size;
+	return ptr;
+}
+
+void MemoryPool::release_shared(
+	void *ptr, identifier_type numa_node, size_type sc) noexcept
+{
+	assert(numa_node < m_node_pools.size());
+	const auto size = class_to_size(sc);
+	{
+		auto &node_pool = *m_node_pools[numa_node];
+		std::lock_guard<std::mutex> lock(node_pool.mutex);
+		if(node_pool.retained_bytes + size <= m_capacity.load()){
+			node_pool.free_lists[sc].push_back(ptr);
+			node_pool.retained_bytes += size;
+			m_pooled_bytes += size;
+			return;
+		}
+	}
+	Topology::instance().release_membind(ptr, size);
+}
+
+
+MemoryPool &MemoryPool::capacity(size_type bytes){
+	m_capacity = bytes;
+	std::vector<std::pair<void *, size_type>> released;
+	for(auto &node_pool : m_node_pools){
+		std::lock_guard<std::mutex> lock(node_pool->mutex);
+		// Larger blocks are released first
+		for(size_type sc = SIZE_CLASS_COUNT; sc > 0; --sc){
+			auto &list = node_pool->free_lists[sc - 1];
+			while(node_pool->retained_bytes > bytes && !list.empty()){
+				const auto size = class_to_size(sc - 1);
+				released.emplace_back(list.back(), size);
+				list.pop_back();
+				node_pool->retained_bytes -= size;
+				m_pooled_bytes -= size;
+			}
+		}
+	}
+	auto &topo = Topology::instance();
+	for(const auto &p : released){ topo.release_membind(p.first, p.second); }
+	return *this;
+}
+
+void MemoryPool::trim() noexcept {
+	++m_trim_epoch;
+	thread_cache().synchronize(*this);
+	trim_shared();
+}
+
+void MemoryPool::trim_shared() noexcept {
+	auto &topo = Topology::instance();
+	for(auto &node_pool : m_node_pools){
+		std::vector<std::vector<void *>> free_lists(SIZE_CLASS_COUNT);
+		{
+			std::lock_guard<std::mutex> lock(node_pool->mutex);
+			free_lists.swap(node_pool->free_lists);
+			m_pooled_bytes -= node_pool->retained_bytes;
+			node_pool->retained_bytes = 0;
+		}
+		for(size_type sc = 0; sc < free_lists.size(); ++sc){
+			const auto size = class_to_size(sc);
+			for(auto ptr : free_lists[sc]){ topo.release_membind(ptr, size); }
+		}
+	}
+}
+
+size_type MemoryPool::retained_bytes() const {
+	size_type sum = 0;
+	for(const auto &node_pool : m_node_pools){
+		std::lock_guard<std::mutex> lock(node_pool->mutex);
+		sum += node_pool->retained_bytes;
+	}
+	return sum;
+}
+
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef M3BP_MEMORY_MEMORY_POOL_HPP
+#define M3BP_MEMORY_MEMORY_POOL_HPP
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <boost/noncopyable.hpp>
+#include "m3bp/types.hpp"
+
+namespace m3bp {
+
+/**
+ *  Size-classed free lists that recycle large memory blocks.
+ *
+ *  Blocks are bucketed by NUMA node and rounded up to one of four classes
+ *  per power of two. Released blocks are kept in a small thread-local cache
+ *  first and then in the shared free list of their node, so that their
+ *  pages are reused without being unmapped and faulted again. Blocks that
+ *  exceed the capacity of a node are returned to the operating system.
+ */
+class MemoryPool : private boost::noncopyable {
+
+public:
+	/// Blocks smaller than this are allocated without pooling.
+	static const size_type MIN_POOLED_SIZE = (64 << 10);
+	/// Blocks larger than this are allocated without pooling.
+	static const size_type MAX_POOLED_SIZE = (256 << 20);
+	/// The default number of bytes that can be kept for each NUMA node.
+	static const size_type DEFAULT_CAPACITY = (256 << 20);
+
+private:
+	class ThreadCache;
+
+	struct NodePool {
+		std::mutex mutex;
+		std::vector<std::vector<void *>> free_lists;
+		size_type retained_bytes;
+	};
+
+	std::vector<std::unique_ptr<NodePool>> m_node_pools;
+	std::atomic<size_type> m_capacity;
+	std::atomic<size_type> m_pooled_bytes;
+	std::atomic<size_type> m_trim_epoch;
+	std::atomic<size_type> m_hit_count;
+	std::atomic<size_type> m_miss_count;
+
+	MemoryPool();
+
+	static ThreadCache &thread_cache();
+
+	void *acquire_shared(identifier_type numa_node, size_type size_class);
+	void release_shared(
+		void *ptr, identifier_type numa_node, size_type size_class) noexcept;
+	void trim_shared() noexcept;
+
+public:
+	~MemoryPool();
+
+	static MemoryPool &instance();
+
+	/**
+	 *  Tests whether blocks of the given size are recycled by this pool.
+	 */
+	static bool is_pooled(size_type size) noexcept {
+		return size >= MIN_POOLED_SIZE && size <= MAX_POOLED_SIZE;
+	}
+
+	/**
+	 *  Computes the size class and the actual size of a pooled block.
+	 */
+	static size_type size_class(size_type size, size_type &rounded) noexcept;
+
+	void *allocate(size_type size);
+	void *allocate(
+		size_type size,
+		identifier_type numa_node,
+		size_type huge_page_threshold = 0);
+	void release(void *ptr, size_type size, identifier_type numa_node) noexcept;
+
+	/**
+	 *  Returns a block allocated by this pool to the operating system
+	 *  without keeping it in the free lists.
+	 */
+	static void release_to_system(void *ptr, size_type size) noexcept;
+
+	size_type capacity() const noexcept {
+		return m_capacity.load();
+	}
+
+	/**
+	 *  Sets the maximum number of bytes kept in the shared free lists of
+	 *  each NUMA node. Blocks exceeding the new capacity are released.
+	 */
+	MemoryPool &capacity(size_type bytes);
+
+	/**
+	 *  Releases all blocks kept in the shared free lists and the cache of
+	 *  the calling thread. Caches of other threads are released when the
+	 *  threads access this pool next time.
+	 */
+	void trim() noexcept;
+
+	size_type retained_bytes() const;
+
+	/**
+	 *  Returns the number of bytes kept in the shared free lists and the
+	 *  caches of all threads.
+	 */
+	size_type pooled_bytes() const noexcept {
+		return m_pooled_bytes.load();
+	}
+
+	size_type hit_count() const noexcept {
+		return m_hit_count.load();
+	}
+	size_type miss_count() const noexcept {
+		return m_miss_count.load();
+	}
+
+};
+
+}
+
+#endif
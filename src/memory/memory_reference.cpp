@@ -72,6 +72,16 @@ identifier_type LockedMemoryReference::locality() const noexcept {
 	return m_memory_object->locality();
 }
 
+identifier_type LockedMemoryReference::numa_node() const noexcept {
+	assert(m_memory_object);
+	return m_memory_object->numa_node();
+}
+
+size_type LockedMemoryReference::size() const noexcept {
+	assert(m_memory_object);
+	return m_memory_object->size();
+}
+
 
 const void *LockedMemoryReference::pointer() const {
 	assert(m_memory_object);
@@ -83,6 +93,11 @@ void *LockedMemoryReference::pointer(){
 	return m_memory_object->pointer();
 }
 
+size_type LockedMemoryReference::migrate(identifier_type numa_node){
+	assert(m_memory_object);
+	return m_memory_object->migrate(numa_node);
+}
+
 
 
 MemoryReference::MemoryReference()
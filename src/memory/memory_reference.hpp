@@ -51,9 +51,21 @@ public:
 
 	identifier_type locality() const noexcept;
 
+	identifier_type numa_node() const noexcept;
+
+	size_type size() const noexcept;
+
 	const void *pointer() const;
 	void *pointer();
 
+	/**
+	 *  Moves the referenced object to the given NUMA node if no other
+	 *  references lock it. Pointers obtained before are invalidated.
+	 *
+	 *  @return The number of moved bytes.
+	 */
+	size_type migrate(identifier_type numa_node);
+
 };
 
 class MemoryReference {
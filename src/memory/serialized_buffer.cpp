@@ -15,6 +15,7 @@
  */
 #include <cstddef>
 #include <cassert>
+#include <cstring>
 #include "memory/serialized_buffer.hpp"
 #include "memory/memory_manager.hpp"
 
@@ -77,6 +78,55 @@ SerializedBuffer SerializedBuffer::allocate_value_only_buffer(
 	return SerializedBuffer(locked_reference);
 }
 
+SerializedBuffer SerializedBuffer::map_value_only_buffer(
+	MemoryManager &memory_manager,
+	const MappedFile &file,
+	size_type offset,
+	size_type length,
+	size_type maximum_record_count)
+{
+	// Same layout as allocate_value_only_buffer(): the headers are placed
+	// just before the mapped data and the offsets just after it. The data
+	// begins at an aligned position of the file to keep them aligned.
+	const auto leading = offset % alignof(max_align_t);
+	offset -= leading;
+	length += leading;
+	size_type head_size = 0;
+	const ptrdiff_t common_header_ptrdiff = head_size;
+	head_size += sizeof(SerializedBufferHeader);
+	const ptrdiff_t values_header_ptrdiff = head_size;
+	head_size += sizeof(SerializedValuesHeader);
+	head_size  = align_ceil(head_size, alignof(max_align_t));
+	const auto data_size = align_ceil(length, alignof(size_type));
+	const auto tail_size =
+		(data_size - length) +
+		(maximum_record_count + 1) * sizeof(size_type);
+
+	auto locked_reference = memory_manager.map_file(
+		file, offset, length, head_size, tail_size).lock();
+	const auto ptr =
+		reinterpret_cast<uintptr_t>(locked_reference.pointer());
+
+	const auto common_header =
+		reinterpret_cast<SerializedBufferHeader *>(
+			ptr + common_header_ptrdiff);
+	common_header->key_buffer_size = 0;
+	common_header->value_buffer_size =
+		static_cast<size_type>(
+			head_size + data_size +
+			(maximum_record_count + 1) * sizeof(size_type) -
+			values_header_ptrdiff);
+
+	const auto values_header =
+		reinterpret_cast<SerializedValuesHeader *>(
+			ptr + values_header_ptrdiff);
+	values_header->data_buffer_size = data_size;
+	values_header->maximum_record_count = maximum_record_count;
+	values_header->actual_record_count = 0;
+
+	return SerializedBuffer(locked_reference);
+}
+
 SerializedBuffer SerializedBuffer::allocate_key_value_buffer(
 	MemoryManager &memory_manager,
 	size_type maximum_record_count,
@@ -273,6 +323,43 @@ SerializedBuffer::SerializedBuffer(LockedMemoryReference mobj)
 	}
 }
 
+size_type SerializedBuffer::used_size() const noexcept {
+	assert(m_values_header && !is_grouped());
+	const auto count = m_values_header->actual_record_count;
+	size_type size = reinterpret_cast<uintptr_t>(m_values_data) -
+		reinterpret_cast<uintptr_t>(m_common_header);
+	size += align_ceil(m_values_offsets[count], alignof(size_type));
+	size += (count + 1) * sizeof(size_type);
+	if(m_values_key_lengths){ size += count * sizeof(size_type); }
+	return size;
+}
+
+SerializedBuffer SerializedBuffer::shrink_to_fit(
+	MemoryManager &memory_manager,
+	identifier_type target_node) const
+{
+	assert(m_values_header && !is_grouped());
+	const auto count = m_values_header->actual_record_count;
+	const auto data_size = m_values_offsets[count];
+	SerializedBuffer sb;
+	if(m_values_key_lengths){
+		sb = allocate_key_value_buffer(
+			memory_manager, count, data_size, target_node);
+		memcpy(
+			sb.m_values_key_lengths, m_values_key_lengths,
+			count * sizeof(size_type));
+	}else{
+		sb = allocate_value_only_buffer(
+			memory_manager, count, data_size, target_node);
+	}
+	memcpy(sb.m_values_data, m_values_data, data_size);
+	memcpy(
+		sb.m_values_offsets, m_values_offsets,
+		(count + 1) * sizeof(size_type));
+	sb.record_count(count);
+	return sb;
+}
+
 namespace {
 
 uint64_t compute_partial_hash(const uint8_t *ptr, size_type len){
@@ -24,6 +24,7 @@
 namespace m3bp {
 
 class MemoryManager;
+class MappedFile;
 class MemoryReference;
 class LockedMemoryReference;
 
@@ -76,6 +77,21 @@ public:
 		size_type total_record_size,
 		identifier_type target_node = TARGET_NODE_UNSPECIFIED);
 
+	/**
+	 *  Creates a value-only buffer whose data is a region of a file.
+	 *
+	 *  The data is mapped into memory without copying. It begins at the
+	 *  offset rounded down to alignof(max_align_t), so the first record is
+	 *  placed at (offset % alignof(max_align_t)) in values_data(). Only
+	 *  the offset table has to be filled by the caller.
+	 */
+	static SerializedBuffer map_value_only_buffer(
+		MemoryManager &memory_manager,
+		const MappedFile &file,
+		size_type offset,
+		size_type length,
+		size_type maximum_record_count);
+
 	static SerializedBuffer allocate_grouped_buffer(
 		MemoryManager &memory_manager,
 		size_type maximum_record_count,
@@ -99,6 +115,35 @@ public:
 	}
 
 
+	/**
+	 *  Gets the number of bytes occupied by this buffer including unused
+	 *  space.
+	 */
+	size_type allocated_size() const noexcept {
+		assert(m_common_header);
+		return sizeof(SerializedBufferHeader) +
+			m_common_header->key_buffer_size +
+			m_common_header->value_buffer_size;
+	}
+
+	/**
+	 *  Gets the number of bytes that a copy made by shrink_to_fit() would
+	 *  occupy.
+	 */
+	size_type used_size() const noexcept;
+
+	/**
+	 *  Copies records of an ungrouped buffer into a new buffer that has no
+	 *  space for more records.
+	 *
+	 *  The data and the tables of the new buffer have the same contents as
+	 *  those of this buffer up to record_count().
+	 */
+	SerializedBuffer shrink_to_fit(
+		MemoryManager &memory_manager,
+		identifier_type target_node = TARGET_NODE_UNSPECIFIED) const;
+
+
 	bool is_grouped() const noexcept {
 		return m_keys_header != nullptr;
 	}
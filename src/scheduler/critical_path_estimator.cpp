@@ -0,0 +1,123 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <cassert>
+#include "scheduler/critical_path_estimator.hpp"
+
+namespace m3bp {
+
+namespace {
+
+// Ranks are recomputed once in this number of records
+const size_type UPDATE_INTERVAL = 64;
+
+}
+
+CriticalPathEstimator::CriticalPathEstimator()
+	: m_successors()
+	, m_evaluation_order()
+	, m_statistics()
+	, m_ranks()
+	, m_record_count(0)
+	, m_update_mutex()
+{ }
+
+CriticalPathEstimator::CriticalPathEstimator(
+	std::vector<std::vector<identifier_type>> successors)
+	: m_successors(std::move(successors))
+	, m_evaluation_order()
+	, m_statistics(new Statistics[m_successors.size()])
+	, m_ranks(new std::atomic<uint64_t>[m_successors.size()])
+	, m_record_count(0)
+	, m_update_mutex()
+{
+	// Depth-first search emits successors before predecessors
+	const auto n = m_successors.size();
+	std::vector<bool> visited(n, false);
+	std::vector<std::pair<identifier_type, size_type>> stack;
+	for(identifier_type root = 0; root < n; ++root){
+		if(visited[root]){ continue; }
+		visited[root] = true;
+		stack.emplace_back(root, 0);
+		while(!stack.empty()){
+			auto &top = stack.back();
+			const auto &succs = m_successors[top.first];
+			if(top.second < succs.size()){
+				const auto next = succs[top.second++];
+				assert(next < n);
+				if(!visited[next]){
+					visited[next] = true;
+					stack.emplace_back(next, 0);
+				}
+			}else{
+				m_evaluation_order.push_back(top.first);
+				stack.pop_back();
+			}
+		}
+	}
+	for(identifier_type i = 0; i < n; ++i){ m_ranks[i] = 0; }
+	update();
+}
+
+
+uint64_t CriticalPathEstimator::rank(
+	identifier_type logical_task) const noexcept
+{
+	if(logical_task >= m_successors.size()){ return 0; }
+	return m_ranks[logical_task].load(std::memory_order_relaxed);
+}
+
+void CriticalPathEstimator::record(
+	identifier_type logical_task, uint64_t elapsed)
+{
+	if(logical_task >= m_successors.size()){ return; }
+	auto &stat = m_statistics[logical_task];
+	stat.total_time += elapsed;
+	const auto first_record = (stat.count++ == 0);
+	const auto record_count = ++m_record_count;
+	if(first_record || record_count % UPDATE_INTERVAL == 0){ update(); }
+}
+
+void CriticalPathEstimator::update(){
+	std::unique_lock<std::mutex> lock(m_update_mutex, std::try_to_lock);
+	if(!lock.owns_lock()){ return; }
+	const auto n = m_successors.size();
+	// Weights in nanoseconds per physical task
+	std::vector<uint64_t> weights(n, 0);
+	uint64_t weight_sum = 0, observed_count = 0;
+	for(identifier_type i = 0; i < n; ++i){
+		const auto count = m_statistics[i].count.load();
+		if(count == 0){ continue; }
+		weights[i] = std::max<uint64_t>(
+			m_statistics[i].total_time.load() / count, 1);
+		weight_sum += weights[i];
+		++observed_count;
+	}
+	const uint64_t default_weight =
+		(observed_count > 0) ? weight_sum / observed_count : 1;
+	std::vector<uint64_t> ranks(n, 0);
+	for(const auto i : m_evaluation_order){
+		uint64_t longest = 0;
+		for(const auto s : m_successors[i]){
+			longest = std::max(longest, ranks[s]);
+		}
+		const auto w = (weights[i] > 0) ? weights[i] : default_weight;
+		ranks[i] = w + longest;
+		m_ranks[i].store(ranks[i], std::memory_order_relaxed);
+	}
+}
+
+}
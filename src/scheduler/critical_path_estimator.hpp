@@ -0,0 +1,89 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef M3BP_SCHEDULER_CRITICAL_PATH_ESTIMATOR_HPP
+#define M3BP_SCHEDULER_CRITICAL_PATH_ESTIMATOR_HPP
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include "m3bp/types.hpp"
+
+namespace m3bp {
+
+/**
+ *  Estimates the remaining work on the longest path from each logical task.
+ *
+ *  The rank of a logical task is the sum of the mean execution times of
+ *  physical tasks along the heaviest path from the task to a sink of the
+ *  logical graph. Logical tasks that have not been observed yet are
+ *  weighted by the mean of observed ones, so ranks initially reflect the
+ *  depth of the graph.
+ */
+class CriticalPathEstimator {
+
+private:
+	struct Statistics {
+		std::atomic<uint64_t> total_time;
+		std::atomic<uint64_t> count;
+
+		Statistics()
+			: total_time(0)
+			, count(0)
+		{ }
+	};
+
+	std::vector<std::vector<identifier_type>> m_successors;
+	// Logical tasks ordered so that successors precede predecessors
+	std::vector<identifier_type> m_evaluation_order;
+	std::unique_ptr<Statistics[]> m_statistics;
+	std::unique_ptr<std::atomic<uint64_t>[]> m_ranks;
+	std::atomic<size_type> m_record_count;
+	std::mutex m_update_mutex;
+
+public:
+	CriticalPathEstimator();
+	explicit CriticalPathEstimator(
+		std::vector<std::vector<identifier_type>> successors);
+
+	CriticalPathEstimator(const CriticalPathEstimator &) = delete;
+	CriticalPathEstimator &operator=(const CriticalPathEstimator &) = delete;
+
+	/**
+	 *  Gets the rank of a logical task, or 0 for unknown tasks.
+	 */
+	uint64_t rank(identifier_type logical_task) const noexcept;
+
+	/**
+	 *  Records the execution time of a physical task and occasionally
+	 *  updates ranks.
+	 *
+	 *  @param[in] logical_task  The logical task of the physical task.
+	 *  @param[in] elapsed       The execution time in nanoseconds.
+	 */
+	void record(identifier_type logical_task, uint64_t elapsed);
+
+	/**
+	 *  Recomputes ranks from the execution times recorded so far.
+	 */
+	void update();
+
+};
+
+}
+
+#endif
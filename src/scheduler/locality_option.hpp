@@ -29,11 +29,13 @@ private:
 
 	identifier_type m_recommended_worker;
 	bool m_is_stealable;
+	bool m_is_memory_producer;
 
 public:
 	LocalityOption()
 		: m_recommended_worker(UNSPECIFIED_ID)
 		, m_is_stealable(true)
+		, m_is_memory_producer(false)
 	{ }
 
 	explicit LocalityOption(
@@ -41,6 +43,7 @@ public:
 		bool is_stealable = true)
 		: m_recommended_worker(recommended_worker)
 		, m_is_stealable(is_stealable)
+		, m_is_memory_producer(false)
 	{ }
 
 	bool has_recommendation() const noexcept {
@@ -55,6 +58,20 @@ public:
 		return m_is_stealable;
 	}
 
+	/**
+	 *  Marks the task as one that allocates buffers without releasing its
+	 *  inputs, like input and map tasks. Stealable producers are held back
+	 *  while memory usage is near the limit.
+	 */
+	LocalityOption &memory_producer(bool flag) noexcept {
+		m_is_memory_producer = flag;
+		return *this;
+	}
+
+	bool is_memory_producer() const noexcept {
+		return m_is_memory_producer;
+	}
+
 };
 
 }
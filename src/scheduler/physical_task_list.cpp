@@ -22,38 +22,61 @@ namespace m3bp {
 
 PhysicalTaskList::PhysicalTaskList()
 	: m_mutex()
-	, m_deque()
+	, m_buckets()
+	, m_size(0)
+	, m_highest_priority(0)
 { }
 
 
-void PhysicalTaskList::push_front(PhysicalTaskPtr task){
+void PhysicalTaskList::update_highest_priority() noexcept {
+	const auto priority =
+		m_buckets.empty() ? 0 : m_buckets.begin()->first;
+	m_highest_priority.store(priority, std::memory_order_relaxed);
+}
+
+
+void PhysicalTaskList::push_front(PhysicalTaskPtr task, uint64_t priority){
 	assert(task);
 	std::unique_lock<std::mutex> lock(m_mutex);
-	m_deque.emplace_front(std::move(task));
+	m_buckets[priority].emplace_front(std::move(task));
+	++m_size;
+	update_highest_priority();
 }
 
-void PhysicalTaskList::push_back(PhysicalTaskPtr task){
+void PhysicalTaskList::push_back(PhysicalTaskPtr task, uint64_t priority){
 	assert(task);
 	std::unique_lock<std::mutex> lock(m_mutex);
-	m_deque.emplace_back(std::move(task));
+	m_buckets[priority].emplace_back(std::move(task));
+	++m_size;
+	update_highest_priority();
 }
 
 
-PhysicalTaskList::PhysicalTaskPtr PhysicalTaskList::pop_front(){
+PhysicalTaskList::PhysicalTaskPtr PhysicalTaskList::pop(bool front){
 	std::unique_lock<std::mutex> lock(m_mutex);
-	if(m_deque.empty()){ return PhysicalTaskPtr(); }
-	auto task = std::move(m_deque.front());
-	m_deque.pop_front();
+	if(m_buckets.empty()){ return PhysicalTaskPtr(); }
+	const auto it = m_buckets.begin();
+	auto &bucket = it->second;
+	PhysicalTaskPtr task;
+	if(front){
+		task = std::move(bucket.front());
+		bucket.pop_front();
+	}else{
+		task = std::move(bucket.back());
+		bucket.pop_back();
+	}
+	if(bucket.empty()){ m_buckets.erase(it); }
+	--m_size;
+	update_highest_priority();
 	return task;
 }
 
-PhysicalTaskList::PhysicalTaskPtr PhysicalTaskList::pop_back(){
-	std::unique_lock<std::mutex> lock(m_mutex);
-	if(m_deque.empty()){ return PhysicalTaskPtr(); }
-	auto task = std::move(m_deque.back());
-	m_deque.pop_back();
-	return task;
+PhysicalTaskList::PhysicalTaskPtr PhysicalTaskList::pop_front(){
+	return pop(true);
 }
 
+PhysicalTaskList::PhysicalTaskPtr PhysicalTaskList::pop_back(){
+	return pop(false);
 }
 
+}
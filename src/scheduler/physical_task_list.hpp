@@ -17,33 +17,60 @@
 #define M3BP_SCHEDULER_PHYSICAL_TASK_LIST_HPP
 
 #include <deque>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include "m3bp/types.hpp"
 
 namespace m3bp {
 
 class PhysicalTask;
 
+/**
+ *  Thread-safe deque of tasks ordered by priorities.
+ *
+ *  Both ends of the list refer to the tasks with the highest priority.
+ *  Tasks with the same priority are kept in the order they are pushed.
+ */
 class PhysicalTaskList {
 
 public:
 	using PhysicalTaskPtr = std::shared_ptr<PhysicalTask>;
 
 private:
+	using Bucket = std::deque<PhysicalTaskPtr>;
+
 	std::mutex m_mutex;
-	std::deque<PhysicalTaskPtr> m_deque;
+	std::map<uint64_t, Bucket, std::greater<uint64_t>> m_buckets;
+	std::atomic<size_type> m_size;
+	std::atomic<uint64_t> m_highest_priority;
+
+	PhysicalTaskPtr pop(bool front);
+	void update_highest_priority() noexcept;
 
 public:
 	PhysicalTaskList();
 
-	void push_front(PhysicalTaskPtr task);
-	void push_back(PhysicalTaskPtr task);
+	void push_front(PhysicalTaskPtr task, uint64_t priority = 0);
+	void push_back(PhysicalTaskPtr task, uint64_t priority = 0);
 
 	PhysicalTaskPtr pop_front();
 	PhysicalTaskPtr pop_back();
 
 	bool empty() const noexcept {
-		return m_deque.empty();
+		return m_size.load() == 0;
+	}
+
+	/**
+	 *  Gets the priority of the tasks at both ends without locking.
+	 *
+	 *  @return the highest priority, or 0 if the list is empty.
+	 */
+	uint64_t highest_priority() const noexcept {
+		return m_highest_priority.load(std::memory_order_relaxed);
 	}
 
 };
@@ -51,4 +78,3 @@ public:
 }
 
 #endif
-
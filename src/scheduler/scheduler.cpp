@@ -13,65 +13,287 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
 #include <cassert>
+#include <limits>
+#include <stdexcept>
+#include <thread>
 #include "scheduler/scheduler.hpp"
 #include "scheduler/locality.hpp"
 #include "scheduler/locality_option.hpp"
 #include "common/random.hpp"
+#include "memory/memory_manager.hpp"
 #include "tasks/physical_task.hpp"
 #include "tasks/physical_task_command_base.hpp"
 #include "logging/general_logger.hpp"
 #include "logging/profile_logger.hpp"
 #include "logging/profile_event_logger.hpp"
 
+#ifdef M3BP_NO_THREAD_LOCAL
+#include "common/thread_specific.hpp"
+#endif
+
 #define M3BP_SCHEDULER_TRACE \
 	M3BP_GENERAL_LOG(TRACE) << "[Scheduler] [" << __func__ << "] "
 
 namespace m3bp {
 
+namespace {
+
+const identifier_type UNBOUND_WORKER =
+	std::numeric_limits<identifier_type>::max();
+
+std::atomic<uint64_t> g_next_instance_serial(1);
+
+// Vertices are allocated in segments of VERTEX_SEGMENT_SIZE and segments are
+// looked up through blocks of SEGMENT_BLOCK_SIZE slots allocated on demand
+const size_type VERTEX_SEGMENT_SIZE = (1 << 11);
+const size_type SEGMENT_BLOCK_SIZE = (1 << 11);
+const size_type MAX_SEGMENT_BLOCKS = (1 << 14);
+
+// Maps memory deltas to queue priorities so that smaller deltas come first.
+// Deltas are compared on a logarithmic scale since they are rough estimates,
+// and tasks with deltas of the same scale are ordered by their ranks.
+uint64_t memory_priority(int64_t delta, uint64_t rank) noexcept {
+	const int RANK_BITS = 56;
+	const auto bit_width = [](uint64_t x) -> uint64_t {
+		return x ? 64 - __builtin_clzll(x) : 0;
+	};
+	const auto scale = (delta < 0)
+		? 64 + bit_width(0 - static_cast<uint64_t>(delta))
+		: 64 - bit_width(static_cast<uint64_t>(delta));
+	const auto max_rank = (static_cast<uint64_t>(1) << RANK_BITS) - 1;
+	return (scale << RANK_BITS) | std::min(rank, max_rank);
+}
+
+struct WorkerBinding {
+	uint64_t owner;
+	identifier_type worker;
+
+	WorkerBinding()
+		: owner(0)
+		, worker(UNBOUND_WORKER)
+	{ }
+};
+
+WorkerBinding &thread_local_worker_binding(){
+#ifdef M3BP_NO_THREAD_LOCAL
+	static ThreadSpecific<WorkerBinding> s_ts_binding;
+	return s_ts_binding.get();
+#else
+	static thread_local WorkerBinding s_binding;
+	return s_binding;
+#endif
+}
+
+}
+
+struct Scheduler::SuccessorNode {
+	PhysicalTaskIdentifier successor;
+	SuccessorNode *next;
+};
+
 class Scheduler::PhysicalVertex {
 
 public:
+	// Marks successor lists of completed tasks
+	static SuccessorNode *closed_list() noexcept {
+		static SuccessorNode s_closed;
+		return &s_closed;
+	}
+
 	std::atomic<size_type> predecessor_count;
-	std::vector<PhysicalTaskIdentifier> successors;
+	std::atomic<SuccessorNode *> successors;
 	LocalityOption locality_option;
+	LogicalTaskIdentifier logical_task_id;
 	PhysicalTaskPtr physical_task;
+	uint64_t start_time;
 
-	PhysicalVertex(LocalityOption option, PhysicalTaskPtr task)
+	PhysicalVertex()
 		: predecessor_count(1)
-		, successors()
-		, locality_option(std::move(option))
-		, physical_task(std::move(task))
+		, successors(nullptr)
+		, locality_option()
+		, logical_task_id()
+		, physical_task()
+		, start_time(0)
 	{ }
 
+	~PhysicalVertex(){
+		auto node = successors.load();
+		if(node == closed_list()){ return; }
+		while(node){
+			const auto next = node->next;
+			delete node;
+			node = next;
+		}
+	}
+
+	/**
+	 *  Publishes a successor unless the task has been completed.
+	 */
+	bool push_successor(PhysicalTaskIdentifier successor){
+		auto node = new SuccessorNode{ successor, successors.load() };
+		while(node->next != closed_list()){
+			if(successors.compare_exchange_weak(node->next, node)){
+				return true;
+			}
+		}
+		delete node;
+		return false;
+	}
+
+	/**
+	 *  Takes all published successors and rejects later ones.
+	 */
+	SuccessorNode *close_successors() noexcept {
+		const auto head = successors.exchange(closed_list());
+		assert(head != closed_list());
+		return head;
+	}
+
+};
+
+class Scheduler::VertexSegment {
+
+public:
+	PhysicalVertex vertices[VERTEX_SEGMENT_SIZE];
+
+};
+
+class Scheduler::SegmentSlot {
+
+public:
+	// Null until the first task is created and after all tasks completed
+	std::atomic<VertexSegment *> segment;
+	// Threads reading a vertex that may be completed concurrently
+	std::atomic<size_type> reader_count;
+	std::atomic<size_type> completed_count;
+
+	SegmentSlot()
+		: segment(nullptr)
+		, reader_count(0)
+		, completed_count(0)
+	{ }
+
+	~SegmentSlot(){
+		delete segment.load();
+	}
+
+};
+
+class Scheduler::SegmentBlock {
+
+public:
+	SegmentSlot slots[SEGMENT_BLOCK_SIZE];
+
 };
 
 
 Scheduler::Scheduler()
 	: m_locality_manager()
+	, m_node_workers()
+	, m_instance_serial(g_next_instance_serial++)
 	, m_synchronizers(m_locality_manager.max_concurrency())
-	, m_stealable_queues(m_locality_manager.node_count())
+	, m_worker_deques(m_locality_manager.max_concurrency())
+	, m_injection_queues(m_locality_manager.node_count())
 	, m_unstealable_queues(m_locality_manager.max_concurrency())
-	, m_physical_graph_mutex()
-	, m_vertices()
+	, m_producer_queues(m_locality_manager.node_count())
+	, m_releasing_queues(m_locality_manager.node_count())
+	, m_idle_spin_count(0)
+	, m_idle_yield_count(0)
+	, m_critical_path(new CriticalPathEstimator())
+	, m_memory_manager(nullptr)
+	, m_pending_producer_count(0)
+	, m_running_producer_count(0)
+	, m_releasing_task_count(0)
+	, m_segment_blocks(new std::atomic<SegmentBlock *>[MAX_SEGMENT_BLOCKS]())
 	, m_created_task_count(0)
 	, m_unfinished_task_count(0)
 	, m_cancellation_manager()
-{ }
+{
+	initialize_node_workers();
+}
 
 Scheduler::Scheduler(LocalityManager locality_manager)
 	: m_locality_manager(std::move(locality_manager))
+	, m_node_workers()
+	, m_instance_serial(g_next_instance_serial++)
 	, m_synchronizers(m_locality_manager.max_concurrency())
-	, m_stealable_queues(m_locality_manager.node_count())
+	, m_worker_deques(m_locality_manager.max_concurrency())
+	, m_injection_queues(m_locality_manager.node_count())
 	, m_unstealable_queues(m_locality_manager.max_concurrency())
-	, m_physical_graph_mutex()
-	, m_vertices()
+	, m_producer_queues(m_locality_manager.node_count())
+	, m_releasing_queues(m_locality_manager.node_count())
+	, m_idle_spin_count(0)
+	, m_idle_yield_count(0)
+	, m_critical_path(new CriticalPathEstimator())
+	, m_memory_manager(nullptr)
+	, m_pending_producer_count(0)
+	, m_running_producer_count(0)
+	, m_releasing_task_count(0)
+	, m_segment_blocks(new std::atomic<SegmentBlock *>[MAX_SEGMENT_BLOCKS]())
 	, m_created_task_count(0)
 	, m_unfinished_task_count(0)
 	, m_cancellation_manager()
-{ }
+{
+	initialize_node_workers();
+}
+
+Scheduler::~Scheduler(){
+	for(size_type i = 0; i < MAX_SEGMENT_BLOCKS; ++i){
+		delete m_segment_blocks[i].load();
+	}
+}
+
+
+Scheduler::SegmentSlot &Scheduler::segment_slot(
+	PhysicalTaskIdentifier task_id) const noexcept
+{
+	const auto index = task_id.identifier() / VERTEX_SEGMENT_SIZE;
+	const auto block = m_segment_blocks[index / SEGMENT_BLOCK_SIZE].load(
+		std::memory_order_acquire);
+	assert(block);
+	return block->slots[index % SEGMENT_BLOCK_SIZE];
+}
+
+Scheduler::PhysicalVertex &Scheduler::vertex(
+	PhysicalTaskIdentifier task_id) const noexcept
+{
+	const auto segment =
+		segment_slot(task_id).segment.load(std::memory_order_acquire);
+	assert(segment);
+	return segment->vertices[task_id.identifier() % VERTEX_SEGMENT_SIZE];
+}
+
+void Scheduler::release_vertex(PhysicalTaskIdentifier task_id) noexcept {
+	auto &slot = segment_slot(task_id);
+	if(++slot.completed_count < VERTEX_SEGMENT_SIZE){ return; }
+	// All tasks in the segment have been completed
+	const auto segment = slot.segment.exchange(nullptr);
+	while(slot.reader_count.load() > 0){ std::this_thread::yield(); }
+	delete segment;
+}
+
+void Scheduler::initialize_node_workers(){
+	m_node_workers.assign(
+		m_locality_manager.node_count(), std::vector<identifier_type>());
+	const auto worker_count = m_locality_manager.max_concurrency();
+	for(identifier_type w = 0; w < worker_count; ++w){
+		m_node_workers[m_locality_manager.thread_mapping(w)].push_back(w);
+	}
+}
+
+identifier_type Scheduler::bound_worker() const noexcept {
+	const auto &binding = thread_local_worker_binding();
+	if(binding.owner != m_instance_serial){ return UNBOUND_WORKER; }
+	return binding.worker;
+}
 
-Scheduler::~Scheduler() = default;
+void Scheduler::bind_worker_thread(const Locality &locality){
+	auto &binding = thread_local_worker_binding();
+	binding.owner = m_instance_serial;
+	binding.worker = locality.self_thread_id();
+}
 
 
 void Scheduler::notify_all(){
@@ -80,17 +302,52 @@ void Scheduler::notify_all(){
 	}
 }
 
+bool Scheduler::notify_node(
+	identifier_type node, identifier_type first, bool include_parked)
+{
+	const auto &workers = m_node_workers[node];
+	const auto worker_count = workers.size();
+	for(identifier_type i = 0; i < worker_count; ++i){
+		const auto w = workers[(first + i) % worker_count];
+		if(m_synchronizers[w].notify(include_parked)){ return true; }
+	}
+	return false;
+}
+
+void Scheduler::notify_any(identifier_type first_worker){
+	// Prefer spinning workers to parked ones since they wake up without
+	// a system call, and workers near the first one to remote ones
+	const auto node_count = m_node_workers.size();
+	const auto first_node = m_locality_manager.thread_mapping(first_worker);
+	for(identifier_type i = 0; i < node_count; ++i){
+		const auto node = (first_node + i) % node_count;
+		if(notify_node(node, first_worker, false)){ return; }
+		if(notify_node(node, first_worker, true)){ return; }
+	}
+}
+
+bool Scheduler::is_memory_aware() const noexcept {
+	return m_memory_manager && m_memory_manager->memory_limit() > 0;
+}
+
+bool Scheduler::is_throttled_producer(
+	const LocalityOption &option) const noexcept
+{
+	return is_memory_aware() &&
+		option.is_memory_producer() && option.is_stealable();
+}
+
 void Scheduler::decrement_predecessor_count(PhysicalTaskIdentifier task_id){
-	std::lock_guard<std::mutex> lock(m_physical_graph_mutex);
-	auto it = m_vertices.find(task_id);
-	assert(it != m_vertices.end());
-	if(--(it->second->predecessor_count) == 0){
-		const auto &lo = it->second->locality_option;
+	auto &v = vertex(task_id);
+	if(--v.predecessor_count == 0){
+		const auto &lo = v.locality_option;
+		const auto priority =
+			m_critical_path->rank(v.logical_task_id.identifier());
 		identifier_type w = 0;
 		if(!lo.is_stealable()){
 			w = lo.recommended_worker();
 			m_unstealable_queues[w].push_back(
-				std::move(it->second->physical_task));
+				std::move(v.physical_task), priority);
 			m_synchronizers[w].notify();
 		}else{
 			const auto worker_count = m_locality_manager.max_concurrency();
@@ -101,12 +358,32 @@ void Scheduler::decrement_predecessor_count(PhysicalTaskIdentifier task_id){
 					0, worker_count - 1);
 			}
 			const auto node = m_locality_manager.thread_mapping(w);
-			m_stealable_queues[node].push_back(
-				std::move(it->second->physical_task));
-			for(identifier_type i = 0; i < worker_count; ++i){
-				const auto t = (w + i) % worker_count;
-				if(m_synchronizers[t].notify()){ break; }
+			const auto delta = is_memory_aware()
+				? v.physical_task->estimated_memory_delta()
+				: 0;
+			if(is_throttled_producer(lo)){
+				++m_pending_producer_count;
+				m_producer_queues[node].push_back(
+					std::move(v.physical_task),
+					memory_priority(delta, priority));
+			}else if(delta < 0){
+				++m_releasing_task_count;
+				m_releasing_queues[node].push_back(
+					std::move(v.physical_task),
+					memory_priority(delta, priority));
+			}else{
+				const auto self = bound_worker();
+				auto &task = v.physical_task;
+				if(self != UNBOUND_WORKER &&
+				   m_locality_manager.thread_mapping(self) == node)
+				{
+					m_worker_deques[self].push(std::move(task), priority);
+				}else{
+					m_injection_queues[node].push_back(
+						std::move(task), priority);
+				}
 			}
+			notify_any(w);
 		}
 	}
 }
@@ -130,14 +407,36 @@ PhysicalTaskIdentifier Scheduler::create_physical_task(
 			: -1)
 		<< ")";
 	event_logger.log_create_physical_task(physical_task_id, logical_task_id);
-	// create a task and a vertex
-	auto physical_task = std::make_shared<PhysicalTask>(
+	// allocate a block of slots and a segment of vertices if needed
+	const auto segment_index =
+		physical_task_id.identifier() / VERTEX_SEGMENT_SIZE;
+	const auto block_index = segment_index / SEGMENT_BLOCK_SIZE;
+	if(block_index >= MAX_SEGMENT_BLOCKS){
+		throw std::length_error("too many physical tasks");
+	}
+	auto &block = m_segment_blocks[block_index];
+	if(!block.load(std::memory_order_acquire)){
+		std::unique_ptr<SegmentBlock> created(new SegmentBlock());
+		SegmentBlock *expected = nullptr;
+		if(block.compare_exchange_strong(expected, created.get())){
+			created.release();
+		}
+	}
+	// a segment is never released before all of its tasks are created
+	auto &segment = segment_slot(physical_task_id).segment;
+	if(!segment.load(std::memory_order_acquire)){
+		std::unique_ptr<VertexSegment> created(new VertexSegment());
+		VertexSegment *expected = nullptr;
+		if(segment.compare_exchange_strong(expected, created.get())){
+			created.release();
+		}
+	}
+	// create a task and initialize the vertex
+	auto &v = vertex(physical_task_id);
+	v.locality_option = option;
+	v.logical_task_id = logical_task_id;
+	v.physical_task = std::make_shared<PhysicalTask>(
 		logical_task_id, physical_task_id, std::move(command));
-	auto vertex = PhysicalVertexPtr(
-		new PhysicalVertex(option, std::move(physical_task)));
-	// emplace to the set of vertices
-	std::lock_guard<std::mutex> lock(m_physical_graph_mutex);
-	m_vertices.emplace(physical_task_id, std::move(vertex));
 	return physical_task_id;
 }
 
@@ -149,13 +448,20 @@ Scheduler &Scheduler::add_dependency(
 	M3BP_SCHEDULER_TRACE
 		<< predecessor.identifier() << " " << successor.identifier();
 	event_logger.log_physical_dependency(predecessor, successor);
-	std::lock_guard<std::mutex> lock(m_physical_graph_mutex);
-	auto pred_it = m_vertices.find(predecessor);
-	if(pred_it == m_vertices.end()){ return *this; }
-	auto succ_it = m_vertices.find(successor);
-	assert(succ_it != m_vertices.end());
-	pred_it->second->successors.emplace_back(std::move(successor));
-	++(succ_it->second->predecessor_count);
+	// count the dependency before the predecessor can see it
+	++(vertex(successor).predecessor_count);
+	// the segment of a completed predecessor may be released concurrently
+	auto &slot = segment_slot(predecessor);
+	++slot.reader_count;
+	const auto segment = slot.segment.load();
+	const bool pushed = segment &&
+		segment->vertices[predecessor.identifier() % VERTEX_SEGMENT_SIZE]
+			.push_successor(successor);
+	--slot.reader_count;
+	if(!pushed){
+		// the predecessor has been completed
+		decrement_predecessor_count(successor);
+	}
 	return *this;
 }
 
@@ -174,18 +480,61 @@ Scheduler::take_unstealable_task(const Locality &locality){
 }
 Scheduler::PhysicalTaskPtr
 Scheduler::take_local_stealable_task(const Locality &locality){
+	const auto tid = locality.self_thread_id();
 	const auto nid = locality.self_node_id();
-	auto task = m_stealable_queues[nid].pop_back();
+	const bool is_bound = (bound_worker() == tid);
+	auto &injection_queue = m_injection_queues[nid];
+	PhysicalTaskPtr task;
+	// Tasks in the own deque are taken newest first for cache locality
+	// unless the shared queue has a task on a longer critical path
+	if(is_bound && m_worker_deques[tid].bottom_priority() >=
+	                   injection_queue.highest_priority())
+	{
+		task = m_worker_deques[tid].take();
+	}
+	if(!task){ task = injection_queue.pop_back(); }
+	if(!task && is_bound){ task = m_worker_deques[tid].take(); }
 	if(task){ M3BP_SCHEDULER_TRACE << task->physical_task_id().identifier(); }
 	return task;
 }
 Scheduler::PhysicalTaskPtr
 Scheduler::steal_task(const Locality &locality){
-	const auto node_count = m_stealable_queues.size();
+	// Steal from the nearest node first
+	const auto node_count = m_injection_queues.size();
+	const auto tid = locality.self_thread_id();
 	const auto nid = locality.self_node_id();
 	for(identifier_type i = 0; i < node_count; ++i){
 		const auto t = (nid + i) % node_count;
-		auto task = m_stealable_queues[t].pop_front();
+		const auto &workers = m_node_workers[t];
+		const auto worker_count = workers.size();
+		// Choose the oldest task on the longest critical path
+		identifier_type best_victim = UNBOUND_WORKER;
+		uint64_t best_priority = 0;
+		for(identifier_type j = 0; j < worker_count; ++j){
+			const auto victim = workers[(tid + j) % worker_count];
+			if(m_worker_deques[victim].empty()){ continue; }
+			const auto priority = m_worker_deques[victim].top_priority();
+			if(best_victim == UNBOUND_WORKER || priority > best_priority){
+				best_victim = victim;
+				best_priority = priority;
+			}
+		}
+		PhysicalTaskPtr task;
+		if(best_victim == UNBOUND_WORKER ||
+		   m_injection_queues[t].highest_priority() >= best_priority)
+		{
+			task = m_injection_queues[t].pop_front();
+		}
+		if(!task && best_victim != UNBOUND_WORKER){
+			task = m_worker_deques[best_victim].steal();
+		}
+		// Fall back to the others if the chosen ones have been emptied
+		if(!task){ task = m_injection_queues[t].pop_front(); }
+		for(identifier_type j = 0; !task && j < worker_count; ++j){
+			const auto victim = workers[(tid + j) % worker_count];
+			if(m_worker_deques[victim].empty()){ continue; }
+			task = m_worker_deques[victim].steal();
+		}
 		if(task){
 			M3BP_SCHEDULER_TRACE << task->physical_task_id().identifier();
 			return task;
@@ -193,21 +542,93 @@ Scheduler::steal_task(const Locality &locality){
 	}
 	return PhysicalTaskPtr();
 }
+Scheduler::PhysicalTaskPtr
+Scheduler::take_producer_task(const Locality &locality){
+	if(m_pending_producer_count.load() == 0){ return PhysicalTaskPtr(); }
+	// Allow only one producer under memory pressure to guarantee progress
+	if(m_memory_manager->is_memory_pressured() &&
+	   m_running_producer_count.load() > 0)
+	{
+		return PhysicalTaskPtr();
+	}
+	const auto node_count = m_producer_queues.size();
+	const auto nid = locality.self_node_id();
+	for(identifier_type i = 0; i < node_count; ++i){
+		const auto t = (nid + i) % node_count;
+		auto task = (i == 0)
+			? m_producer_queues[t].pop_back()
+			: m_producer_queues[t].pop_front();
+		if(task){
+			M3BP_SCHEDULER_TRACE << task->physical_task_id().identifier();
+			--m_pending_producer_count;
+			++m_running_producer_count;
+			return task;
+		}
+	}
+	return PhysicalTaskPtr();
+}
+Scheduler::PhysicalTaskPtr
+Scheduler::take_releasing_task(const Locality &locality, bool remote){
+	if(m_releasing_task_count.load() == 0){ return PhysicalTaskPtr(); }
+	const auto node_count = remote ? m_releasing_queues.size() : 1;
+	const auto nid = locality.self_node_id();
+	for(identifier_type i = 0; i < node_count; ++i){
+		const auto t = (nid + i) % m_releasing_queues.size();
+		if(m_releasing_queues[t].empty()){ continue; }
+		auto task = m_releasing_queues[t].pop_front();
+		if(task){
+			M3BP_SCHEDULER_TRACE << task->physical_task_id().identifier();
+			--m_releasing_task_count;
+			return task;
+		}
+	}
+	return PhysicalTaskPtr();
+}
 
 
 Scheduler::PhysicalTaskPtr
 Scheduler::take_runnable_task(const Locality &locality){
+	auto task = find_runnable_task(locality);
+	if(task){
+		vertex(task->physical_task_id()).start_time =
+			SchedulerSynchronizer::current_time();
+	}
+	return task;
+}
+
+Scheduler::PhysicalTaskPtr
+Scheduler::find_runnable_task(const Locality &locality){
 	const auto tid = locality.self_thread_id();
 	PhysicalTaskPtr task;
 	// try to take an unstealable task
 	task = take_unstealable_task(locality);
 	if(task){ return task; }
+	// try to release memory first if the usage is near the limit
+	const bool pressured =
+		m_memory_manager && m_memory_manager->is_memory_pressured();
+	if(pressured){
+		task = take_releasing_task(locality, true);
+		if(task){ return task; }
+	}
 	// try to take a local stealable task
 	task = take_local_stealable_task(locality);
 	if(task){ return task; }
+	// try to take a task releasing memory on the local node
+	if(!pressured){
+		task = take_releasing_task(locality, false);
+		if(task){ return task; }
+	}
 	// try to steal an task
 	task = steal_task(locality);
 	if(task){ return task; }
+	// try to take a task releasing memory on the other nodes
+	if(!pressured){
+		task = take_releasing_task(locality, true);
+		if(task){ return task; }
+	}
+	// try to take a producer task
+	task = take_producer_task(locality);
+	if(task){ return task; }
 	// attempt to sleep
 	auto &sync = m_synchronizers[tid];
 	while(true){
@@ -216,11 +637,22 @@ Scheduler::take_runnable_task(const Locality &locality){
 		// try to take an unstealable task
 		task = take_unstealable_task(locality);
 		if(task){ break; }
+		// try to take a task releasing memory
+		task = take_releasing_task(locality, true);
+		if(task){ break; }
 		// try to steal an task
 		task = steal_task(locality);
 		if(task){ break; }
+		// try to take a producer task
+		task = take_producer_task(locality);
+		if(task){ break; }
 		// wait for new task
-		sync.wait();
+		const auto idle_begin = SchedulerSynchronizer::current_time();
+		const auto parked = sync.wait(m_idle_spin_count, m_idle_yield_count);
+		const auto idle_end = SchedulerSynchronizer::current_time();
+		const auto notify_time = std::max(idle_begin, sync.notify_time());
+		ProfileLogger::thread_local_logger().log_wake_up(
+			idle_end - idle_begin, idle_end - notify_time, parked);
 	}
 	sync.reset_is_sleeping();
 	return task;
@@ -230,17 +662,23 @@ void Scheduler::notify_task_completion(
 	PhysicalTaskIdentifier physical_task_id)
 {
 	M3BP_SCHEDULER_TRACE << physical_task_id.identifier();
-	std::vector<PhysicalTaskIdentifier> successors;
-	{
-		std::lock_guard<std::mutex> lock(m_physical_graph_mutex);
-		auto it = m_vertices.find(physical_task_id);
-		assert(it != m_vertices.end());
-		successors = std::move(it->second->successors);
-		m_vertices.erase(it);
+	auto &v = vertex(physical_task_id);
+	if(is_throttled_producer(v.locality_option)){ --m_running_producer_count; }
+	if(v.start_time > 0){
+		m_critical_path->record(
+			v.logical_task_id.identifier(),
+			SchedulerSynchronizer::current_time() - v.start_time);
 	}
-	for(const auto &succ_id : successors){
-		decrement_predecessor_count(succ_id);
+	auto node = v.close_successors();
+	while(node){
+		const auto next = node->next;
+		decrement_predecessor_count(node->successor);
+		delete node;
+		node = next;
 	}
+	release_vertex(physical_task_id);
+	// Held back producers may be runnable after memory is released
+	if(m_pending_producer_count.load() > 0){ notify_any(0); }
 	const auto remains = --m_unfinished_task_count;
 	if(remains == 0){
 		notify_all();
@@ -17,10 +17,13 @@
 #define M3BP_SCHEDULER_SCHEDULER_HPP
 
 #include <vector>
-#include <unordered_map>
+#include <memory>
 #include <atomic>
+#include <cstdint>
 #include "common/noncopyable_vector.hpp"
 #include "scheduler/physical_task_list.hpp"
+#include "scheduler/work_stealing_deque.hpp"
+#include "scheduler/critical_path_estimator.hpp"
 #include "scheduler/locality_manager.hpp"
 #include "scheduler/cancellation_manager.hpp"
 #include "scheduler/scheduler_synchronizer.hpp"
@@ -33,6 +36,7 @@ class PhysicalTask;
 class PhysicalTaskCommandBase;
 class Locality;
 class LocalityOption;
+class MemoryManager;
 
 class Scheduler {
 
@@ -41,28 +45,70 @@ public:
 
 private:
 	class PhysicalVertex;
-	using PhysicalVertexPtr = std::unique_ptr<PhysicalVertex>;
+	class VertexSegment;
+	class SegmentSlot;
+	class SegmentBlock;
+	struct SuccessorNode;
 
 	LocalityManager m_locality_manager;
+	std::vector<std::vector<identifier_type>> m_node_workers;
+
+	// Distinguishes thread-local worker bindings of each instance
+	uint64_t m_instance_serial;
 
 	NoncopyableVector<SchedulerSynchronizer> m_synchronizers;
-	NoncopyableVector<PhysicalTaskList> m_stealable_queues;
+	// Stealable tasks made runnable by bound workers
+	NoncopyableVector<WorkStealingDeque> m_worker_deques;
+	// Stealable tasks made runnable by other threads or for other nodes
+	NoncopyableVector<PhysicalTaskList> m_injection_queues;
 	NoncopyableVector<PhysicalTaskList> m_unstealable_queues;
+	NoncopyableVector<PhysicalTaskList> m_producer_queues;
+	// Stealable tasks estimated to release memory, most releasing first and
+	// then on the longest critical path first
+	NoncopyableVector<PhysicalTaskList> m_releasing_queues;
+
+	size_type m_idle_spin_count;
+	size_type m_idle_yield_count;
+
+	std::unique_ptr<CriticalPathEstimator> m_critical_path;
+
+	const MemoryManager *m_memory_manager;
+	std::atomic<size_type> m_pending_producer_count;
+	std::atomic<size_type> m_running_producer_count;
+	// Lets workers skip the releasing queues while all of them are empty
+	std::atomic<size_type> m_releasing_task_count;
 
-	std::mutex m_physical_graph_mutex;
-	std::unordered_map<PhysicalTaskIdentifier, PhysicalVertexPtr> m_vertices;
+	// Vertices are indexed by physical task IDs and never move, and each
+	// segment of them is released when all of its tasks have been completed
+	std::unique_ptr<std::atomic<SegmentBlock *>[]> m_segment_blocks;
 
 	std::atomic<size_type> m_created_task_count;
 	std::atomic<size_type> m_unfinished_task_count;
 
 	CancellationManager m_cancellation_manager;
 
+	void initialize_node_workers();
+	SegmentSlot &segment_slot(PhysicalTaskIdentifier task_id) const noexcept;
+	PhysicalVertex &vertex(PhysicalTaskIdentifier task_id) const noexcept;
+	void release_vertex(PhysicalTaskIdentifier task_id) noexcept;
+
+	identifier_type bound_worker() const noexcept;
+
 	void notify_all();
+	bool notify_node(
+		identifier_type node, identifier_type first, bool include_parked);
+	void notify_any(identifier_type first_worker);
 	void decrement_predecessor_count(PhysicalTaskIdentifier task_id);
 
+	bool is_memory_aware() const noexcept;
+	bool is_throttled_producer(const LocalityOption &option) const noexcept;
+
 	PhysicalTaskPtr take_unstealable_task(const Locality &locality);
 	PhysicalTaskPtr take_local_stealable_task(const Locality &locality);
 	PhysicalTaskPtr steal_task(const Locality &locality);
+	PhysicalTaskPtr take_producer_task(const Locality &locality);
+	PhysicalTaskPtr take_releasing_task(const Locality &locality, bool remote);
+	PhysicalTaskPtr find_runnable_task(const Locality &locality);
 
 public:
 	Scheduler();
@@ -72,6 +118,61 @@ public:
 
 	Scheduler &operator=(const Scheduler &) = delete;
 
+	/**
+	 *  Sets the memory manager that is used to throttle producer tasks.
+	 *
+	 *  Stealable tasks marked by LocalityOption::memory_producer() are
+	 *  taken after other runnable tasks, and at most one of them runs at a
+	 *  time while the memory usage is near the limit. Stealable tasks
+	 *  whose PhysicalTask::estimated_memory_delta() is negative are taken
+	 *  before any other tasks while the memory usage is near the limit.
+	 *  Both are ordered by the estimate.
+	 */
+	Scheduler &memory_manager(const MemoryManager *memory_manager){
+		m_memory_manager = memory_manager;
+		return *this;
+	}
+
+	/**
+	 *  Marks the calling thread as the worker of the given locality.
+	 *
+	 *  Stealable tasks that become runnable on a bound worker are pushed to
+	 *  its own deque when they are placed on its node. Each worker must be
+	 *  bound to at most one thread.
+	 */
+	void bind_worker_thread(const Locality &locality);
+
+	/**
+	 *  Sets how idle workers wait for new tasks.
+	 *
+	 *  An idle worker polls for a notification spin_count times with a
+	 *  pause instruction, then yield_count times with yielding the
+	 *  processor, and finally blocks on a condition variable.
+	 */
+	Scheduler &idle_policy(size_type spin_count, size_type yield_count){
+		m_idle_spin_count = spin_count;
+		m_idle_yield_count = yield_count;
+		return *this;
+	}
+
+	/**
+	 *  Sets the dependencies between logical tasks.
+	 *
+	 *  Runnable tasks in shared queues are served from ones whose logical
+	 *  tasks are on the longest remaining path of the logical graph, so
+	 *  that long branches are started early. This must be called before
+	 *  any physical tasks are created.
+	 *
+	 *  @param[in] successors  The list of successors of each logical task.
+	 */
+	Scheduler &logical_successors(
+		std::vector<std::vector<identifier_type>> successors)
+	{
+		m_critical_path.reset(
+			new CriticalPathEstimator(std::move(successors)));
+		return *this;
+	}
+
 	PhysicalTaskIdentifier create_physical_task(
 		LogicalTaskIdentifier logical_task_id,
 		std::unique_ptr<PhysicalTaskCommandBase> command,
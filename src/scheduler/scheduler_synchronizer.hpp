@@ -19,48 +19,130 @@
 #include <memory>
 #include <atomic>
 #include <mutex>
+#include <thread>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include "m3bp/types.hpp"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
 namespace m3bp {
 
 class SchedulerSynchronizer {
 
 private:
-	std::atomic<bool> m_is_sleeping;
+	enum State : int {
+		RUNNING,
+		SPINNING,
+		PARKED
+	};
+
+	std::atomic<int> m_state;
+	std::atomic<uint64_t> m_notify_time;
 	std::condition_variable m_sleep_condvar;
 	std::mutex m_sleep_mutex;
 
+	static void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+		_mm_pause();
+#elif defined(__aarch64__)
+		__asm__ __volatile__("yield");
+#endif
+	}
+
 public:
 	SchedulerSynchronizer()
-		: m_is_sleeping(false)
+		: m_state(RUNNING)
+		, m_notify_time(0)
 		, m_sleep_condvar()
 		, m_sleep_mutex()
 	{ }
 
+	/**
+	 *  Gets a monotonic timestamp in nanoseconds.
+	 */
+	static uint64_t current_time() noexcept {
+		const auto tp = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			tp.time_since_epoch()).count();
+	}
+
 	void set_is_sleeping(){
-		m_is_sleeping.store(true);
+		m_state.store(SPINNING);
+		// Pairs with the fence in WorkStealingDeque::push(): the caller
+		// checks the queues again after this and finds a pushed task, or
+		// the pusher finds this state and notifies
+		std::atomic_thread_fence(std::memory_order_seq_cst);
 	}
 	void reset_is_sleeping(){
-		m_is_sleeping.store(false);
+		m_state.store(RUNNING);
 	}
 
-	bool notify(){
-		if(!m_is_sleeping.load()){ return false; }
+	/**
+	 *  Gets the time when the last notification was delivered.
+	 */
+	uint64_t notify_time() const noexcept {
+		return m_notify_time.load();
+	}
+
+	/**
+	 *  Wakes up the sleeping thread.
+	 *
+	 *  @param[in] include_parked  @c false if threads that are blocked on
+	 *                             the condition variable should be skipped.
+	 *  @return    @c true if the thread has been woken up by this call.
+	 */
+	bool notify(bool include_parked = true){
+		int state = m_state.load();
+		while(state == SPINNING){
+			m_notify_time.store(current_time());
+			if(m_state.compare_exchange_weak(state, RUNNING)){ return true; }
+		}
+		if(state != PARKED || !include_parked){ return false; }
 		{
 			std::unique_lock<std::mutex> lock(m_sleep_mutex);
-			if(!m_is_sleeping.load()){ return false; }
-			m_is_sleeping.store(false);
+			if(m_state.load() != PARKED){ return false; }
+			m_notify_time.store(current_time());
+			m_state.store(RUNNING);
 		}
 		m_sleep_condvar.notify_one();
 		return true;
 	}
 
-	void wait(){
+	/**
+	 *  Waits for a notification after set_is_sleeping() is called.
+	 *
+	 *  The thread polls the state spin_count times with a pause instruction
+	 *  and yield_count times with yielding the processor before it blocks
+	 *  on the condition variable.
+	 *
+	 *  @return @c true if the thread has been blocked.
+	 */
+	bool wait(size_type spin_count, size_type yield_count){
+		for(size_type i = 0; i < spin_count; ++i){
+			if(m_state.load(std::memory_order_relaxed) != SPINNING){
+				return false;
+			}
+			cpu_relax();
+		}
+		for(size_type i = 0; i < yield_count; ++i){
+			if(m_state.load(std::memory_order_relaxed) != SPINNING){
+				return false;
+			}
+			std::this_thread::yield();
+		}
 		std::unique_lock<std::mutex> lock(m_sleep_mutex);
+		int expected = SPINNING;
+		if(!m_state.compare_exchange_strong(expected, PARKED)){
+			return false;
+		}
 		m_sleep_condvar.wait(lock, [this]() -> bool {
-			return !m_is_sleeping.load();
+			return m_state.load() != PARKED;
 		});
+		return true;
 	}
 
 };
@@ -68,4 +150,3 @@ public:
 }
 
 #endif
-
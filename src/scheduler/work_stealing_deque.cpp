@@ -0,0 +1,183 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cassert>
+#include "tasks/physical_task.hpp"
+#include "scheduler/work_stealing_deque.hpp"
+
+namespace m3bp {
+
+namespace {
+
+const size_type INITIAL_CAPACITY = 64;
+
+}
+
+// Tasks are boxed since std::shared_ptr cannot be accessed atomically
+class WorkStealingDeque::Buffer {
+
+private:
+	size_type m_capacity;
+	std::unique_ptr<std::atomic<PhysicalTaskPtr *>[]> m_slots;
+	std::unique_ptr<std::atomic<uint64_t>[]> m_priorities;
+
+public:
+	explicit Buffer(size_type capacity)
+		: m_capacity(capacity)
+		, m_slots(new std::atomic<PhysicalTaskPtr *>[capacity])
+		, m_priorities(new std::atomic<uint64_t>[capacity])
+	{
+		assert((capacity & (capacity - 1)) == 0);
+	}
+
+	size_type capacity() const noexcept {
+		return m_capacity;
+	}
+
+	PhysicalTaskPtr *get(int64_t i) const noexcept {
+		const auto mask = m_capacity - 1;
+		const auto &slot = m_slots[static_cast<size_type>(i) & mask];
+		return slot.load(std::memory_order_relaxed);
+	}
+
+	uint64_t priority(int64_t i) const noexcept {
+		const auto mask = m_capacity - 1;
+		const auto &slot = m_priorities[static_cast<size_type>(i) & mask];
+		return slot.load(std::memory_order_relaxed);
+	}
+
+	void put(int64_t i, PhysicalTaskPtr *box, uint64_t priority) noexcept {
+		const auto mask = m_capacity - 1;
+		const auto index = static_cast<size_type>(i) & mask;
+		m_slots[index].store(box, std::memory_order_relaxed);
+		m_priorities[index].store(priority, std::memory_order_relaxed);
+	}
+
+};
+
+
+WorkStealingDeque::WorkStealingDeque()
+	: m_top(0)
+	, m_bottom(0)
+	, m_buffer(nullptr)
+	, m_buffers()
+{
+	m_buffers.emplace_back(new Buffer(INITIAL_CAPACITY));
+	m_buffer.store(m_buffers.back().get());
+}
+
+WorkStealingDeque::~WorkStealingDeque(){
+	const auto buffer = m_buffer.load();
+	const auto bottom = m_bottom.load();
+	for(auto i = m_top.load(); i < bottom; ++i){
+		delete buffer->get(i);
+	}
+}
+
+
+WorkStealingDeque::Buffer *WorkStealingDeque::grow(
+	Buffer *buffer, int64_t top, int64_t bottom)
+{
+	std::unique_ptr<Buffer> grown(new Buffer(buffer->capacity() * 2));
+	for(auto i = top; i < bottom; ++i){
+		grown->put(i, buffer->get(i), buffer->priority(i));
+	}
+	const auto ptr = grown.get();
+	m_buffers.emplace_back(std::move(grown));
+	m_buffer.store(ptr, std::memory_order_release);
+	return ptr;
+}
+
+
+void WorkStealingDeque::push(PhysicalTaskPtr task, uint64_t priority){
+	assert(task);
+	const auto bottom = m_bottom.load(std::memory_order_relaxed);
+	const auto top = m_top.load(std::memory_order_acquire);
+	auto buffer = m_buffer.load(std::memory_order_relaxed);
+	if(bottom - top >= static_cast<int64_t>(buffer->capacity())){
+		buffer = grow(buffer, top, bottom);
+	}
+	buffer->put(bottom, new PhysicalTaskPtr(std::move(task)), priority);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	// Orders the publication before the caller reads the state of idle
+	// workers to notify them; otherwise a worker going to sleep may miss
+	// both this task and the notification
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+WorkStealingDeque::PhysicalTaskPtr WorkStealingDeque::take(){
+	const auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	const auto buffer = m_buffer.load(std::memory_order_relaxed);
+	m_bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	auto top = m_top.load(std::memory_order_relaxed);
+	if(top > bottom){
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return PhysicalTaskPtr();
+	}
+	auto box = buffer->get(bottom);
+	if(top == bottom){
+		// Races with thieves for the last task
+		if(!m_top.compare_exchange_strong(
+			top, top + 1,
+			std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			box = nullptr;
+		}
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+	if(!box){ return PhysicalTaskPtr(); }
+	PhysicalTaskPtr task(std::move(*box));
+	delete box;
+	return task;
+}
+
+WorkStealingDeque::PhysicalTaskPtr WorkStealingDeque::steal(){
+	while(true){
+		auto top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const auto bottom = m_bottom.load(std::memory_order_acquire);
+		if(top >= bottom){ return PhysicalTaskPtr(); }
+		const auto buffer = m_buffer.load(std::memory_order_acquire);
+		const auto box = buffer->get(top);
+		if(m_top.compare_exchange_strong(
+			top, top + 1,
+			std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			PhysicalTaskPtr task(std::move(*box));
+			delete box;
+			return task;
+		}
+		// Another thread has taken the task; retry with the next one
+	}
+}
+
+
+uint64_t WorkStealingDeque::bottom_priority() const noexcept {
+	const auto bottom = m_bottom.load(std::memory_order_relaxed);
+	const auto top = m_top.load(std::memory_order_acquire);
+	if(top >= bottom){ return 0; }
+	return m_buffer.load(std::memory_order_relaxed)->priority(bottom - 1);
+}
+
+uint64_t WorkStealingDeque::top_priority() const noexcept {
+	const auto top = m_top.load(std::memory_order_acquire);
+	const auto bottom = m_bottom.load(std::memory_order_acquire);
+	if(top >= bottom){ return 0; }
+	return m_buffer.load(std::memory_order_acquire)->priority(top);
+}
+
+}
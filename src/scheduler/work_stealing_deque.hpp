@@ -0,0 +1,97 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef M3BP_SCHEDULER_WORK_STEALING_DEQUE_HPP
+#define M3BP_SCHEDULER_WORK_STEALING_DEQUE_HPP
+
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include "m3bp/types.hpp"
+
+namespace m3bp {
+
+class PhysicalTask;
+
+/**
+ *  Lock-free deque of tasks owned by a worker thread (Chase-Lev deque).
+ *
+ *  Only the owner may call push(), take() and bottom_priority(), which work
+ *  on the bottom end. Other threads steal tasks from the top end with
+ *  steal(). Tasks are kept in the order they are pushed regardless of their
+ *  priorities; priorities only let callers compare the ends of the deque
+ *  with other queues.
+ */
+class WorkStealingDeque {
+
+public:
+	using PhysicalTaskPtr = std::shared_ptr<PhysicalTask>;
+
+private:
+	class Buffer;
+
+	static const std::size_t CACHE_LINE_SIZE = 64;
+
+	// Paddings keep thieves and the owner off each other's cache lines
+	// and those of adjacent deques, without over-aligned allocation
+	char m_top_padding[CACHE_LINE_SIZE];
+	std::atomic<int64_t> m_top;
+	char m_bottom_padding[CACHE_LINE_SIZE - sizeof(std::atomic<int64_t>)];
+	std::atomic<int64_t> m_bottom;
+	std::atomic<Buffer *> m_buffer;
+	// Replaced buffers may still be read by thieves
+	std::vector<std::unique_ptr<Buffer>> m_buffers;
+	char m_tail_padding[CACHE_LINE_SIZE];
+
+	Buffer *grow(Buffer *buffer, int64_t top, int64_t bottom);
+
+public:
+	WorkStealingDeque();
+	WorkStealingDeque(const WorkStealingDeque &) = delete;
+	~WorkStealingDeque();
+
+	WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+	void push(PhysicalTaskPtr task, uint64_t priority = 0);
+	PhysicalTaskPtr take();
+	PhysicalTaskPtr steal();
+
+	/**
+	 *  Gets the priority of the task take() would return.
+	 *
+	 *  @return the priority, or 0 if the deque is empty.
+	 */
+	uint64_t bottom_priority() const noexcept;
+
+	/**
+	 *  Gets the priority of the task steal() would return.
+	 *
+	 *  The result may be outdated by concurrent operations.
+	 *
+	 *  @return the priority, or 0 if the deque is empty.
+	 */
+	uint64_t top_priority() const noexcept;
+
+	bool empty() const noexcept {
+		return m_bottom.load(std::memory_order_acquire) <=
+			m_top.load(std::memory_order_acquire);
+	}
+
+};
+
+}
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdexcept>
+#include <system_error>
+#include <new>
+#include <cstdint>
+#include <cassert>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "system/mapped_file.hpp"
+
+namespace m3bp {
+
+namespace {
+
+size_type page_size(){
+	static const size_type s_page_size = sysconf(_SC_PAGESIZE);
+	return s_page_size;
+}
+
+inline size_type page_ceil(size_type x){
+	const auto page = page_size();
+	return (x + page - 1) / page * page;
+}
+
+}
+
+MappedFile::MappedFile(const std::string &path)
+	: m_fd(-1)
+	, m_size(0)
+{
+	m_fd = open(path.c_str(), O_RDONLY);
+	if(m_fd < 0){
+		throw std::system_error(
+			errno, std::system_category(), "failed to open " + path);
+	}
+	struct stat st;
+	if(fstat(m_fd, &st) != 0){
+		const auto err = errno;
+		close(m_fd);
+		throw std::system_error(
+			err, std::system_category(), "failed to stat " + path);
+	}
+	m_size = static_cast<size_type>(st.st_size);
+}
+
+MappedFile::~MappedFile(){
+	if(m_fd >= 0){ close(m_fd); }
+}
+
+
+void MappedFile::read(void *ptr, size_type length, size_type offset) const {
+	auto p = static_cast<char *>(ptr);
+	while(length > 0){
+		const auto count = pread(m_fd, p, length, offset);
+		if(count < 0){
+			if(errno == EINTR){ continue; }
+			throw std::system_error(
+				errno, std::system_category(),
+				"failed to read from a mapped file");
+		}else if(count == 0){
+			throw std::runtime_error("unexpected end of a mapped file");
+		}
+		p += count;
+		offset += count;
+		length -= count;
+	}
+}
+
+
+MappedFile::Region MappedFile::map(
+	size_type offset,
+	size_type length,
+	size_type head_size,
+	size_type tail_size) const
+{
+	const auto page = page_size();
+	assert(head_size <= page);
+	assert(offset + length <= m_size);
+	// The first page is kept for the head margin, and the file is mapped
+	// from the page boundary preceding the offset
+	const auto file_head = offset / page * page;
+	const auto leading = offset - file_head;
+	const auto mapping_length =
+		page + page_ceil(leading + length + tail_size);
+	const int prot = PROT_READ | PROT_WRITE;
+	auto base = mmap(
+		nullptr, mapping_length, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(base == MAP_FAILED){ throw std::bad_alloc(); }
+	const auto base_u8 = static_cast<uint8_t *>(base);
+	if(length > 0){
+		// Pages past the end of the file are not mapped since accessing
+		// them raises SIGBUS; the anonymous pages are left there instead
+		const auto file_length = page_ceil(leading + length);
+		const auto mapped = mmap(
+			base_u8 + page, file_length, prot, MAP_PRIVATE | MAP_FIXED,
+			m_fd, file_head);
+		if(mapped == MAP_FAILED){
+			const auto err = errno;
+			munmap(base, mapping_length);
+			throw std::system_error(
+				err, std::system_category(), "failed to map a file");
+		}
+		madvise(mapped, file_length, MADV_SEQUENTIAL);
+	}
+	Region region;
+	region.mapping = base;
+	region.mapping_length = mapping_length;
+	region.pointer = base_u8 + page + leading - head_size;
+	return region;
+}
+
+void MappedFile::unmap(const Region &region) noexcept {
+	munmap(region.mapping, region.mapping_length);
+}
+
+}
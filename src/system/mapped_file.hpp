@@ -0,0 +1,82 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef M3BP_SYSTEM_MAPPED_FILE_HPP
+#define M3BP_SYSTEM_MAPPED_FILE_HPP
+
+#include <string>
+#include "m3bp/types.hpp"
+
+namespace m3bp {
+
+/**
+ *  A read-only file whose regions are mapped into memory.
+ *
+ *  Regions are mapped privately, so the mapped bytes can be modified
+ *  without changing the file.
+ */
+class MappedFile {
+
+public:
+	struct Region {
+		void *mapping;
+		size_type mapping_length;
+		void *pointer;
+	};
+
+private:
+	int m_fd;
+	size_type m_size;
+
+public:
+	explicit MappedFile(const std::string &path);
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	~MappedFile();
+
+	size_type size() const noexcept {
+		return m_size;
+	}
+
+	void read(void *ptr, size_type length, size_type offset) const;
+
+	/**
+	 *  Maps a region of the file with writable margins around it.
+	 *
+	 *  The returned pointer is followed by head_size writable bytes, the
+	 *  contents of the file in [offset, offset + length) and tail_size
+	 *  writable bytes. Contents of the margins are unspecified.
+	 *
+	 *  @param[in] offset     The head of the region in the file.
+	 *  @param[in] length     The length of the region.
+	 *  @param[in] head_size  The size of the margin before the region. It
+	 *                        must not exceed the page size.
+	 *  @param[in] tail_size  The size of the margin after the region.
+	 */
+	Region map(
+		size_type offset,
+		size_type length,
+		size_type head_size,
+		size_type tail_size) const;
+
+	static void unmap(const Region &region) noexcept;
+
+};
+
+}
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vector>
+#include <stdexcept>
+#include <system_error>
+#include <cerrno>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include "system/scratch_file.hpp"
+
+namespace m3bp {
+
+ScratchFile::ScratchFile(const std::string &directory)
+	: m_fd(-1)
+	, m_size(0)
+{
+	const std::string pattern = directory + "/m3bp-scratch-XXXXXX";
+	std::vector<char> path(pattern.begin(), pattern.end());
+	path.push_back('\0');
+	m_fd = mkstemp(path.data());
+	if(m_fd < 0){
+		throw std::system_error(
+			errno, std::system_category(),
+			"failed to create a scratch file in " + directory);
+	}
+	unlink(path.data());
+}
+
+ScratchFile::~ScratchFile(){
+	if(m_fd >= 0){ close(m_fd); }
+}
+
+
+size_type ScratchFile::append(const void *ptr, size_type length){
+	const auto offset = reserve(length);
+	write(ptr, length, offset);
+	return offset;
+}
+
+void ScratchFile::write(const void *ptr, size_type length, size_type offset){
+	auto p = static_cast<const char *>(ptr);
+	while(length > 0){
+		const auto written = pwrite(m_fd, p, length, offset);
+		if(written < 0){
+			if(errno == EINTR){ continue; }
+			throw std::system_error(
+				errno, std::system_category(),
+				"failed to write to a scratch file");
+		}
+		p += written;
+		offset += written;
+		length -= written;
+	}
+}
+
+void ScratchFile::read(void *ptr, size_type length, size_type offset) const {
+	auto p = static_cast<char *>(ptr);
+	while(length > 0){
+		const auto count = pread(m_fd, p, length, offset);
+		if(count < 0){
+			if(errno == EINTR){ continue; }
+			throw std::system_error(
+				errno, std::system_category(),
+				"failed to read from a scratch file");
+		}else if(count == 0){
+			throw std::runtime_error("unexpected end of a scratch file");
+		}
+		p += count;
+		offset += count;
+		length -= count;
+	}
+}
+
+void ScratchFile::discard(size_type length, size_type offset) noexcept {
+#ifdef FALLOC_FL_PUNCH_HOLE
+	fallocate(
+		m_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length);
+#else
+	(void)(length);
+	(void)(offset);
+#endif
+}
+
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef M3BP_SYSTEM_SCRATCH_FILE_HPP
+#define M3BP_SYSTEM_SCRATCH_FILE_HPP
+
+#include <string>
+#include <atomic>
+#include "m3bp/types.hpp"
+
+namespace m3bp {
+
+/**
+ *  An anonymous temporary file to store data that does not fit in memory.
+ *
+ *  The file is unlinked immediately after creation, so it is removed by the
+ *  operating system when it is closed. Writers reserve disjoint regions by
+ *  reserve() or append() and they can be written and read concurrently.
+ */
+class ScratchFile {
+
+private:
+	int m_fd;
+	std::atomic<size_type> m_size;
+
+public:
+	explicit ScratchFile(const std::string &directory);
+
+	ScratchFile(const ScratchFile &) = delete;
+	ScratchFile &operator=(const ScratchFile &) = delete;
+
+	~ScratchFile();
+
+	size_type size() const noexcept {
+		return m_size.load();
+	}
+
+	size_type reserve(size_type length) noexcept {
+		return m_size.fetch_add(length);
+	}
+
+	size_type append(const void *ptr, size_type length);
+
+	void write(const void *ptr, size_type length, size_type offset);
+	void read(void *ptr, size_type length, size_type offset) const;
+
+	/**
+	 *  Releases disk blocks of a region that will not be read anymore.
+	 *
+	 *  The region is not reused by reserve(). This is only a hint and does
+	 *  nothing on file systems that cannot punch holes.
+	 */
+	void discard(size_type length, size_type offset) noexcept;
+
+};
+
+}
+
+#endif
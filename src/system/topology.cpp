@@ -16,6 +16,7 @@
 #include <stdexcept>
 #include <thread>
 #include <atomic>
+#include <sys/mman.h>
 #include "system/topology.hpp"
 #include "logging/general_logger.hpp"
 
@@ -26,8 +27,14 @@
 namespace m3bp {
 namespace {
 
+static const size_type HUGE_PAGE_SIZE = (2 << 20);
+
 #ifdef M3BP_LOCALITY_ENABLED
 
+// Smaller areas are allocated by malloc because hwloc_alloc_membind maps
+// pages for each allocation.
+static const size_type MEMBIND_THRESHOLD = (64 << 10);
+
 #ifdef M3BP_NO_THREAD_LOCAL
 static ThreadSpecific<identifier_type> g_ts_binded_node;
 #else
@@ -109,6 +116,11 @@ Topology::Topology()
 	, m_available_processing_units(enumerate_processing_units(m_topology))
 	, m_available_numa_nodes(enumerate_numa_nodes(m_topology))
 	, m_processing_units_per_node(m_available_numa_nodes.size())
+	, m_huge_page_bytes(0)
+	, m_thp_advised_bytes(0)
+	, m_huge_mappings_mutex()
+	, m_huge_mappings()
+	, m_huge_mapping_count(0)
 {
 	const auto num_nodes = m_available_numa_nodes.size();
 	for(const auto pu : m_available_processing_units){
@@ -141,6 +153,11 @@ Topology::Topology()
 	: m_available_processing_units(std::thread::hardware_concurrency())
 	, m_available_numa_nodes(1, 0)
 	, m_processing_units_per_node(1, m_available_processing_units.size())
+	, m_huge_page_bytes(0)
+	, m_thp_advised_bytes(0)
+	, m_huge_mappings_mutex()
+	, m_huge_mappings()
+	, m_huge_mapping_count(0)
 {
 	const auto n = m_available_processing_units.size();
 	for(identifier_type i = 0; i < n; ++i){
@@ -191,34 +208,185 @@ void Topology::set_thread_cpubind(identifier_type numa_node){
 #endif
 }
 
-
-void *Topology::allocate_membind(size_type size){
+identifier_type Topology::current_numa_node() const {
 #ifdef M3BP_LOCALITY_ENABLED
 #	ifdef M3BP_NO_THREAD_LOCAL
-	return allocate_membind(size, g_ts_binded_node.get());
+	return g_ts_binded_node.get();
 #	else
-	return allocate_membind(size, g_binded_node);
+	return g_binded_node;
 #	endif
 #else
-	return allocate_membind(size, 0);
+	return 0;
 #endif
 }
 
+
+void *Topology::allocate_membind(size_type size){
+	return allocate_membind(size, current_numa_node());
+}
+
 void *Topology::allocate_membind(
-	size_type size, identifier_type numa_node)
+	size_type size, identifier_type numa_node, size_type huge_page_threshold)
 {
-	(void)(numa_node);
 	assert(numa_node < m_processing_units_per_node.size());
+	if(huge_page_threshold > 0 &&
+	   size >= huge_page_threshold && size >= HUGE_PAGE_SIZE)
+	{
+		void *ptr = allocate_huge(size, numa_node);
+		if(ptr){ return ptr; }
+	}
+#ifdef M3BP_LOCALITY_ENABLED
+	if(m_available_numa_nodes.size() > 1 && size >= MEMBIND_THRESHOLD){
+		const auto obj = hwloc_get_obj_by_type(
+			m_topology, HWLOC_OBJ_NODE, m_available_numa_nodes[numa_node]);
+		void *ptr = nullptr;
+		if(obj){
+			ptr = hwloc_alloc_membind(
+				m_topology, size, obj->nodeset,
+				HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET);
+		}
+		if(!ptr){
+			// Binding is not supported: rely on the first touch policy
+			static std::atomic<bool> s_warned(false);
+			if(!s_warned.exchange(true)){
+				M3BP_GENERAL_LOG(WARNING)
+					<< "Failed to bind memory to NUMA node #" << numa_node;
+			}
+			ptr = hwloc_alloc(m_topology, size);
+		}
+		if(!ptr){ throw std::bad_alloc(); }
+		return ptr;
+	}
+#else
+	(void)(numa_node);
+#endif
 	void *ptr = malloc(size);
 	if(!ptr){ throw std::bad_alloc(); }
 	return ptr;
 }
 
 void Topology::release_membind(
-	void *p, size_type /* size */) noexcept
+	void *p, size_type size) noexcept
 {
+	if(size >= HUGE_PAGE_SIZE && m_huge_mapping_count.load() > 0 &&
+	   release_huge(p))
+	{
+		return;
+	}
+#ifdef M3BP_LOCALITY_ENABLED
+	if(m_available_numa_nodes.size() > 1 && size >= MEMBIND_THRESHOLD){
+		hwloc_free(m_topology, p, size);
+		return;
+	}
+#else
+	(void)(size);
+#endif
 	free(p);
 }
 
+void *Topology::allocate_huge(size_type size, identifier_type numa_node){
+	const auto length =
+		(size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+	const int prot = PROT_READ | PROT_WRITE;
+	const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	bool explicit_huge = false;
+	void *ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+	// Fails unless huge pages are reserved by vm.nr_hugepages
+	ptr = mmap(nullptr, length, prot, flags | MAP_HUGETLB, -1, 0);
+	explicit_huge = (ptr != MAP_FAILED);
+#endif
+	if(ptr == MAP_FAILED){
+		ptr = mmap(nullptr, length, prot, flags, -1, 0);
+		if(ptr == MAP_FAILED){ return nullptr; }
+#ifdef MADV_HUGEPAGE
+		if(madvise(ptr, length, MADV_HUGEPAGE) != 0){
+			// Transparent huge pages are not available: keep small pages
+			munmap(ptr, length);
+			return nullptr;
+		}
+#else
+		munmap(ptr, length);
+		return nullptr;
+#endif
+	}
+#ifdef M3BP_LOCALITY_ENABLED
+	if(m_available_numa_nodes.size() > 1){
+		const auto obj = hwloc_get_obj_by_type(
+			m_topology, HWLOC_OBJ_NODE, m_available_numa_nodes[numa_node]);
+		// Pages are not touched yet, so they are placed by the binding.
+		// Otherwise they follow the first touch policy.
+		if(obj){
+			hwloc_set_area_membind(
+				m_topology, ptr, length, obj->nodeset,
+				HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET);
+		}
+	}
+#else
+	(void)(numa_node);
+#endif
+	{
+		std::lock_guard<std::mutex> lock(m_huge_mappings_mutex);
+		m_huge_mappings.emplace(ptr, HugeMapping{ length, explicit_huge });
+		++m_huge_mapping_count;
+	}
+	if(explicit_huge){
+		m_huge_page_bytes += length;
+	}else{
+		m_thp_advised_bytes += length;
+	}
+	return ptr;
+}
+
+bool Topology::release_huge(void *p) noexcept {
+	HugeMapping mapping;
+	{
+		std::lock_guard<std::mutex> lock(m_huge_mappings_mutex);
+		const auto it = m_huge_mappings.find(p);
+		if(it == m_huge_mappings.end()){ return false; }
+		mapping = it->second;
+		m_huge_mappings.erase(it);
+		--m_huge_mapping_count;
+	}
+	munmap(p, mapping.length);
+	if(mapping.is_explicit){
+		m_huge_page_bytes -= mapping.length;
+	}else{
+		m_thp_advised_bytes -= mapping.length;
+	}
+	return true;
+}
+
+identifier_type Topology::memory_location(
+	const void *p, size_type size) const
+{
+#ifdef M3BP_LOCALITY_ENABLED
+	if(m_available_numa_nodes.size() == 1){ return 0; }
+	hwloc_nodeset_t nodeset = hwloc_bitmap_alloc();
+	identifier_type result = m_available_numa_nodes.size();
+	if(hwloc_get_area_memlocation(
+		m_topology, p, size, nodeset, HWLOC_MEMBIND_BYNODESET) == 0)
+	{
+		const auto os_index = hwloc_bitmap_first(nodeset);
+		const auto obj = os_index < 0
+			? nullptr
+			: hwloc_get_numanode_obj_by_os_index(m_topology, os_index);
+		if(obj){
+			const auto it = std::find(
+				m_available_numa_nodes.begin(),
+				m_available_numa_nodes.end(),
+				obj->logical_index);
+			result = it - m_available_numa_nodes.begin();
+		}
+	}
+	hwloc_bitmap_free(nodeset);
+	return result;
+#else
+	(void)(p);
+	(void)(size);
+	return 0;
+#endif
+}
+
 }
 
@@ -18,6 +18,9 @@
 
 #include <cassert>
 #include <vector>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 
 #ifdef M3BP_LOCALITY_ENABLED
 #include <hwloc.h>
@@ -38,6 +41,21 @@ private:
 	std::vector<identifier_type> m_available_numa_nodes;
 	std::vector<size_type> m_processing_units_per_node;
 
+	struct HugeMapping {
+		size_type length;
+		bool is_explicit;
+	};
+
+	std::atomic<size_type> m_huge_page_bytes;
+	std::atomic<size_type> m_thp_advised_bytes;
+	std::mutex m_huge_mappings_mutex;
+	std::unordered_map<void *, HugeMapping> m_huge_mappings;
+	// Releases skip the lookup in m_huge_mappings while this is zero
+	std::atomic<size_type> m_huge_mapping_count;
+
+	void *allocate_huge(size_type size, identifier_type numa_node);
+	bool release_huge(void *p) noexcept;
+
 	Topology();
 	Topology(const Topology &) = delete;
 	Topology &operator=(const Topology &) = delete;
@@ -63,11 +81,58 @@ public:
 
 	void set_thread_cpubind(identifier_type numa_node);
 
+	/**
+	 *  Gets the NUMA node that the calling thread is bound to.
+	 */
+	identifier_type current_numa_node() const;
+
 	void *allocate_membind(size_type size);
-	void *allocate_membind(size_type size, identifier_type numa_node);
+
+	/**
+	 *  Allocates a memory area bound to a NUMA node.
+	 *
+	 *  @param[in] size                 The size of the area in bytes.
+	 *  @param[in] numa_node            The NUMA node to bind the area to.
+	 *  @param[in] huge_page_threshold  The minimum size of areas mapped
+	 *                                  with huge pages, or 0 to disable
+	 *                                  huge pages. Areas smaller than a
+	 *                                  huge page are never mapped with
+	 *                                  huge pages.
+	 */
+	void *allocate_membind(
+		size_type size,
+		identifier_type numa_node,
+		size_type huge_page_threshold = 0);
 
 	void release_membind(void *p, size_type size) noexcept;
 
+	/**
+	 *  Gets the number of bytes currently mapped with explicit huge pages.
+	 */
+	size_type huge_page_bytes() const noexcept {
+		return m_huge_page_bytes.load();
+	}
+
+	/**
+	 *  Gets the number of bytes currently mapped with small pages and
+	 *  advised to be backed by transparent huge pages instead of explicit
+	 *  ones. The kernel may still back them with small pages.
+	 */
+	size_type thp_advised_bytes() const noexcept {
+		return m_thp_advised_bytes.load();
+	}
+
+	/**
+	 *  Gets the NUMA node that has pages of the given memory area.
+	 *
+	 *  Pages are placed when they are touched at first, so the area must
+	 *  be written before this function is called.
+	 *
+	 *  @return The identifier of the NUMA node that has the first page of
+	 *          the area, or numa_node_count() if it cannot be determined.
+	 */
+	identifier_type memory_location(const void *p, size_type size) const;
+
 };
 
 }
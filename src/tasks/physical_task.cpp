@@ -35,6 +35,11 @@ PhysicalTask::PhysicalTask(
 	, m_command(std::move(command))
 { }
 
+int64_t PhysicalTask::estimated_memory_delta() const {
+	assert(m_command);
+	return m_command->estimated_memory_delta();
+}
+
 void PhysicalTask::prepare(
 	ExecutionContext &context,
 	const Locality &locality)
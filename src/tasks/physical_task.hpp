@@ -17,6 +17,7 @@
 #define M3BP_TASKS_PHYSICAL_TASK_HPP
 
 #include <memory>
+#include <cstdint>
 #include "tasks/logical_task_identifier.hpp"
 #include "tasks/physical_task_identifier.hpp"
 
@@ -51,6 +52,8 @@ public:
 		return m_physical_task_id;
 	}
 
+	int64_t estimated_memory_delta() const;
+
 	void prepare(
 		ExecutionContext &context,
 		const Locality &locality);
@@ -16,6 +16,7 @@
 #ifndef M3BP_TASKS_PHYSICAL_TASK_COMMAND_BASE_HPP
 #define M3BP_TASKS_PHYSICAL_TASK_COMMAND_BASE_HPP
 
+#include <cstdint>
 #include "common/array_ref.hpp"
 #include "memory/memory_reference.hpp"
 
@@ -39,6 +40,16 @@ public:
 		const Locality &   /* locality */)
 	{ }
 
+	/**
+	 *  Estimates how much the memory usage grows when this task completes.
+	 *
+	 *  A negative value means that the task releases more memory than it
+	 *  allocates. This is called before prepare().
+	 */
+	virtual int64_t estimated_memory_delta() const {
+		return 0;
+	}
+
 };
 
 }
@@ -70,7 +70,7 @@ void InputProcessLogicalTask::after_global_initialize(
 			task_id(),
 			make_unique<ProcessCommandWrapper>(
 				this, make_unique<InputProcessRunCommand>(this, i)),
-			LocalityOption());
+			LocalityOption().memory_producer(true));
 		scheduler
 			.add_dependency(entry_task(), pid)
 			.add_dependency(pid, barrier_task());
@@ -18,6 +18,8 @@
 #include "tasks/process/one_to_one_process_logical_task.hpp"
 #include "tasks/physical_task_command_base.hpp"
 #include "context/execution_context.hpp"
+#include "memory/memory_manager.hpp"
+#include "scheduler/locality.hpp"
 #include "scheduler/locality_option.hpp"
 
 namespace m3bp {
@@ -43,12 +45,16 @@ public:
 	{ }
 
 	virtual void prepare(
-		ExecutionContext & /* context */,
-		const Locality & /* locality */) override
+		ExecutionContext &context,
+		const Locality &locality) override
 	{
 		assert(m_process_task);
 		m_locked_input = m_one_to_one_input.lock();
 		m_one_to_one_input = MemoryReference();
+		context.memory_manager().migrate_inputs(
+			ArrayRef<LockedMemoryReference>(
+				&m_locked_input, &m_locked_input + 1),
+			locality.self_node_id());
 	}
 
 	virtual void run(
@@ -61,6 +67,10 @@ public:
 		mobjs[m_one_to_one_port] = std::move(m_locked_input);
 		m_process_task->run(context, locality, std::move(mobjs));
 	}
+
+	virtual size_type input_size() const override {
+		return m_one_to_one_input ? m_one_to_one_input.size() : 0;
+	}
 };
 
 
@@ -95,7 +105,8 @@ void OneToOneProcessLogicalTask::receive_non_broadcast_fragment(
 			this, make_unique<OneToOneProcessRunCommand>(
 				this, std::move(mobj), port)),
 		LocalityOption(
-			locality_manager.random_worker_from_node(mobj_loc)));
+			locality_manager.random_worker_from_node(mobj_loc))
+			.memory_producer(true));
 	scheduler
 		.add_dependency(entry_task(), pid)
 		.add_dependency(pid, barrier_task());
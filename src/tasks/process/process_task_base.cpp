@@ -70,6 +70,12 @@ void ProcessLogicalTaskBase::ProcessCommandWrapper::run(
 	m_logical_task->notify_completion(context);
 }
 
+int64_t
+ProcessLogicalTaskBase::ProcessCommandWrapper::estimated_memory_delta() const {
+	return static_cast<int64_t>(m_logical_task->m_estimated_output_size) -
+		static_cast<int64_t>(m_command->input_size());
+}
+
 
 class ProcessLogicalTaskBase::GlobalInitializeCommand
 	: public PhysicalTaskCommandBase
@@ -184,6 +190,7 @@ ProcessLogicalTaskBase::ProcessLogicalTaskBase()
 	, m_global_initialized(false)
 	, m_thread_local_initialized()
 	, m_broadcast_inputs()
+	, m_estimated_output_size(0)
 	, m_local_queue_mutex()
 	, m_remaining_concurrency(0)
 	, m_task_queue()
@@ -196,6 +203,7 @@ ProcessLogicalTaskBase::ProcessLogicalTaskBase(
 	, m_global_initialized(false)
 	, m_thread_local_initialized(worker_count)
 	, m_broadcast_inputs(m_processor->input_ports().size())
+	, m_estimated_output_size(0)
 	, m_local_queue_mutex()
 	, m_remaining_concurrency(m_processor->max_concurrency())
 	, m_task_queue()
@@ -204,6 +212,9 @@ ProcessLogicalTaskBase::ProcessLogicalTaskBase(
 
 void ProcessLogicalTaskBase::create_physical_tasks(ExecutionContext &context){
 	auto &scheduler = context.scheduler();
+	m_estimated_output_size =
+		context.configuration().default_output_buffer_size() *
+		m_processor->output_ports().size();
 	const auto entry_id = scheduler.create_physical_task(
 		task_id(),
 		make_unique<GlobalInitializeCommand>(this),
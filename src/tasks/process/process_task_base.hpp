@@ -44,6 +44,14 @@ protected:
 			const Locality &   /* locality */,
 			std::vector<LockedMemoryReference> /* mobjs */)
 		{ }
+
+		/**
+		 *  Gets the total size of non-broadcast inputs that are released
+		 *  after this command.
+		 */
+		virtual size_type input_size() const {
+			return 0;
+		}
 	};
 
 	class ProcessCommandWrapper
@@ -66,6 +74,16 @@ protected:
 		virtual void run(
 			ExecutionContext &context,
 			const Locality &locality) override;
+
+		/**
+		 *  Estimates the delta from the size of inputs and a constant
+		 *  output of one default-sized buffer for each port.
+		 *
+		 *  Observed output sizes are not taken into account, so tasks that
+		 *  filter or expand records are misestimated; the delta is only
+		 *  good enough to roughly order tasks of a logical task.
+		 */
+		virtual int64_t estimated_memory_delta() const override;
 	};
 
 private:
@@ -81,6 +99,9 @@ private:
 
 	std::vector<MemoryReference> m_broadcast_inputs;
 
+	// Assumes that each task fills one default-sized buffer for each port
+	size_type m_estimated_output_size;
+
 	std::mutex m_local_queue_mutex;
 	size_type m_remaining_concurrency;
 	std::queue<PhysicalTaskIdentifier> m_task_queue;
@@ -18,6 +18,8 @@
 #include "tasks/process/scatter_gather_process_logical_task.hpp"
 #include "tasks/physical_task_command_base.hpp"
 #include "context/execution_context.hpp"
+#include "memory/memory_manager.hpp"
+#include "scheduler/locality.hpp"
 #include "scheduler/locality_option.hpp"
 
 namespace m3bp {
@@ -43,8 +45,8 @@ public:
 	{ }
 
 	virtual void prepare(
-		ExecutionContext & /* context */,
-		const Locality & /* locality */) override
+		ExecutionContext &context,
+		const Locality &locality) override
 	{
 		assert(m_process_task);
 		const auto port_count = m_unlocked_inputs.size();
@@ -54,6 +56,10 @@ public:
 				locked[i] = m_unlocked_inputs[i].lock();
 			}
 		}
+		context.memory_manager().migrate_inputs(
+			ArrayRef<LockedMemoryReference>(
+				locked.data(), locked.data() + port_count),
+			locality.self_node_id());
 		m_locked_inputs = std::move(locked);
 		m_unlocked_inputs.clear();
 	}
@@ -76,6 +82,14 @@ public:
 		m_process_task->run(
 			context, locality, std::move(mobjs), m_partition);
 	}
+
+	virtual size_type input_size() const override {
+		size_type total = 0;
+		for(const auto &mobj : m_unlocked_inputs){
+			if(mobj){ total += mobj.size(); }
+		}
+		return total;
+	}
 };
 
 
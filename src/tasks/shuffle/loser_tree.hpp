@@ -0,0 +1,98 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef M3BP_TASKS_SHUFFLE_LOSER_TREE_HPP
+#define M3BP_TASKS_SHUFFLE_LOSER_TREE_HPP
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "m3bp/types.hpp"
+
+namespace m3bp {
+
+/**
+ *  Tournament tree to select the minimum head of multiple sorted streams.
+ *
+ *  Streams are identified by indices and compared by a functor
+ *  <tt>less(a, b)</tt> that returns whether the head of stream @c a
+ *  precedes the head of stream @c b. Exhausted streams must compare greater
+ *  than any other stream.
+ */
+template <typename Less>
+class LoserTree {
+
+private:
+	size_type m_size;
+	std::vector<identifier_type> m_losers;
+	Less m_less;
+
+public:
+	LoserTree(size_type size, Less less)
+		: m_size(size)
+		, m_losers(std::max<size_type>(size, 1))
+		, m_less(std::move(less))
+	{
+		if(m_size <= 1){
+			m_losers[0] = 0;
+			return;
+		}
+		std::vector<identifier_type> winners(2 * m_size);
+		for(identifier_type i = 0; i < m_size; ++i){
+			winners[m_size + i] = i;
+		}
+		for(identifier_type i = m_size - 1; i > 0; --i){
+			const auto l = winners[2 * i], r = winners[2 * i + 1];
+			if(m_less(r, l)){
+				winners[i] = r;
+				m_losers[i] = l;
+			}else{
+				winners[i] = l;
+				m_losers[i] = r;
+			}
+		}
+		m_losers[0] = winners[1];
+	}
+
+	/**
+	 *  Returns the index of the stream that has the minimum head.
+	 */
+	identifier_type top() const noexcept {
+		return m_losers[0];
+	}
+
+	/**
+	 *  Restores the tree after the head of top() is changed.
+	 */
+	void update(){
+		auto winner = m_losers[0];
+		for(auto i = (m_size + winner) / 2; i > 0; i /= 2){
+			if(m_less(m_losers[i], winner)){
+				std::swap(m_losers[i], winner);
+			}
+		}
+		m_losers[0] = winner;
+	}
+
+};
+
+template <typename Less>
+inline LoserTree<Less> make_loser_tree(size_type size, Less less){
+	return LoserTree<Less>(size, std::move(less));
+}
+
+}
+
+#endif
@@ -16,7 +16,12 @@
 #ifndef M3BP_TASKS_MSD_RADIX_SORT_HPP
 #define M3BP_TASKS_MSD_RADIX_SORT_HPP
 
+#include <array>
+#include <bitset>
+#include <vector>
+#include <algorithm>
 #include <cstdint>
+#include <unistd.h>
 #include "m3bp/types.hpp"
 
 namespace m3bp {
@@ -25,6 +30,8 @@ namespace {
 using cache_type = uint64_t;
 static const int RADIX_SORT_THRESHOLD = (1 << 8);
 static const int SUPER_ALPHABET_THRESHOLD = (1 << 16);
+static const size_type ALPHABET_SIZE = (1 << 8);
+static const size_type SUPER_ALPHABET_SIZE = (1 << 16);
 
 inline uint16_t bswap(uint16_t x){
 	return __builtin_bswap16(x);
@@ -54,7 +61,7 @@ inline T get_block(const uint8_t *ptr, size_t k){
 	const auto key_len = get_key_length(ptr);
 	const auto key_ptr = get_key_pointer(ptr) + k;
 	T block = 0;
-	if(key_len - k >= sizeof(T)){
+	if(k <= key_len && key_len - k >= sizeof(T)){
 		block = bswap(*reinterpret_cast<const T *>(key_ptr));
 	}else{
 		for(size_type i = 0; i < sizeof(T); ++i){
@@ -104,33 +111,144 @@ void quick_sort(cache_type *cache, const uint8_t **pointers, size_t n){
 	}
 }
 
+inline size_type get_digit(
+	cache_type c, size_type depth, size_type digit_bytes)
+{
+	const auto shift =
+		(sizeof(cache_type) - digit_bytes - depth % sizeof(cache_type)) * 8;
+	return (c >> shift) & ((size_type(1) << (digit_bytes * 8)) - 1);
+}
+
+/**
+ *  Returns the size of the L2 cache in bytes.
+ *
+ *  A typical size is assumed when it cannot be queried, which is too small
+ *  for the 16-bit histogram.
+ */
+inline size_type l2_cache_size(){
+	static const size_type DEFAULT_L2_CACHE_SIZE = (256 << 10);
+#ifdef _SC_LEVEL2_CACHE_SIZE
+	static const long cache_size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+	if(cache_size > 0){ return static_cast<size_type>(cache_size); }
+#endif
+	return DEFAULT_L2_CACHE_SIZE;
+}
+
+/**
+ *  Returns whether a bucket should be distributed by 16-bit digits.
+ *
+ *  16-bit digits halve the number of passes but the histogram has 65536
+ *  entries. They are disabled by default since they measured slower than
+ *  8-bit digits on typical keys; when enabled by the caller, they are
+ *  used only for buckets that are large enough to
+ *  amortize the histogram, only when it fits in the L2 cache, and only
+ *  when sampled keys use most byte values at this depth. Keys drawn from
+ *  a small alphabet, such as text, populate few 16-bit digits and are
+ *  distributed faster by 8-bit digits.
+ */
+inline bool use_super_alphabet(
+	const cache_type *cache, size_type n, size_type depth)
+{
+	if(n < static_cast<size_type>(SUPER_ALPHABET_THRESHOLD)){ return false; }
+	// a 16-bit digit must not cross the boundary of cache blocks
+	if(depth % sizeof(cache_type) == sizeof(cache_type) - 1){ return false; }
+	if(SUPER_ALPHABET_SIZE * sizeof(size_type) > l2_cache_size()){
+		return false;
+	}
+	std::bitset<ALPHABET_SIZE> sampled;
+	const size_type step = n / ALPHABET_SIZE;
+	for(size_type i = 0; i < n; i += step){
+		sampled.set(get_digit(cache[i], depth, 1));
+	}
+	return sampled.count() >= ALPHABET_SIZE / 4;
+}
+
+/**
+ *  Loads cache blocks at the given depth and skips bytes that are shared
+ *  by all keys.
+ *
+ *  Returns @c false when all keys are exhausted, otherwise @c depth is
+ *  advanced to the first byte that differs between keys.
+ */
+inline bool load_cache_blocks(
+	cache_type *cache, const uint8_t * const *pointers,
+	size_type n, size_type &depth)
+{
+	while(true){
+		bool is_finished = true;
+		cache_type diff = 0;
+		for(size_type i = 0; i < n; ++i){
+			const auto key_length = get_key_length(pointers[i]);
+			cache[i] = get_block<cache_type>(pointers[i], depth);
+			if(depth < key_length){ is_finished = false; }
+			diff |= cache[i] ^ cache[0];
+		}
+		if(is_finished){
+			return false;
+		}else if(diff != 0){
+			depth += __builtin_clzll(diff) / 8;
+			return true;
+		}
+		depth += sizeof(cache_type);
+	}
+}
+
+void msd_radix_sort(
+	uint8_t *equals_to_left,
+	cache_type *cache, const uint8_t **pointers,
+	cache_type *cache_work, const uint8_t **pointers_work,
+	size_type n, size_type depth = 0, bool swapped = false,
+	bool wide_digits = false);
+
+template <typename Bins>
+void msd_radix_sort_scatter(
+	uint8_t *equals_to_left,
+	cache_type *cache, const uint8_t **pointers,
+	cache_type *cache_work, const uint8_t **pointers_work,
+	size_type n, size_type depth, bool swapped, bool wide_digits,
+	Bins &bins, size_type digit_bytes)
+{
+	std::fill(bins.begin(), bins.end(), 0);
+	for(size_type i = 0; i < n; ++i){
+		++bins[get_digit(cache[i], depth, digit_bytes)];
+	}
+	for(size_type i = 0, s = 0; i < bins.size(); ++i){
+		const auto t = bins[i];
+		bins[i] = s;
+		s += t;
+	}
+	for(size_type i = 0; i < n; ++i){
+		const auto p = bins[get_digit(cache[i], depth, digit_bytes)]++;
+		cache_work[p] = cache[i];
+		pointers_work[p] = pointers[i];
+	}
+	for(size_type i = 0, head = 0; i < bins.size(); ++i){
+		const auto tail = bins[i];
+		msd_radix_sort(
+			equals_to_left + head,
+			cache_work + head, pointers_work + head,
+			cache + head, pointers + head,
+			tail - head, depth + digit_bytes, !swapped, wide_digits);
+		head = tail;
+	}
+}
+
 void msd_radix_sort(
 	uint8_t *equals_to_left,
 	cache_type *cache, const uint8_t **pointers,
 	cache_type *cache_work, const uint8_t **pointers_work,
-	size_type n, size_type depth = 0, bool swapped = false)
+	size_type n, size_type depth, bool swapped, bool wide_digits)
 {
 	if(n == 0){
 		return;
 	}
 	if(depth % sizeof(cache_type) == 0){
-		bool is_finished = true;
-		for(size_type i = 0; i < n; ++i){
-			const auto key_length = get_key_length(pointers[i]);
-			cache_work[i] = get_block<cache_type>(pointers[i], depth);
-			if(depth < key_length){ is_finished = false; }
-		}
-		if(is_finished){
+		if(!load_cache_blocks(cache, pointers, n, depth)){
+			// all keys share the first depth bytes and the rest are zeros
 			for(size_type i = 1; i < n; ++i){
-				if(cache[i] == cache[i - 1]){
-					equals_to_left[i] = true;
-				}
+				equals_to_left[i] = true;
 			}
 			return;
-		}else{
-			for(size_type i = 0; i < n; ++i){
-				cache[i] = cache_work[i];
-			}
 		}
 	}
 	if(n < RADIX_SORT_THRESHOLD){
@@ -153,67 +271,118 @@ void msd_radix_sort(
 			if(j - i >= 2){
 				msd_radix_sort(
 					equals_to_left + i, cache + i, pointers + i,
-					cache_work + i, pointers_work + i, j - i, next_depth);
+					cache_work + i, pointers_work + i, j - i, next_depth,
+					false, wide_digits);
 			}
 			i = j;
 		}
-/*
-	}else if(n >= SUPER_ALPHABET_THRESHOLD){
-		const size_type BUCKET_SIZE = (1 << 16);
-		std::vector<size_type> bins(BUCKET_SIZE);
-		const auto shift =
-			(sizeof(cache_type) - 2 - depth % sizeof(cache_type)) * 8;
-		for(size_type i = 0; i < n; ++i){
-			++bins[(cache[i] >> shift) & (BUCKET_SIZE - 1)];
-		}
-		for(size_type i = 0, s = 0; i < BUCKET_SIZE; ++i){
-			const auto t = bins[i];
-			bins[i] = s;
-			s += t;
-		}
-		for(size_type i = 0; i < n; ++i){
-			const auto p = bins[(cache[i] >> shift) & (BUCKET_SIZE - 1)]++;
-			cache_work[p] = cache[i];
-			pointers_work[p] = pointers[i];
-		}
-		for(size_type i = 0, head = 0; i < BUCKET_SIZE; ++i){
-			const auto tail = bins[i];
-			msd_radix_sort(
-				equals_to_left + head,
-				cache_work + head, pointers_work + head,
-				cache + head, pointers + head,
-				tail - head, depth + 2, !swapped);
-			head = tail;
-		}
-*/
+	}else if(wide_digits && use_super_alphabet(cache, n, depth)){
+		std::vector<size_type> bins(SUPER_ALPHABET_SIZE);
+		msd_radix_sort_scatter(
+			equals_to_left, cache, pointers, cache_work, pointers_work,
+			n, depth, swapped, wide_digits, bins, 2);
 	}else{
-		const size_type BUCKET_SIZE = (1 << 8);
-		std::array<size_type, BUCKET_SIZE> bins;
-		std::fill(bins.begin(), bins.end(), 0);
-		const auto shift =
-			(sizeof(cache_type) - 1 - depth % (sizeof(cache_type))) * 8;
-		for(size_type i = 0; i < n; ++i){
-			++bins[(cache[i] >> shift) & (BUCKET_SIZE - 1)];
-		}
-		for(size_type i = 0, s = 0; i < BUCKET_SIZE; ++i){
-			const auto t = bins[i];
-			bins[i] = s;
-			s += t;
+		std::array<size_type, ALPHABET_SIZE> bins;
+		msd_radix_sort_scatter(
+			equals_to_left, cache, pointers, cache_work, pointers_work,
+			n, depth, swapped, wide_digits, bins, 1);
+	}
+}
+
+void msd_radix_sort_in_place(
+	uint8_t *equals_to_left,
+	cache_type *cache, const uint8_t **pointers,
+	size_type n, size_type depth = 0);
+
+template <typename Bins>
+void msd_radix_sort_permute(
+	uint8_t *equals_to_left,
+	cache_type *cache, const uint8_t **pointers,
+	size_type n, size_type depth,
+	Bins &heads, Bins &tails, size_type digit_bytes)
+{
+	std::fill(tails.begin(), tails.end(), 0);
+	for(size_type i = 0; i < n; ++i){
+		++tails[get_digit(cache[i], depth, digit_bytes)];
+	}
+	for(size_type i = 0, s = 0; i < tails.size(); ++i){
+		heads[i] = s;
+		s += tails[i];
+		tails[i] = s;
+	}
+	// Move each record to the head of its bucket until the record that
+	// belongs to the current bucket is found
+	for(size_type b = 0; b < tails.size(); ++b){
+		while(heads[b] < tails[b]){
+			auto c = cache[heads[b]];
+			auto p = pointers[heads[b]];
+			auto d = get_digit(c, depth, digit_bytes);
+			while(d != b){
+				const auto dst = heads[d]++;
+				std::swap(c, cache[dst]);
+				std::swap(p, pointers[dst]);
+				d = get_digit(c, depth, digit_bytes);
+			}
+			cache[heads[b]] = c;
+			pointers[heads[b]] = p;
+			++heads[b];
 		}
-		for(size_type i = 0; i < n; ++i){
-			const auto p = bins[(cache[i] >> shift) & (BUCKET_SIZE - 1)]++;
-			cache_work[p] = cache[i];
-			pointers_work[p] = pointers[i];
+	}
+	for(size_type i = 0, head = 0; i < tails.size(); ++i){
+		const auto tail = tails[i];
+		msd_radix_sort_in_place(
+			equals_to_left + head, cache + head, pointers + head,
+			tail - head, depth + digit_bytes);
+		head = tail;
+	}
+}
+
+/**
+ *  In-place variant of msd_radix_sort.
+ *
+ *  Records are permuted by American flag sort, so it does not require work
+ *  buffers for caches and pointers. @c equals_to_left must be initialized
+ *  by zeros.
+ */
+void msd_radix_sort_in_place(
+	uint8_t *equals_to_left,
+	cache_type *cache, const uint8_t **pointers,
+	size_type n, size_type depth)
+{
+	if(n == 0){
+		return;
+	}
+	if(depth % sizeof(cache_type) == 0){
+		if(!load_cache_blocks(cache, pointers, n, depth)){
+			// all keys share the first depth bytes and the rest are zeros
+			for(size_type i = 1; i < n; ++i){
+				equals_to_left[i] = true;
+			}
+			return;
 		}
-		for(size_type i = 0, head = 0; i < BUCKET_SIZE; ++i){
-			const auto tail = bins[i];
-			msd_radix_sort(
-				equals_to_left + head,
-				cache_work + head, pointers_work + head,
-				cache + head, pointers + head,
-				tail - head, depth + 1, !swapped);
-			head = tail;
+	}
+	if(n < RADIX_SORT_THRESHOLD){
+		quick_sort(cache, pointers, n);
+		const auto next_depth =
+			(depth + sizeof(cache_type)) & ~(sizeof(cache_type) - 1);
+		for(size_type i = 0; i < n; ){
+			size_type j = i + 1;
+			while(j < n && cache[i] == cache[j]){
+				++j;
+			}
+			if(j - i >= 2){
+				msd_radix_sort_in_place(
+					equals_to_left + i, cache + i, pointers + i,
+					j - i, next_depth);
+			}
+			i = j;
 		}
+	}else{
+		// 16-bit digits are not used because cycles of the permutation
+		// touch too many buckets to stay in the cache
+		std::array<size_type, ALPHABET_SIZE> heads, tails;
+		msd_radix_sort_permute(
+			equals_to_left, cache, pointers, n, depth, heads, tails, 1);
 	}
 }
 
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef M3BP_TASKS_SHUFFLE_PARTITIONER_HPP
+#define M3BP_TASKS_SHUFFLE_PARTITIONER_HPP
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include "m3bp/types.hpp"
+#include "common/hash_function.hpp"
+
+namespace m3bp {
+
+/**
+ *  Compares two keys in the same order as msd_radix_sort.
+ *
+ *  Keys are regarded as padded with zeros, so trailing zeros are ignored
+ *  for comparison.
+ */
+inline int compare_padded_keys(
+	const uint8_t *a, size_type a_length,
+	const uint8_t *b, size_type b_length)
+{
+	const auto common_length = std::min(a_length, b_length);
+	const int result = memcmp(a, b, common_length);
+	if(result != 0){ return result; }
+	for(identifier_type i = common_length; i < a_length; ++i){
+		if(a[i] != 0){ return 1; }
+	}
+	for(identifier_type i = common_length; i < b_length; ++i){
+		if(b[i] != 0){ return -1; }
+	}
+	return 0;
+}
+
+
+/**
+ *  Base class of functions that distribute keys to shuffle partitions.
+ */
+class PartitionerBase {
+
+public:
+	virtual ~PartitionerBase() = default;
+
+	/**
+	 *  Computes the partition that a key belongs to.
+	 *
+	 *  Keys that are equal in the order of msd_radix_sort must belong to
+	 *  the same partition.
+	 */
+	virtual identifier_type partition(
+		const void *key, size_type key_length) const = 0;
+
+};
+
+
+/**
+ *  Partitioner that distributes keys by their hash values.
+ */
+class HashPartitioner : public PartitionerBase {
+
+private:
+	size_type m_partition_count;
+
+public:
+	explicit HashPartitioner(size_type partition_count)
+		: m_partition_count(partition_count)
+	{ }
+
+	virtual identifier_type partition(
+		const void *key, size_type key_length) const override
+	{
+		return hash_byte_sequence(key, key_length, m_partition_count);
+	}
+
+};
+
+
+/**
+ *  Partitioner that distributes keys by sorted split points.
+ *
+ *  A key belongs to the partition @c i when it is not smaller than the
+ *  split point <tt>i - 1</tt> and smaller than the split point @c i.
+ *  Therefore every key in a partition is smaller than keys in succeeding
+ *  partitions.
+ */
+class RangePartitioner : public PartitionerBase {
+
+private:
+	std::vector<std::string> m_split_points;
+
+public:
+	RangePartitioner()
+		: m_split_points()
+	{ }
+
+	explicit RangePartitioner(std::vector<std::string> split_points)
+		: m_split_points(std::move(split_points))
+	{ }
+
+	/**
+	 *  Computes split points from sampled keys.
+	 *
+	 *  Split points are chosen from quantiles of the samples, so partitions
+	 *  receive approximately the same number of records. Duplicated split
+	 *  points are removed and remaining partitions will be empty.
+	 */
+	static RangePartitioner from_samples(
+		std::vector<std::string> samples, size_type partition_count)
+	{
+		const auto less = [](const std::string &a, const std::string &b){
+			return compare_padded_keys(
+				reinterpret_cast<const uint8_t *>(a.data()), a.size(),
+				reinterpret_cast<const uint8_t *>(b.data()), b.size()) < 0;
+		};
+		if(samples.empty()){ return RangePartitioner(); }
+		std::sort(samples.begin(), samples.end(), less);
+		std::vector<std::string> split_points;
+		for(identifier_type i = 1; i < partition_count; ++i){
+			const auto &s = samples[samples.size() * i / partition_count];
+			if(split_points.empty() || less(split_points.back(), s)){
+				split_points.push_back(s);
+			}
+		}
+		return RangePartitioner(std::move(split_points));
+	}
+
+	const std::vector<std::string> &split_points() const noexcept {
+		return m_split_points;
+	}
+
+	virtual identifier_type partition(
+		const void *key, size_type key_length) const override
+	{
+		const auto key_ptr = static_cast<const uint8_t *>(key);
+		const auto it = std::upper_bound(
+			m_split_points.begin(), m_split_points.end(), 0,
+			[=](int, const std::string &s){
+				return compare_padded_keys(
+					key_ptr, key_length,
+					reinterpret_cast<const uint8_t *>(s.data()),
+					s.size()) < 0;
+			});
+		return static_cast<identifier_type>(it - m_split_points.begin());
+	}
+
+};
+
+}
+
+#endif
@@ -14,22 +14,222 @@
  * limitations under the License.
  */
 #include <array>
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <limits>
 #include <cassert>
 #include <cstring>
 #include "tasks/shuffle/shuffle_logical_task.hpp"
 #include "tasks/shuffle/msd_radix_sort.hpp"
-#include "tasks/shuffle/shuffle_buffer.hpp"
+#include "tasks/shuffle/loser_tree.hpp"
+#include "tasks/shuffle/spilled_run.hpp"
 #include "tasks/physical_task_command_base.hpp"
 #include "common/hash_function.hpp"
 #include "context/execution_context.hpp"
 #include "scheduler/locality.hpp"
 #include "scheduler/locality_option.hpp"
 #include "memory/serialized_buffer.hpp"
+#include "system/scratch_file.hpp"
 
 namespace m3bp {
 
 namespace {
 
+static const size_type DEFAULT_PARALLEL_SORT_THRESHOLD = (1 << 16);
+static const size_type PARALLEL_SORT_BUCKET_COUNT = (1 << 8);
+static const size_type SORT_TASKS_PER_WORKER = 4;
+static const size_type MIN_SORT_TASK_SIZE = (64 << 10);
+static const size_type SAMPLES_PER_PARTITION = 4;
+static const size_type MIN_CHUNK_SIZE = (4 << 10);
+static const size_type MAX_CHUNK_SIZE = (1 << 20);
+static const size_type IN_PROGRESS_BUFFER_LIMIT = (16 << 20);
+
+/**
+ *  Variants of the radix sort chosen by the configuration.
+ */
+struct SortOptions {
+	bool in_place;
+	bool wide_digits;
+
+	explicit SortOptions(const Configuration &config)
+		: in_place(config.in_place_shuffle_sort())
+		, wide_digits(config.wide_radix_sort_digits())
+	{ }
+};
+
+}
+
+/**
+ *  Shared state of physical tasks that sort a partition in parallel.
+ *
+ *  Bucket tasks collect records and find the prefix shared by their keys,
+ *  then distribute them into buckets by the first byte that differs
+ *  between keys of the whole partition. Range tasks sort sets of adjacent
+ *  buckets. Sorted records are stored in disjoint slices of the shared
+ *  arrays.
+ */
+class ShuffleLogicalTask::ParallelSortState {
+public:
+	using BucketOffsets = std::array<size_type, PARALLEL_SORT_BUCKET_COUNT + 1>;
+
+	identifier_type partition;
+	PhysicalTaskIdentifier prefix_task;
+	PhysicalTaskIdentifier join_task;
+	PhysicalTaskIdentifier assemble_task;
+	std::vector<std::vector<ShuffleLogicalTask::LockedRecordChunk>> sources;
+	std::vector<std::vector<const uint8_t *>> bucketed_pointers;
+	std::vector<size_type> prefix_lengths;
+	size_type bucket_depth;
+	std::vector<BucketOffsets> bucket_offsets;
+	std::vector<identifier_type> range_buckets;
+	std::vector<size_type> range_offsets;
+	std::vector<const uint8_t *> pointers;
+	std::vector<uint8_t> equals_to_left;
+	SortOptions sort_options;
+
+	ParallelSortState(
+		identifier_type partition,
+		size_type bucket_task_count,
+		const SortOptions &sort_options)
+		: partition(partition)
+		, prefix_task()
+		, join_task()
+		, assemble_task()
+		, sources(bucket_task_count)
+		, bucketed_pointers(bucket_task_count)
+		, prefix_lengths(bucket_task_count)
+		, bucket_depth(0)
+		, bucket_offsets(bucket_task_count)
+		, range_buckets()
+		, range_offsets()
+		, pointers()
+		, equals_to_left()
+		, sort_options(sort_options)
+	{ }
+};
+
+/**
+ *  Partitioned records accumulated by a worker.
+ *
+ *  Records of each partition are appended to a list of chunks that grow
+ *  geometrically. Sealing hands the chunks over as they are, so records
+ *  are copied only once between the source fragment and the sort task.
+ */
+class ShuffleLogicalTask::InProgressBuffer {
+private:
+	struct Chunk {
+		LockedMemoryReference memory;
+		size_type size;
+		size_type capacity;
+	};
+	std::vector<std::vector<Chunk>> m_chunks;
+	std::vector<size_type> m_record_counts;
+	size_type m_total_size;
+public:
+	explicit InProgressBuffer(size_type partition_count)
+		: m_chunks(partition_count)
+		, m_record_counts(partition_count)
+		, m_total_size(0)
+	{ }
+
+	bool empty() const noexcept {
+		return m_total_size == 0;
+	}
+
+	size_type total_size() const noexcept {
+		return m_total_size;
+	}
+
+	/**
+	 *  Reserves a contiguous space for records in a partition.
+	 *
+	 *  @return A pointer to the reserved space of @c size bytes.
+	 */
+	uint8_t *append(
+		MemoryManager &memory_manager,
+		identifier_type partition,
+		size_type size,
+		size_type record_count,
+		identifier_type locality)
+	{
+		auto &chunks = m_chunks[partition];
+		if(chunks.empty() ||
+		   chunks.back().capacity - chunks.back().size < size)
+		{
+			const size_type last_capacity =
+				chunks.empty() ? 0 : chunks.back().capacity;
+			const auto capacity = std::max(size, std::min(
+				MAX_CHUNK_SIZE, std::max(MIN_CHUNK_SIZE, last_capacity * 2)));
+			chunks.push_back(Chunk{
+				memory_manager.allocate(capacity, locality).lock(),
+				0, capacity
+			});
+		}
+		auto &chunk = chunks.back();
+		const auto ptr =
+			static_cast<uint8_t *>(chunk.memory.pointer()) + chunk.size;
+		chunk.size += size;
+		m_record_counts[partition] += record_count;
+		m_total_size += size;
+		return ptr;
+	}
+
+	/**
+	 *  Takes the chunks of all partitions and the number of records in
+	 *  each partition.
+	 */
+	std::vector<std::vector<ShuffleLogicalTask::LockedRecordChunk>> seal(
+		std::vector<size_type> &record_counts)
+	{
+		const size_type partition_count = m_chunks.size();
+		std::vector<std::vector<ShuffleLogicalTask::LockedRecordChunk>>
+			sealed(partition_count);
+		for(identifier_type i = 0; i < partition_count; ++i){
+			for(auto &chunk : m_chunks[i]){
+				sealed[i].push_back(ShuffleLogicalTask::LockedRecordChunk{
+					std::move(chunk.memory), chunk.size
+				});
+			}
+			m_chunks[i].clear();
+		}
+		record_counts = std::move(m_record_counts);
+		m_record_counts.assign(partition_count, 0);
+		m_total_size = 0;
+		return sealed;
+	}
+};
+
+namespace {
+
+class ShuffleSampleCommand : public PhysicalTaskCommandBase {
+private:
+	ShuffleLogicalTask *m_logical_task;
+	MemoryReference m_unlocked_source;
+	LockedMemoryReference m_locked_source;
+public:
+	ShuffleSampleCommand(
+		ShuffleLogicalTask *logical_task,
+		MemoryReference source_buffer)
+		: m_logical_task(logical_task)
+		, m_unlocked_source(std::move(source_buffer))
+		, m_locked_source()
+	{ }
+	virtual void prepare(
+		ExecutionContext & /* context */,
+		const Locality & /* locality */) override
+	{
+		m_locked_source = m_unlocked_source.lock();
+		m_unlocked_source = MemoryReference();
+	}
+	virtual void run(
+		ExecutionContext & /* context */,
+		const Locality & /* locality */) override
+	{
+		m_logical_task->sample_fragment(std::move(m_locked_source));
+	}
+};
+
 class ShufflePartitionCommand : public PhysicalTaskCommandBase {
 private:
 	ShuffleLogicalTask *m_logical_task;
@@ -61,17 +261,20 @@ public:
 
 class ShuffleSortCommand : public PhysicalTaskCommandBase {
 private:
+	using RecordChunk = ShuffleLogicalTask::RecordChunk;
+	using LockedRecordChunk = ShuffleLogicalTask::LockedRecordChunk;
+
 	ShuffleLogicalTask *m_logical_task;
-	identifier_type m_partition;
-	std::vector<MemoryReference> m_unlocked_sources;
-	std::vector<LockedMemoryReference> m_locked_sources;
+	std::vector<identifier_type> m_partitions;
+	std::vector<std::vector<RecordChunk>> m_unlocked_sources;
+	std::vector<std::vector<LockedRecordChunk>> m_locked_sources;
 public:
 	ShuffleSortCommand(
 		ShuffleLogicalTask *logical_task,
-		identifier_type partition,
-		std::vector<MemoryReference> sources)
+		std::vector<identifier_type> partitions,
+		std::vector<std::vector<RecordChunk>> sources)
 		: m_logical_task(logical_task)
-		, m_partition(partition)
+		, m_partitions(std::move(partitions))
 		, m_unlocked_sources(std::move(sources))
 		, m_locked_sources()
 	{ }
@@ -79,11 +282,13 @@ public:
 		ExecutionContext & /* context */,
 		const Locality & /* locality */) override
 	{
-		std::vector<LockedMemoryReference> locked(m_unlocked_sources.size());
-		auto unlocked_it = m_unlocked_sources.begin();
-		auto locked_it = locked.begin();
-		while(unlocked_it != m_unlocked_sources.end()){
-			*(locked_it++) = (unlocked_it++)->lock();
+		std::vector<std::vector<LockedRecordChunk>> locked(
+			m_unlocked_sources.size());
+		for(identifier_type i = 0; i < m_unlocked_sources.size(); ++i){
+			for(auto &chunk : m_unlocked_sources[i]){
+				locked[i].push_back(
+					LockedRecordChunk{ chunk.memory.lock(), chunk.size });
+			}
 		}
 		m_locked_sources = std::move(locked);
 		m_unlocked_sources.clear();
@@ -92,8 +297,46 @@ public:
 		ExecutionContext &context,
 		const Locality & /* locality */) override
 	{
-		m_logical_task->sort_records(
-			context, std::move(m_locked_sources), m_partition);
+		for(identifier_type i = 0; i < m_partitions.size(); ++i){
+			m_logical_task->sort_records(
+				context, std::move(m_locked_sources[i]), m_partitions[i]);
+		}
+		m_locked_sources.clear();
+	}
+};
+
+class ShuffleSealBarrierCommand : public PhysicalTaskCommandBase {
+private:
+	ShuffleLogicalTask *m_logical_task;
+public:
+	explicit ShuffleSealBarrierCommand(
+		ShuffleLogicalTask *logical_task)
+		: m_logical_task(logical_task)
+	{ }
+	virtual void run(
+		ExecutionContext &context,
+		const Locality & /* locality */) override
+	{
+		m_logical_task->create_seal_tasks(context);
+	}
+};
+
+class ShuffleSealCommand : public PhysicalTaskCommandBase {
+private:
+	ShuffleLogicalTask *m_logical_task;
+	identifier_type m_worker;
+public:
+	ShuffleSealCommand(
+		ShuffleLogicalTask *logical_task,
+		identifier_type worker)
+		: m_logical_task(logical_task)
+		, m_worker(worker)
+	{ }
+	virtual void run(
+		ExecutionContext &context,
+		const Locality & /* locality */) override
+	{
+		m_logical_task->seal_in_progress_buffer(context, m_worker);
 	}
 };
 
@@ -113,24 +356,772 @@ public:
 	}
 };
 
+class ShuffleSplitCommand : public PhysicalTaskCommandBase {
+private:
+	ShuffleLogicalTask *m_logical_task;
+public:
+	explicit ShuffleSplitCommand(
+		ShuffleLogicalTask *logical_task)
+		: m_logical_task(logical_task)
+	{ }
+	virtual void run(
+		ExecutionContext &context,
+		const Locality & /* locality */) override
+	{
+		m_logical_task->create_partition_tasks(context);
+	}
+};
+
+class ShuffleBucketCommand : public PhysicalTaskCommandBase {
+private:
+	ShuffleLogicalTask *m_logical_task;
+	std::shared_ptr<ShuffleLogicalTask::ParallelSortState> m_state;
+	identifier_type m_bucket_task;
+	std::vector<ShuffleLogicalTask::RecordChunk> m_unlocked_sources;
+public:
+	ShuffleBucketCommand(
+		ShuffleLogicalTask *logical_task,
+		std::shared_ptr<ShuffleLogicalTask::ParallelSortState> state,
+		identifier_type bucket_task,
+		std::vector<ShuffleLogicalTask::RecordChunk> sources)
+		: m_logical_task(logical_task)
+		, m_state(std::move(state))
+		, m_bucket_task(bucket_task)
+		, m_unlocked_sources(std::move(sources))
+	{ }
+	virtual void prepare(
+		ExecutionContext & /* context */,
+		const Locality & /* locality */) override
+	{
+		std::vector<ShuffleLogicalTask::LockedRecordChunk> locked;
+		for(auto &chunk : m_unlocked_sources){
+			locked.push_back(ShuffleLogicalTask::LockedRecordChunk{
+				chunk.memory.lock(), chunk.size
+			});
+		}
+		m_state->sources[m_bucket_task] = std::move(locked);
+		m_unlocked_sources.clear();
+	}
+	virtual void run(
+		ExecutionContext & /* context */,
+		const Locality & /* locality */) override
+	{
+		m_logical_task->collect_records(*m_state, m_bucket_task);
+	}
+};
+
+class ShufflePrefixJoinCommand : public PhysicalTaskCommandBase {
+private:
+	ShuffleLogicalTask *m_logical_task;
+	std::shared_ptr<ShuffleLogicalTask::ParallelSortState> m_state;
+public:
+	ShufflePrefixJoinCommand(
+		ShuffleLogicalTask *logical_task,
+		std::shared_ptr<ShuffleLogicalTask::ParallelSortState> state)
+		: m_logical_task(logical_task)
+		, m_state(std::move(state))
+	{ }
+	virtual void run(
+		ExecutionContext &context,
+		const Locality & /* locality */) override
+	{
+		m_logical_task->create_distribute_tasks(context, m_state);
+	}
+};
+
+class ShuffleDistributeCommand : public PhysicalTaskCommandBase {
+private:
+	ShuffleLogicalTask *m_logical_task;
+	std::shared_ptr<ShuffleLogicalTask::ParallelSortState> m_state;
+	identifier_type m_bucket_task;
+public:
+	ShuffleDistributeCommand(
+		ShuffleLogicalTask *logical_task,
+		std::shared_ptr<ShuffleLogicalTask::ParallelSortState> state,
+		identifier_type bucket_task)
+		: m_logical_task(logical_task)
+		, m_state(std::move(state))
+		, m_bucket_task(bucket_task)
+	{ }
+	virtual void run(
+		ExecutionContext & /* context */,
+		const Locality & /* locality */) override
+	{
+		m_logical_task->bucket_records(*m_state, m_bucket_task);
+	}
+};
+
+class ShuffleRangeJoinCommand : public PhysicalTaskCommandBase {
+private:
+	ShuffleLogicalTask *m_logical_task;
+	std::shared_ptr<ShuffleLogicalTask::ParallelSortState> m_state;
+public:
+	ShuffleRangeJoinCommand(
+		ShuffleLogicalTask *logical_task,
+		std::shared_ptr<ShuffleLogicalTask::ParallelSortState> state)
+		: m_logical_task(logical_task)
+		, m_state(std::move(state))
+	{ }
+	virtual void run(
+		ExecutionContext &context,
+		const Locality & /* locality */) override
+	{
+		m_logical_task->create_range_sort_tasks(context, m_state);
+	}
+};
+
+class ShuffleRangeSortCommand : public PhysicalTaskCommandBase {
+private:
+	ShuffleLogicalTask *m_logical_task;
+	std::shared_ptr<ShuffleLogicalTask::ParallelSortState> m_state;
+	identifier_type m_range;
+public:
+	ShuffleRangeSortCommand(
+		ShuffleLogicalTask *logical_task,
+		std::shared_ptr<ShuffleLogicalTask::ParallelSortState> state,
+		identifier_type range)
+		: m_logical_task(logical_task)
+		, m_state(std::move(state))
+		, m_range(range)
+	{ }
+	virtual void run(
+		ExecutionContext & /* context */,
+		const Locality & /* locality */) override
+	{
+		m_logical_task->sort_record_range(*m_state, m_range);
+	}
+};
+
+class ShuffleAssembleCommand : public PhysicalTaskCommandBase {
+private:
+	ShuffleLogicalTask *m_logical_task;
+	std::shared_ptr<ShuffleLogicalTask::ParallelSortState> m_state;
+public:
+	ShuffleAssembleCommand(
+		ShuffleLogicalTask *logical_task,
+		std::shared_ptr<ShuffleLogicalTask::ParallelSortState> state)
+		: m_logical_task(logical_task)
+		, m_state(std::move(state))
+	{ }
+	virtual void run(
+		ExecutionContext &context,
+		const Locality & /* locality */) override
+	{
+		m_logical_task->assemble_sorted_records(context, *m_state);
+		m_state.reset();
+	}
+};
+
+
+const uint8_t *chunk_head(const ShuffleLogicalTask::LockedRecordChunk &chunk){
+	return static_cast<const uint8_t *>(chunk.memory.pointer());
+}
+
+/**
+ *  Appends pointers to records in a record chunk.
+ */
+const uint8_t **collect_chunk_records(
+	const uint8_t **dst, const ShuffleLogicalTask::LockedRecordChunk &src)
+{
+	auto data = chunk_head(src);
+	const auto data_end = data + src.size;
+	while(data != data_end){
+		const auto size = *reinterpret_cast<const size_type *>(data);
+		*(dst++) = data;
+		data += size + 2 * sizeof(size_type);
+	}
+	return dst;
+}
+
+size_type count_chunk_records(
+	const ShuffleLogicalTask::LockedRecordChunk &src)
+{
+	auto data = chunk_head(src);
+	const auto data_end = data + src.size;
+	size_type count = 0;
+	while(data != data_end){
+		const auto size = *reinterpret_cast<const size_type *>(data);
+		data += size + 2 * sizeof(size_type);
+		++count;
+	}
+	return count;
+}
+
+/**
+ *  Returns the length of the common prefix of keys of two records up to
+ *  the limit. Keys are treated as zero-padded as well as msd_radix_sort
+ *  does.
+ */
+size_type common_key_prefix(
+	const uint8_t *a, const uint8_t *b, size_type limit)
+{
+	for(size_type depth = 0; depth < limit; depth += sizeof(cache_type)){
+		const auto x = get_block<cache_type>(a, depth);
+		const auto y = get_block<cache_type>(b, depth);
+		if(x != y){
+			return std::min(limit, depth + __builtin_clzll(x ^ y) / 8);
+		}
+	}
+	return limit;
+}
+
+/**
+ *  Sorts records by keys.
+ *
+ *  All keys must share the first @c depth bytes, which must be a multiple
+ *  of sizeof(cache_type).
+ */
+void sort_record_pointers(
+	uint8_t *equals_to_left, const uint8_t **pointers, size_type n,
+	const SortOptions &options, size_type depth = 0)
+{
+	assert(depth % sizeof(cache_type) == 0);
+	if(options.in_place){
+		std::vector<cache_type> cache(n);
+		msd_radix_sort_in_place(
+			equals_to_left, cache.data(), pointers, n, depth);
+		return;
+	}
+	std::vector<cache_type> front_cache(n);
+	std::vector<cache_type> back_cache(n);
+	std::vector<const uint8_t *> back_pointers(n);
+	msd_radix_sort(
+		equals_to_left,
+		front_cache.data(), pointers,
+		back_cache.data(), back_pointers.data(),
+		n, depth, false, options.wide_digits);
+}
+
+/**
+ *  Groups records by keys with an open addressing hash table.
+ *
+ *  Records are reordered by a counting sort on group indices, so groups
+ *  appear in the order of their first records. Only the hash values and
+ *  group indices are stored in the table to keep probing in cache.
+ *  Keys are regarded as padded with zeros as well as msd_radix_sort, so
+ *  trailing zeros are ignored for both hashing and comparison.
+ */
+void group_record_pointers(
+	uint8_t *equals_to_left, const uint8_t **pointers, size_type n)
+{
+	struct Slot {
+		uint32_t hash;
+		uint32_t group;
+	};
+	assert(n < std::numeric_limits<uint32_t>::max());
+	const uint32_t empty_slot = 0;
+	size_type table_size = 1;
+	while(table_size < 2 * n){ table_size <<= 1; }
+	const size_type table_mask = table_size - 1;
+	std::vector<Slot> table(table_size, Slot{ 0u, empty_slot });
+	std::vector<const uint8_t *> heads;
+	std::vector<size_type> group_offsets(1);
+	std::vector<uint32_t> groups(n);
+	for(identifier_type i = 0; i < n; ++i){
+		const auto record = pointers[i];
+		const auto key = get_key_pointer(record);
+		auto key_length = get_key_length(record);
+		while(key_length > 0 && key[key_length - 1] == 0){ --key_length; }
+		const auto hash = hash_byte_sequence(key, key_length);
+		size_type slot = hash & table_mask;
+		while(true){
+			auto &s = table[slot];
+			if(s.group == empty_slot){
+				s.hash = hash;
+				s.group = static_cast<uint32_t>(heads.size() + 1);
+				heads.push_back(record);
+				group_offsets.push_back(0);
+				break;
+			}
+			const auto head = heads[s.group - 1];
+			if(s.hash == hash &&
+			   compare_padded_keys(
+			     get_key_pointer(head), get_key_length(head),
+			     key, key_length) == 0)
+			{
+				break;
+			}
+			slot = (slot + 1) & table_mask;
+		}
+		groups[i] = table[slot].group - 1;
+		++group_offsets[groups[i] + 1];
+	}
+
+	const size_type group_count = heads.size();
+	for(identifier_type i = 0; i < group_count; ++i){
+		equals_to_left[group_offsets[i]] = 0;
+		for(identifier_type j = 1; j < group_offsets[i + 1]; ++j){
+			equals_to_left[group_offsets[i] + j] = 1;
+		}
+		group_offsets[i + 1] += group_offsets[i];
+	}
+	std::vector<const uint8_t *> grouped(n);
+	for(identifier_type i = 0; i < n; ++i){
+		grouped[group_offsets[groups[i]]++] = pointers[i];
+	}
+	std::copy(grouped.begin(), grouped.end(), pointers);
+}
+
+/**
+ *  Accumulates sizes of a grouped serialized buffer from sorted records.
+ */
+class GroupedBufferStatistics {
+private:
+	size_type m_record_count;
+	size_type m_group_count;
+	size_type m_key_size;
+	size_type m_value_size;
+public:
+	GroupedBufferStatistics()
+		: m_record_count(0)
+		, m_group_count(0)
+		, m_key_size(0)
+		, m_value_size(0)
+	{ }
+	void add(const uint8_t *record, bool equals_to_left){
+		const auto ptr = reinterpret_cast<const size_type *>(record);
+		++m_record_count;
+		m_value_size += ptr[0] - ptr[1];
+		if(!equals_to_left){
+			m_key_size += ptr[1];
+			++m_group_count;
+		}
+	}
+	SerializedBuffer allocate(
+		MemoryManager &memory_manager, identifier_type locality) const
+	{
+		return SerializedBuffer::allocate_grouped_buffer(
+			memory_manager, m_record_count,
+			m_group_count, m_key_size, m_value_size, locality);
+	}
+};
+
+/**
+ *  Writes sorted records into a grouped serialized buffer.
+ */
+class GroupedBufferWriter {
+private:
+	SerializedBuffer m_buffer;
+	uint8_t *m_keys;
+	uint8_t *m_values;
+	size_type *m_keys_offsets;
+	size_type *m_values_offsets;
+	size_type *m_group_offsets;
+	identifier_type m_record_index;
+	identifier_type m_group_index;
+public:
+	explicit GroupedBufferWriter(SerializedBuffer buffer)
+		: m_buffer(std::move(buffer))
+		, m_keys(static_cast<uint8_t *>(m_buffer.keys_data()))
+		, m_values(static_cast<uint8_t *>(m_buffer.values_data()))
+		, m_keys_offsets(m_buffer.keys_offsets().data())
+		, m_values_offsets(m_buffer.values_offsets().data())
+		, m_group_offsets(m_buffer.value_group_offsets().data())
+		, m_record_index(0)
+		, m_group_index(0)
+	{
+		m_keys_offsets[0] = m_values_offsets[0] = m_group_offsets[0] = 0;
+	}
+	void write(const uint8_t *record, bool equals_to_left){
+		const auto ptr = reinterpret_cast<const size_type *>(record);
+		const auto key_length = ptr[1];
+		const auto value_length = ptr[0] - ptr[1];
+		const auto key_ptr = reinterpret_cast<const uint8_t *>(ptr + 2);
+		const auto i = m_record_index, j = m_group_index;
+		if(!equals_to_left){
+			memcpy(m_keys + m_keys_offsets[j], key_ptr, key_length);
+			m_keys_offsets[j + 1] = m_keys_offsets[j] + key_length;
+			m_group_offsets[j + 1] = m_group_offsets[j];
+			++m_group_index;
+		}
+		const auto value_ptr = key_ptr + key_length;
+		memcpy(m_values + m_values_offsets[i], value_ptr, value_length);
+		m_values_offsets[i + 1] = m_values_offsets[i] + value_length;
+		m_group_offsets[m_group_index] += value_length;
+		++m_record_index;
+	}
+	SerializedBuffer finish(){
+		m_buffer.record_count(m_record_index);
+		return std::move(m_buffer);
+	}
+};
+
+/**
+ *  Builds a grouped serialized buffer from sorted records.
+ */
+SerializedBuffer write_grouped_records(
+	MemoryManager &memory_manager,
+	const uint8_t * const *pointers,
+	const uint8_t *equals_to_left,
+	size_type record_count,
+	identifier_type locality)
+{
+	GroupedBufferStatistics statistics;
+	for(identifier_type i = 0; i < record_count; ++i){
+		statistics.add(pointers[i], equals_to_left[i]);
+	}
+	GroupedBufferWriter writer(
+		statistics.allocate(memory_manager, locality));
+	for(identifier_type i = 0; i < record_count; ++i){
+		writer.write(pointers[i], equals_to_left[i]);
+	}
+	return writer.finish();
+}
+
+/**
+ *  Compares keys of two records in the same order as msd_radix_sort.
+ *
+ *  msd_radix_sort regards keys as padded with zeros, so trailing zeros are
+ *  ignored for comparison.
+ */
+int compare_record_keys(const uint8_t *a, const uint8_t *b){
+	return compare_padded_keys(
+		get_key_pointer(a), get_key_length(a),
+		get_key_pointer(b), get_key_length(b));
+}
+
+/**
+ *  Copies records in the order of pointers to a contiguous buffer.
+ */
+void gather_records(
+	uint8_t *dst, const uint8_t * const *pointers, size_type record_count)
+{
+	for(identifier_type i = 0; i < record_count; ++i){
+		const auto length =
+			get_record_length(pointers[i]) + 2 * sizeof(size_type);
+		memcpy(dst, pointers[i], length);
+		dst += length;
+	}
+}
+
+/**
+ *  Sorts records in a record chunk in place.
+ */
+void sort_chunk_records(
+	ShuffleLogicalTask::LockedRecordChunk &chunk, const SortOptions &options)
+{
+	const auto n = count_chunk_records(chunk);
+	if(n <= 1){ return; }
+	std::vector<const uint8_t *> pointers(n);
+	std::vector<uint8_t> equals_to_left(n);
+	collect_chunk_records(pointers.data(), chunk);
+	sort_record_pointers(equals_to_left.data(), pointers.data(), n, options);
+	// records in the chunk are overwritten, read from the copy
+	const auto head = static_cast<uint8_t *>(chunk.memory.pointer());
+	std::vector<uint8_t> staging(head, head + chunk.size);
+	for(auto &ptr : pointers){ ptr = staging.data() + (ptr - head); }
+	gather_records(head, pointers.data(), n);
+}
+
+/**
+ *  Sorts records in chunks of a partition and writes them to a scratch
+ *  file as a sorted run.
+ */
+SpilledRun write_sorted_run(
+	ScratchFile &file,
+	const std::vector<ShuffleLogicalTask::LockedRecordChunk> &chunks,
+	size_type record_count,
+	const SortOptions &options)
+{
+	std::vector<const uint8_t *> pointers(record_count);
+	std::vector<uint8_t> equals_to_left(record_count);
+	auto pointers_tail = pointers.data();
+	size_type length = 0;
+	for(const auto &chunk : chunks){
+		pointers_tail = collect_chunk_records(pointers_tail, chunk);
+		length += chunk.size;
+	}
+	assert(pointers_tail == pointers.data() + record_count);
+	sort_record_pointers(
+		equals_to_left.data(), pointers.data(), record_count, options);
+	std::vector<uint8_t> staging(length);
+	gather_records(staging.data(), pointers.data(), record_count);
+	SpilledRun run;
+	run.offset = file.append(staging.data(), length);
+	run.length = length;
+	run.record_count = record_count;
+	return run;
+}
+
+/**
+ *  A sorted sequence of contiguous records in memory.
+ */
+struct SortedSlice {
+	const uint8_t *head;
+	const uint8_t *tail;
+};
+
+/**
+ *  Merges sorted records in memory and sorted runs in a scratch file.
+ *
+ *  Sorted records in memory are given as an array of pointers and as
+ *  slices of record chunks. The callback is invoked with each record in
+ *  the merged order and whether its key equals to the key of the previous
+ *  record.
+ */
+template <typename Callback>
+void merge_sorted_records(
+	const uint8_t * const *pointers,
+	size_type record_count,
+	std::vector<SortedSlice> slices,
+	const ScratchFile *file,
+	const std::vector<SpilledRun> &runs,
+	Callback callback)
+{
+	const size_type run_count = runs.size();
+	const size_type slice_count = slices.size();
+	std::vector<std::unique_ptr<SpilledRunReader>> readers(run_count);
+	for(identifier_type i = 0; i < run_count; ++i){
+		readers[i].reset(new SpilledRunReader(*file, runs[i]));
+	}
+	identifier_type pointer_cursor = 0;
+	// streams:
+	//   [0, run_count)                         spilled runs
+	//   [run_count, run_count + slice_count)   slices
+	//   run_count + slice_count                array of pointers
+	const auto head = [&](identifier_type i) -> const uint8_t * {
+		if(i < run_count){ return readers[i]->current(); }
+		i -= run_count;
+		if(i < slice_count){
+			const auto &slice = slices[i];
+			return slice.head != slice.tail ? slice.head : nullptr;
+		}
+		return pointer_cursor < record_count
+			? pointers[pointer_cursor]
+			: nullptr;
+	};
+	auto tree = make_loser_tree(
+		run_count + slice_count + 1,
+		[&](identifier_type a, identifier_type b) -> bool {
+			const auto x = head(a), y = head(b);
+			if(!x){ return false; }
+			if(!y){ return true; }
+			return compare_record_keys(x, y) < 0;
+		});
+	std::vector<uint8_t> last_record;
+	bool is_first = true;
+	while(true){
+		const auto top = tree.top();
+		const auto record = head(top);
+		if(!record){ break; }
+		const bool equals_to_left =
+			!is_first && compare_record_keys(last_record.data(), record) == 0;
+		if(!equals_to_left){
+			const auto length =
+				2 * sizeof(size_type) + get_key_length(record);
+			last_record.assign(record, record + length);
+		}
+		callback(record, equals_to_left);
+		is_first = false;
+		if(top < run_count){
+			readers[top]->advance();
+		}else if(top < run_count + slice_count){
+			auto &slice = slices[top - run_count];
+			slice.head += get_record_length(slice.head) + 2 * sizeof(size_type);
+		}else{
+			++pointer_cursor;
+		}
+		tree.update();
+	}
+}
+
+
+/**
+ *  Partitions records with merging values that have the same key.
+ *
+ *  Records are grouped by an open addressing hash table. A value of a group
+ *  refers to the source buffer until it is merged; merged values are stored
+ *  in an arena and the tail of the arena is reused when the group owns it.
+ *  The arena is compacted when less than half of it is live, so growing
+ *  values do not take quadratic space.
+ *
+ *  @param reserve  A function that takes a partition, a size in bytes and
+ *                  a record count and returns a space to write the records.
+ */
+template <typename ReserveFunc>
+void partition_combined_records(
+	const SerializedBuffer &src_sb,
+	size_type partition_count,
+	const PartitionerBase &partitioner,
+	const ShuffleLogicalTask::CombinerType &combiner,
+	ReserveFunc reserve)
+{
+	struct RecordGroup {
+		uint32_t hash;
+		unsigned int partition;
+		const uint8_t *key;
+		size_type key_length;
+		bool in_arena;
+		size_type value_offset;
+		size_type value_length;
+	};
+	const auto in_data = static_cast<const uint8_t *>(src_sb.values_data());
+	const auto in_offsets = src_sb.values_offsets();
+	const auto in_key_lengths = src_sb.key_lengths();
+	const size_type in_record_count = src_sb.record_count();
+
+	const uint32_t empty_slot = 0;
+	size_type table_size = 1;
+	while(table_size < 2 * in_record_count){ table_size <<= 1; }
+	const size_type table_mask = table_size - 1;
+	std::vector<uint32_t> table(table_size, empty_slot);
+	std::vector<RecordGroup> groups;
+	std::vector<uint8_t> arena, scratch;
+	size_type live_arena_size = 0;
+	const auto compact_arena = [&](){
+		std::vector<uint8_t> compacted;
+		compacted.reserve(live_arena_size);
+		for(auto &group : groups){
+			if(!group.in_arena){ continue; }
+			const auto head = arena.begin() + group.value_offset;
+			group.value_offset = compacted.size();
+			compacted.insert(
+				compacted.end(), head, head + group.value_length);
+		}
+		arena.swap(compacted);
+	};
+	for(identifier_type i = 0; i < in_record_count; ++i){
+		const auto key = in_data + in_offsets[i];
+		const auto key_length = in_key_lengths[i];
+		const auto value = key + key_length;
+		const auto value_length =
+			in_offsets[i + 1] - in_offsets[i] - key_length;
+		const auto hash = hash_byte_sequence(key, key_length);
+		size_type slot = hash & table_mask;
+		while(true){
+			if(table[slot] == empty_slot){
+				table[slot] = static_cast<uint32_t>(groups.size() + 1);
+				groups.push_back(RecordGroup{
+					hash,
+					static_cast<unsigned int>(
+						partitioner.partition(key, key_length)),
+					key, key_length,
+					false, static_cast<size_type>(value - in_data),
+					value_length
+				});
+				break;
+			}
+			auto &group = groups[table[slot] - 1];
+			if(group.hash == hash && group.key_length == key_length &&
+			   memcmp(group.key, key, key_length) == 0)
+			{
+				const auto lhs = group.in_arena
+					? arena.data() + group.value_offset
+					: in_data + group.value_offset;
+				scratch.resize(group.value_length + value_length);
+				const auto merged_length = combiner(
+					scratch.data(), lhs, group.value_length,
+					value, value_length);
+				assert(merged_length <= scratch.size());
+				if(group.in_arena){
+					live_arena_size -= group.value_length;
+				}
+				if(!group.in_arena ||
+				   group.value_offset + group.value_length != arena.size())
+				{
+					group.in_arena = true;
+					group.value_offset = arena.size();
+				}
+				arena.resize(group.value_offset);
+				arena.insert(
+					arena.end(),
+					scratch.begin(), scratch.begin() + merged_length);
+				group.value_length = merged_length;
+				live_arena_size += merged_length;
+				if(arena.size() > 2 * live_arena_size){ compact_arena(); }
+				break;
+			}
+			slot = (slot + 1) & table_mask;
+		}
+	}
+
+	// record format:
+	//   size_type record_length
+	//   size_type key_length
+	//   byte[]    key+value
+	std::vector<size_type> record_counts(partition_count);
+	std::vector<size_type> size_sums(partition_count);
+	for(const auto &group : groups){
+		record_counts[group.partition] += 1;
+		size_sums[group.partition] +=
+			group.key_length + group.value_length + 2 * sizeof(size_type);
+	}
+	std::vector<uint8_t *> cur_ptrs(partition_count);
+	for(identifier_type i = 0; i < partition_count; ++i){
+		if(record_counts[i] == 0){ continue; }
+		cur_ptrs[i] = reserve(i, size_sums[i], record_counts[i]);
+	}
+	for(const auto &group : groups){
+		const auto p = group.partition;
+		const auto value = group.in_arena
+			? arena.data() + group.value_offset
+			: in_data + group.value_offset;
+		const auto dst_ptr = reinterpret_cast<size_type *>(cur_ptrs[p]);
+		dst_ptr[0] = group.key_length + group.value_length;
+		dst_ptr[1] = group.key_length;
+		const auto dst_key = reinterpret_cast<uint8_t *>(dst_ptr + 2);
+		memcpy(dst_key, group.key, group.key_length);
+		memcpy(dst_key + group.key_length, value, group.value_length);
+		cur_ptrs[p] +=
+			group.key_length + group.value_length + 2 * sizeof(size_type);
+	}
+}
+
 }
 
 
 ShuffleLogicalTask::ShuffleLogicalTask(size_type partition_count)
+	: ShuffleLogicalTask(partition_count, CombinerType())
+{ }
+
+ShuffleLogicalTask::ShuffleLogicalTask(
+	size_type partition_count,
+	CombinerType combiner,
+	Partitioning partitioning,
+	Grouping grouping)
 	: LogicalTaskBase()
 	, m_mutex()
 	, m_partition_count(partition_count)
-	, m_partitioned_buffers()
+	, m_combiner(std::move(combiner))
+	, m_partitioning(partitioning)
+	, m_grouping(grouping)
+	, m_partitioner(new HashPartitioner(partition_count))
+	, m_seal_barrier()
+	, m_sort_barrier()
+	, m_sampled_keys()
+	, m_sampled_fragments()
+	, m_parallel_sort_threshold(DEFAULT_PARALLEL_SORT_THRESHOLD)
+	, m_in_progress_buffers()
+	, m_partition_chunks(partition_count)
+	, m_partition_record_counts(partition_count)
+	, m_partition_sizes(partition_count)
+	, m_scratch_file()
+	, m_spilled_runs(partition_count)
+	, m_sort_task_count(0)
+	, m_range_sort_task_count(0)
 { }
 
+ShuffleLogicalTask::~ShuffleLogicalTask() = default;
+
 void ShuffleLogicalTask::create_physical_tasks(ExecutionContext &context){
 	auto &scheduler = context.scheduler();
+	const auto concurrency = context.locality_manager().max_concurrency();
+	m_in_progress_buffers.clear();
+	for(identifier_type i = 0; i < concurrency; ++i){
+		m_in_progress_buffers.emplace_back(
+			new InProgressBuffer(m_partition_count));
+	}
 	const auto entry_id = scheduler.create_physical_task(
 		task_id(),
 		std::unique_ptr<PhysicalTaskCommandBase>(
 			new PhysicalTaskCommandBase()),
 		LocalityOption());
-	const auto barrier_id = scheduler.create_physical_task(
+	const auto seal_barrier_id = scheduler.create_physical_task(
+		task_id(),
+		std::unique_ptr<PhysicalTaskCommandBase>(
+			new ShuffleSealBarrierCommand(this)),
+		LocalityOption());
+	const auto sort_barrier_id = scheduler.create_physical_task(
 		task_id(),
 		std::unique_ptr<PhysicalTaskCommandBase>(
 			new ShuffleBarrierCommand(this)),
@@ -140,42 +1131,124 @@ void ShuffleLogicalTask::create_physical_tasks(ExecutionContext &context){
 		std::unique_ptr<PhysicalTaskCommandBase>(
 			new PhysicalTaskCommandBase()),
 		LocalityOption());
+	// Workers accumulate partitioned records and seal them between the
+	// seal barrier and the sort barrier:
+	//   entry -> partition[] -> seal_barrier -> seal[] -> sort_barrier
+	if(m_partitioning == Partitioning::RANGE){
+		// Fragments are sampled before the barrier and partitioned between
+		// the barrier and the seal barrier:
+		//   entry -> sample[] -> barrier -> partition[] -> seal_barrier
+		const auto barrier_id = scheduler.create_physical_task(
+			task_id(),
+			std::unique_ptr<PhysicalTaskCommandBase>(
+				new ShuffleSplitCommand(this)),
+			LocalityOption());
+		scheduler
+			.add_dependency(entry_id, barrier_id)
+			.add_dependency(barrier_id, seal_barrier_id);
+		barrier_task(barrier_id);
+	}else{
+		scheduler.add_dependency(entry_id, seal_barrier_id);
+		barrier_task(seal_barrier_id);
+	}
 	scheduler
-		.add_dependency(entry_id, barrier_id)
-		.add_dependency(barrier_id, terminal_id);
+		.add_dependency(seal_barrier_id, sort_barrier_id)
+		.add_dependency(sort_barrier_id, terminal_id);
 	entry_task(entry_id);
-	barrier_task(barrier_id);
 	terminal_task(terminal_id);
+	m_seal_barrier = seal_barrier_id;
+	m_sort_barrier = sort_barrier_id;
 }
 
 void ShuffleLogicalTask::commit_physical_tasks(ExecutionContext &context){
 	auto &scheduler = context.scheduler();
 	scheduler.commit_task(entry_task());
 	scheduler.commit_task(barrier_task());
+	if(m_seal_barrier != barrier_task()){
+		scheduler.commit_task(m_seal_barrier);
+	}
+	scheduler.commit_task(m_sort_barrier);
 	scheduler.commit_task(terminal_task());
 }
 
 
+void ShuffleLogicalTask::sample_fragment(LockedMemoryReference mobj){
+	std::vector<std::string> samples;
+	{
+		const SerializedBuffer sb(mobj);
+		const auto data = static_cast<const char *>(sb.values_data());
+		const auto offsets = sb.values_offsets();
+		const auto key_lengths = sb.key_lengths();
+		const size_type record_count = sb.record_count();
+		const auto step = std::max<size_type>(
+			1, record_count / (m_partition_count * SAMPLES_PER_PARTITION));
+		for(identifier_type i = 0; i < record_count; i += step){
+			samples.emplace_back(data + offsets[i], key_lengths[i]);
+		}
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::move(
+		samples.begin(), samples.end(), std::back_inserter(m_sampled_keys));
+	m_sampled_fragments.emplace_back(std::move(mobj));
+}
+
+void ShuffleLogicalTask::create_partition_tasks(ExecutionContext &context){
+	auto &scheduler = context.scheduler();
+	auto &locality_manager = context.locality_manager();
+	m_partitioner.reset(new RangePartitioner(RangePartitioner::from_samples(
+		std::move(m_sampled_keys), m_partition_count)));
+	m_sampled_keys.clear();
+	for(auto &mobj : m_sampled_fragments){
+		const auto mobj_loc = mobj.locality();
+		const auto pid = scheduler.create_physical_task(
+			task_id(),
+			std::unique_ptr<PhysicalTaskCommandBase>(
+				new ShufflePartitionCommand(this, std::move(mobj))),
+			LocalityOption(
+				locality_manager.random_worker_from_node(mobj_loc)));
+		scheduler
+			.add_dependency(barrier_task(), pid)
+			.add_dependency(pid, m_seal_barrier);
+		scheduler.commit_task(pid);
+	}
+	m_sampled_fragments.clear();
+}
+
+
 void ShuffleLogicalTask::partition_fragment(
 	ExecutionContext &context,
 	const Locality &locality,
 	LockedMemoryReference mobj)
 {
 	auto &memory_manager = context.memory_manager();
+	const auto worker = locality.self_thread_id();
+	auto &in_progress = *m_in_progress_buffers[worker];
 	const SerializedBuffer src_sb(std::move(mobj));
+	if(m_combiner){
+		const auto node = locality.self_node_id();
+		partition_combined_records(
+			src_sb, m_partition_count, *m_partitioner, m_combiner,
+			[&](identifier_type p, size_type size, size_type count){
+				return in_progress.append(
+					memory_manager, p, size, count, node);
+			});
+		flush_in_progress_buffer(context, worker, false);
+		return;
+	}
 	const auto in_data = static_cast<const uint8_t *>(src_sb.values_data());
 	const auto in_offsets = src_sb.values_offsets();
 	const auto in_key_lengths = src_sb.key_lengths();
 	const size_type in_record_count = src_sb.record_count();
 	const size_type partition_count = m_partition_count;
+	const auto &partitioner = *m_partitioner;
 
 	std::vector<size_type> record_counts(partition_count);
 	std::vector<size_type> size_sums(partition_count);
 	std::vector<unsigned int> partitions(in_record_count);
 	for(identifier_type i = 0; i < in_record_count; ++i){
 		const unsigned int p =
-			static_cast<unsigned int>(hash_byte_sequence(
-				in_data + in_offsets[i], in_key_lengths[i], partition_count));
+			static_cast<unsigned int>(partitioner.partition(
+				in_data + in_offsets[i], in_key_lengths[i]));
 		record_counts[p] += 1;
 		size_sums[p] += in_offsets[i + 1] - in_offsets[i];
 		partitions[i] = p;
@@ -185,20 +1258,13 @@ void ShuffleLogicalTask::partition_fragment(
 	//   size_type record_length
 	//   size_type key_length
 	//   byte[]    key+value
-	const auto total_buffer_size =
-		(in_offsets[in_record_count] - in_offsets[0]) +
-		2 * sizeof(size_type) * in_record_count;
-	ShuffleBuffer dst_sb(
-		memory_manager, total_buffer_size, partition_count,
-		locality.self_node_id());
-	auto dst_offsets = dst_sb.offsets();
-	dst_offsets[0] = 0;
-	std::vector<size_type> cur_offsets(partition_count);
+	std::vector<uint8_t *> cur_ptrs(partition_count);
 	for(identifier_type i = 0; i < partition_count; ++i){
-		dst_offsets[i + 1] =
-			dst_offsets[i] + size_sums[i] +
-			2 * sizeof(size_type) * record_counts[i];
-		cur_offsets[i] = dst_offsets[i];
+		if(record_counts[i] == 0){ continue; }
+		cur_ptrs[i] = in_progress.append(
+			memory_manager, i,
+			size_sums[i] + 2 * sizeof(size_type) * record_counts[i],
+			record_counts[i], locality.self_node_id());
 	}
 
 	for(identifier_type i = 0; i < in_record_count; ++i){
@@ -206,127 +1272,492 @@ void ShuffleLogicalTask::partition_fragment(
 		const auto record_length = in_offsets[i + 1] - in_offsets[i];
 		const auto key_length = in_key_lengths[i];
 		const auto total_length = record_length + 2 * sizeof(size_type);
-		const auto dst_ptr = reinterpret_cast<size_type *>(
-			reinterpret_cast<uint8_t *>(dst_sb.data()) + cur_offsets[p]);
+		const auto dst_ptr = reinterpret_cast<size_type *>(cur_ptrs[p]);
 		dst_ptr[0] = record_length;
 		dst_ptr[1] = key_length;
 		memcpy(dst_ptr + 2, in_data + in_offsets[i], record_length);
-		cur_offsets[p] += total_length;
+		cur_ptrs[p] += total_length;
 	}
 
+	flush_in_progress_buffer(context, worker, false);
+}
+
+void ShuffleLogicalTask::flush_in_progress_buffer(
+	ExecutionContext &context,
+	identifier_type worker,
+	bool force)
+{
+	auto &in_progress = *m_in_progress_buffers[worker];
+	if(in_progress.empty()){ return; }
+	if(!force){
+		// Seal records early when they are too large to be kept by a
+		// worker or the memory usage exceeds the limit
+		const bool is_memory_exceeded =
+			context.memory_manager().is_memory_exceeded();
+		if(!is_memory_exceeded &&
+		   in_progress.total_size() < IN_PROGRESS_BUFFER_LIMIT)
+		{
+			return;
+		}
+	}
+	std::vector<size_type> record_counts;
+	auto partition_chunks = in_progress.seal(record_counts);
+	store_partition_chunks(
+		context, std::move(partition_chunks), record_counts);
+}
+
+void ShuffleLogicalTask::create_seal_tasks(ExecutionContext &context){
+	auto &scheduler = context.scheduler();
+	for(identifier_type i = 0; i < m_in_progress_buffers.size(); ++i){
+		if(m_in_progress_buffers[i]->empty()){ continue; }
+		const auto pid = scheduler.create_physical_task(
+			task_id(),
+			std::unique_ptr<PhysicalTaskCommandBase>(
+				new ShuffleSealCommand(this, i)),
+			LocalityOption(i));
+		scheduler
+			.add_dependency(m_seal_barrier, pid)
+			.add_dependency(pid, m_sort_barrier);
+		scheduler.commit_task(pid);
+	}
+}
+
+void ShuffleLogicalTask::seal_in_progress_buffer(
+	ExecutionContext &context,
+	identifier_type worker)
+{
+	flush_in_progress_buffer(context, worker, true);
+}
+
+void ShuffleLogicalTask::store_partition_chunks(
+	ExecutionContext &context,
+	std::vector<std::vector<LockedRecordChunk>> partition_chunks,
+	const std::vector<size_type> &record_counts)
+{
+	const auto &config = context.configuration();
+	const SortOptions sort_options(config);
+	if(context.memory_manager().is_memory_exceeded()){
+		// Write sorted runs to the scratch file and release the chunks
+		ScratchFile *file = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(!m_scratch_file){
+				m_scratch_file.reset(
+					new ScratchFile(config.scratch_directory()));
+			}
+			file = m_scratch_file.get();
+		}
+		std::vector<SpilledRun> runs(m_partition_count);
+		for(identifier_type i = 0; i < m_partition_count; ++i){
+			if(record_counts[i] == 0){ continue; }
+			runs[i] = write_sorted_run(
+				*file, partition_chunks[i], record_counts[i], sort_options);
+			partition_chunks[i].clear();
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for(identifier_type i = 0; i < m_partition_count; ++i){
+			if(record_counts[i] == 0){ continue; }
+			m_partition_record_counts[i] += record_counts[i];
+			m_partition_sizes[i] += runs[i].length;
+			m_spilled_runs[i].push_back(runs[i]);
+		}
+		return;
+	}
+	if(config.presort_shuffle_runs()){
+		for(auto &chunks : partition_chunks){
+			for(auto &chunk : chunks){
+				sort_chunk_records(chunk, sort_options);
+			}
+		}
+	}
 	std::lock_guard<std::mutex> lock(m_mutex);
-	m_partitioned_buffers.emplace_back(
-		MemoryReference(dst_sb.raw_reference()));
+	for(identifier_type i = 0; i < m_partition_count; ++i){
+		for(auto &chunk : partition_chunks[i]){
+			m_partition_sizes[i] += chunk.size;
+			m_partition_chunks[i].push_back(RecordChunk{
+				MemoryReference(std::move(chunk.memory)), chunk.size
+			});
+		}
+		m_partition_record_counts[i] += record_counts[i];
+	}
 }
 
 void ShuffleLogicalTask::create_sort_tasks(ExecutionContext &context){
 	auto &scheduler = context.scheduler();
-	// create sort tasks
-	for(identifier_type p = 0; p < m_partition_count; ++p){
+	const auto concurrency = context.locality_manager().max_concurrency();
+	size_type total_size = 0;
+	for(const auto s : m_partition_sizes){ total_size += s; }
+	// Partitions larger than the fair share of a worker are split into
+	// multiple sort tasks and small adjacent partitions are coalesced into
+	// a sort task. Records in a partition are never moved to another
+	// partition because downstream tasks may join multiple shuffles.
+	const auto fair_share = total_size / concurrency;
+	const auto coalesce_limit = std::max<size_type>(
+		total_size / (concurrency * SORT_TASKS_PER_WORKER),
+		MIN_SORT_TASK_SIZE);
+	std::vector<identifier_type> coalesced;
+	std::vector<std::vector<RecordChunk>> coalesced_chunks;
+	size_type coalesced_size = 0;
+	const auto flush_coalesced = [&](){
+		if(coalesced.empty()){ return; }
+		++m_sort_task_count;
 		const auto pid = scheduler.create_physical_task(
 			task_id(),
 			std::unique_ptr<PhysicalTaskCommandBase>(
 				new ShuffleSortCommand(
-					this, p, m_partitioned_buffers)),
+					this, std::move(coalesced),
+					std::move(coalesced_chunks))),
 			LocalityOption());
 		scheduler
-			.add_dependency(barrier_task(), pid)
+			.add_dependency(m_sort_barrier, pid)
 			.add_dependency(pid, terminal_task());
 		scheduler.commit_task(pid);
+		coalesced.clear();
+		coalesced_chunks.clear();
+		coalesced_size = 0;
+	};
+	for(identifier_type p = 0; p < m_partition_count; ++p){
+		const auto record_count = m_partition_record_counts[p];
+		const auto size = m_partition_sizes[p];
+		if(concurrency > 1 && m_spilled_runs[p].empty() &&
+		   record_count >= m_parallel_sort_threshold &&
+		   size > fair_share)
+		{
+			create_parallel_sort_tasks(context, p);
+			continue;
+		}
+		if(!coalesced.empty() && coalesced_size + size > coalesce_limit){
+			flush_coalesced();
+		}
+		coalesced.push_back(p);
+		coalesced_chunks.push_back(std::move(m_partition_chunks[p]));
+		coalesced_size += size;
+	}
+	flush_coalesced();
+	m_partition_chunks.assign(m_partition_count, std::vector<RecordChunk>());
+}
+
+void ShuffleLogicalTask::create_parallel_sort_tasks(
+	ExecutionContext &context, identifier_type partition)
+{
+	auto &scheduler = context.scheduler();
+	const auto concurrency = context.locality_manager().max_concurrency();
+	auto &chunks = m_partition_chunks[partition];
+	const size_type fragment_count = chunks.size();
+	const auto record_count = m_partition_record_counts[partition];
+	const size_type bucket_task_count = std::max<size_type>(1, std::min(
+		std::min(fragment_count, concurrency),
+		(record_count + m_parallel_sort_threshold - 1) /
+			std::max<size_type>(1, m_parallel_sort_threshold)));
+	auto state = std::make_shared<ParallelSortState>(
+		partition, bucket_task_count,
+		SortOptions(context.configuration()));
+	// barrier -> bucket[] -> prefix -> (distribute[]) -> join -> (range[])
+	//   -> assemble -> terminal
+	const auto prefix_id = scheduler.create_physical_task(
+		task_id(),
+		std::unique_ptr<PhysicalTaskCommandBase>(
+			new ShufflePrefixJoinCommand(this, state)),
+		LocalityOption());
+	const auto join_id = scheduler.create_physical_task(
+		task_id(),
+		std::unique_ptr<PhysicalTaskCommandBase>(
+			new ShuffleRangeJoinCommand(this, state)),
+		LocalityOption());
+	const auto assemble_id = scheduler.create_physical_task(
+		task_id(),
+		std::unique_ptr<PhysicalTaskCommandBase>(
+			new ShuffleAssembleCommand(this, state)),
+		LocalityOption());
+	scheduler
+		.add_dependency(prefix_id, join_id)
+		.add_dependency(join_id, assemble_id)
+		.add_dependency(assemble_id, terminal_task());
+	state->prefix_task = prefix_id;
+	state->join_task = join_id;
+	state->assemble_task = assemble_id;
+	for(identifier_type i = 0; i < bucket_task_count; ++i){
+		const auto head = fragment_count * i / bucket_task_count;
+		const auto tail = fragment_count * (i + 1) / bucket_task_count;
+		std::vector<RecordChunk> sources(
+			std::make_move_iterator(chunks.begin() + head),
+			std::make_move_iterator(chunks.begin() + tail));
+		const auto pid = scheduler.create_physical_task(
+			task_id(),
+			std::unique_ptr<PhysicalTaskCommandBase>(
+				new ShuffleBucketCommand(
+					this, state, i, std::move(sources))),
+			LocalityOption());
+		scheduler
+			.add_dependency(m_sort_barrier, pid)
+			.add_dependency(pid, prefix_id);
+		scheduler.commit_task(pid);
 	}
-	m_partitioned_buffers.clear();
+	scheduler.add_dependency(m_sort_barrier, prefix_id);
+	scheduler.commit_task(prefix_id);
+	scheduler.commit_task(join_id);
+	scheduler.commit_task(assemble_id);
 }
 
 void ShuffleLogicalTask::sort_records(
 	ExecutionContext &context,
-	std::vector<LockedMemoryReference> mobjs,
+	std::vector<LockedRecordChunk> chunks,
 	identifier_type partition)
 {
 	auto &memory_manager = context.memory_manager();
-	const size_type fragment_count = mobjs.size();
-	std::vector<ShuffleBuffer> src_sb(fragment_count);
-	size_type total_record_count = 0;
-	for(identifier_type i = 0; i < fragment_count; ++i){
-		src_sb[i] = ShuffleBuffer(std::move(mobjs[i]), m_partition_count);
-		auto data =
-			static_cast<const uint8_t *>(src_sb[i].data()) +
-			src_sb[i].offsets()[partition];
-		const auto data_end =
-			static_cast<const uint8_t *>(src_sb[i].data()) +
-			src_sb[i].offsets()[partition + 1];
-		while(data != data_end){
-			const auto size = *reinterpret_cast<const size_type *>(data);
-			data += size + 2 * sizeof(size_type);
-			++total_record_count;
-		}
-	}
-
-	std::vector<uint8_t> equals_to_left(total_record_count);
-	std::vector<cache_type> front_cache(total_record_count);
-	std::vector<cache_type> back_cache(total_record_count);
-	std::vector<const uint8_t *> front_pointers(total_record_count);
-	std::vector<const uint8_t *> back_pointers(total_record_count);
-	for(identifier_type i = 0, k = 0; i < fragment_count; ++i){
-		auto data =
-			static_cast<const uint8_t *>(src_sb[i].data()) +
-			src_sb[i].offsets()[partition];
-		const auto data_end =
-			static_cast<const uint8_t *>(src_sb[i].data()) +
-			src_sb[i].offsets()[partition + 1];
-		while(data != data_end){
-			const auto size = *reinterpret_cast<const size_type *>(data);
-			front_pointers[k++] = data;
-			data += size + 2 * sizeof(size_type);
+	const bool is_presorted = context.configuration().presort_shuffle_runs();
+
+	// Sort records in memory unless they are sorted by partition tasks
+	std::vector<SortedSlice> slices;
+	std::vector<uint8_t> equals_to_left;
+	std::vector<const uint8_t *> pointers;
+	if(is_presorted){
+		for(const auto &chunk : chunks){
+			if(chunk.size == 0){ continue; }
+			const auto head = chunk_head(chunk);
+			slices.push_back(SortedSlice{ head, head + chunk.size });
+		}
+	}else{
+		size_type total_record_count = 0;
+		for(const auto &chunk : chunks){
+			total_record_count += count_chunk_records(chunk);
+		}
+		equals_to_left.resize(total_record_count);
+		pointers.resize(total_record_count);
+		auto pointers_tail = pointers.data();
+		for(const auto &chunk : chunks){
+			pointers_tail = collect_chunk_records(pointers_tail, chunk);
+		}
+		if(m_grouping == Grouping::HASH && m_spilled_runs[partition].empty()){
+			group_record_pointers(
+				equals_to_left.data(), pointers.data(), total_record_count);
+		}else{
+			sort_record_pointers(
+				equals_to_left.data(), pointers.data(), total_record_count,
+				SortOptions(context.configuration()));
 		}
 	}
-	msd_radix_sort(
-		equals_to_left.data(),
-		front_cache.data(), front_pointers.data(),
-		back_cache.data(), back_pointers.data(),
-		total_record_count);
 
-	size_type group_count = 0, total_key_size = 0, total_value_size = 0;
-	for(identifier_type i = 0; i < total_record_count; ++i){
-		const size_type *ptr =
-			reinterpret_cast<const size_type *>(front_pointers[i]);
-		const auto key_length = ptr[1];
-		const auto value_length = ptr[0] - ptr[1];
-		total_value_size += value_length;
-		if(!equals_to_left[i]){
-			total_key_size += key_length;
-			++group_count;
+	auto &locality_manager = context.locality_manager();
+	const auto locality = locality_manager.partition_mapping(partition);
+	const auto &runs = m_spilled_runs[partition];
+	if(!runs.empty()){
+		// Merge with sorted runs in the scratch file in two passes
+		GroupedBufferStatistics statistics;
+		merge_sorted_records(
+			pointers.data(), pointers.size(), slices,
+			m_scratch_file.get(), runs,
+			[&](const uint8_t *record, bool equals_to_left){
+				statistics.add(record, equals_to_left);
+			});
+		GroupedBufferWriter writer(
+			statistics.allocate(memory_manager, locality));
+		merge_sorted_records(
+			pointers.data(), pointers.size(), slices,
+			m_scratch_file.get(), runs,
+			[&](const uint8_t *record, bool equals_to_left){
+				writer.write(record, equals_to_left);
+			});
+		SerializedBuffer dst_sb = writer.finish();
+		commit_fragment(
+			context, 0, partition, MemoryReference(dst_sb.raw_reference()));
+		return;
+	}
+	if(is_presorted){
+		// All records are in memory and their pointers are stable
+		merge_sorted_records(
+			nullptr, 0, slices, nullptr, runs,
+			[&](const uint8_t *record, bool is_equal){
+				pointers.push_back(record);
+				equals_to_left.push_back(is_equal);
+			});
+	}
+	SerializedBuffer dst_sb = write_grouped_records(
+		memory_manager, pointers.data(), equals_to_left.data(),
+		pointers.size(), locality);
+	commit_fragment(
+		context, 0, partition, MemoryReference(dst_sb.raw_reference()));
+}
+
+void ShuffleLogicalTask::collect_records(
+	ParallelSortState &state, identifier_type bucket_task)
+{
+	const auto &sources = state.sources[bucket_task];
+	size_type record_count = 0;
+	for(const auto &src : sources){
+		record_count += count_chunk_records(src);
+	}
+	std::vector<const uint8_t *> pointers(record_count);
+	auto pointers_tail = pointers.data();
+	for(const auto &src : sources){
+		pointers_tail = collect_chunk_records(pointers_tail, src);
+	}
+	// Find the prefix shared by all keys in this task
+	size_type prefix_length = 0;
+	if(record_count > 0){
+		const auto first = pointers[0];
+		prefix_length = get_key_length(first);
+		for(identifier_type i = 1; prefix_length > 0 && i < record_count; ++i){
+			prefix_length =
+				common_key_prefix(first, pointers[i], prefix_length);
 		}
 	}
-	auto &locality_manager = context.locality_manager();
-	SerializedBuffer dst_sb = SerializedBuffer::allocate_grouped_buffer(
-		memory_manager, total_record_count,
-		group_count, total_key_size, total_value_size,
-		locality_manager.partition_mapping(partition));
-	const auto dst_keys = static_cast<uint8_t *>(dst_sb.keys_data());
-	const auto dst_values = static_cast<uint8_t *>(dst_sb.values_data());
-	auto dst_keys_offsets = dst_sb.keys_offsets();
-	auto dst_values_offsets = dst_sb.values_offsets();
-	auto dst_group_offsets = dst_sb.value_group_offsets();
-	dst_keys_offsets[0] = dst_values_offsets[0] = dst_group_offsets[0] = 0;
-	for(identifier_type i = 0, j = 0; i < total_record_count; ++i){
-		const auto ptr =
-			reinterpret_cast<const size_type *>(front_pointers[i]);
-		const auto key_length = ptr[1];
-		const auto value_length = ptr[0] - ptr[1];
-		const auto key_ptr = reinterpret_cast<const uint8_t *>(ptr + 2);
-		if(!equals_to_left[i]){
-			memcpy(dst_keys + dst_keys_offsets[j], key_ptr, key_length);
-			dst_keys_offsets[j + 1] = dst_keys_offsets[j] + key_length;
-			dst_group_offsets[j + 1] = dst_group_offsets[j];
-			++j;
+	state.prefix_lengths[bucket_task] = prefix_length;
+	state.bucketed_pointers[bucket_task] = std::move(pointers);
+}
+
+void ShuffleLogicalTask::create_distribute_tasks(
+	ExecutionContext &context,
+	const std::shared_ptr<ParallelSortState> &state)
+{
+	auto &scheduler = context.scheduler();
+	// Skip the prefix shared by all keys in the partition, so that records
+	// with a common prefix are still distributed into multiple buckets
+	const uint8_t *reference = nullptr;
+	size_type depth = 0;
+	const auto bucket_task_count = state->bucketed_pointers.size();
+	for(identifier_type i = 0; i < bucket_task_count; ++i){
+		const auto &pointers = state->bucketed_pointers[i];
+		if(pointers.empty()){ continue; }
+		const auto prefix_length = state->prefix_lengths[i];
+		if(!reference){
+			reference = pointers[0];
+			depth = prefix_length;
+		}else{
+			depth = std::min(depth, common_key_prefix(
+				reference, pointers[0], prefix_length));
 		}
-		const auto value_ptr = key_ptr + key_length;
-		memcpy(
-			dst_values + dst_values_offsets[i], value_ptr, value_length);
-		dst_values_offsets[i + 1] = dst_values_offsets[i] + value_length;
-		dst_group_offsets[j] += value_length;
 	}
-	dst_sb.record_count(total_record_count);
+	state->bucket_depth = depth;
+	for(identifier_type i = 0; i < bucket_task_count; ++i){
+		const auto pid = scheduler.create_physical_task(
+			task_id(),
+			std::unique_ptr<PhysicalTaskCommandBase>(
+				new ShuffleDistributeCommand(this, state, i)),
+			LocalityOption());
+		scheduler
+			.add_dependency(state->prefix_task, pid)
+			.add_dependency(pid, state->join_task);
+		scheduler.commit_task(pid);
+	}
+}
+
+void ShuffleLogicalTask::bucket_records(
+	ParallelSortState &state, identifier_type bucket_task)
+{
+	const auto &pointers = state.bucketed_pointers[bucket_task];
+	const size_type record_count = pointers.size();
+	// Distribute records by the byte at the bucket depth. Short keys are
+	// treated as zero-padded as well as msd_radix_sort does.
+	const auto depth = state.bucket_depth;
+	const auto bucket_byte = [depth](const uint8_t *ptr) -> size_type {
+		return depth < get_key_length(ptr) ? get_key_pointer(ptr)[depth] : 0;
+	};
+	auto &offsets = state.bucket_offsets[bucket_task];
+	std::fill(offsets.begin(), offsets.end(), 0);
+	for(const auto ptr : pointers){ ++offsets[bucket_byte(ptr) + 1]; }
+	for(identifier_type i = 0; i < PARALLEL_SORT_BUCKET_COUNT; ++i){
+		offsets[i + 1] += offsets[i];
+	}
+	std::vector<size_type> cur_offsets(offsets.begin(), offsets.end() - 1);
+	std::vector<const uint8_t *> bucketed(record_count);
+	for(const auto ptr : pointers){
+		bucketed[cur_offsets[bucket_byte(ptr)]++] = ptr;
+	}
+	state.bucketed_pointers[bucket_task] = std::move(bucketed);
+}
+
+void ShuffleLogicalTask::create_range_sort_tasks(
+	ExecutionContext &context,
+	const std::shared_ptr<ParallelSortState> &state)
+{
+	auto &scheduler = context.scheduler();
+	const auto concurrency = context.locality_manager().max_concurrency();
+	std::vector<size_type> bucket_sizes(PARALLEL_SORT_BUCKET_COUNT);
+	size_type record_count = 0;
+	for(const auto &offsets : state->bucket_offsets){
+		for(identifier_type i = 0; i < PARALLEL_SORT_BUCKET_COUNT; ++i){
+			bucket_sizes[i] += offsets[i + 1] - offsets[i];
+		}
+		record_count += offsets[PARALLEL_SORT_BUCKET_COUNT];
+	}
+	// Coalesce adjacent buckets into ranges of roughly equal sizes
+	const size_type range_limit = std::min(
+		PARALLEL_SORT_BUCKET_COUNT, 2 * concurrency);
+	const size_type range_target =
+		std::max<size_type>(1, (record_count + range_limit - 1) / range_limit);
+	state->range_buckets.assign(1, 0);
+	state->range_offsets.assign(1, 0);
+	size_type accumulated = 0;
+	for(identifier_type i = 0; i < PARALLEL_SORT_BUCKET_COUNT; ++i){
+		accumulated += bucket_sizes[i];
+		if(accumulated >= range_target ||
+		   i + 1 == PARALLEL_SORT_BUCKET_COUNT)
+		{
+			state->range_buckets.push_back(i + 1);
+			state->range_offsets.push_back(
+				state->range_offsets.back() + accumulated);
+			accumulated = 0;
+		}
+	}
+	state->pointers.assign(record_count, nullptr);
+	state->equals_to_left.assign(record_count, 0);
+
+	const auto range_count = state->range_buckets.size() - 1;
+	for(identifier_type i = 0; i < range_count; ++i){
+		if(state->range_offsets[i] == state->range_offsets[i + 1]){
+			continue;
+		}
+		++m_range_sort_task_count;
+		const auto pid = scheduler.create_physical_task(
+			task_id(),
+			std::unique_ptr<PhysicalTaskCommandBase>(
+				new ShuffleRangeSortCommand(this, state, i)),
+			LocalityOption());
+		scheduler
+			.add_dependency(state->join_task, pid)
+			.add_dependency(pid, state->assemble_task);
+		scheduler.commit_task(pid);
+	}
+}
+
+void ShuffleLogicalTask::sort_record_range(
+	ParallelSortState &state, identifier_type range)
+{
+	const auto bucket_head = state.range_buckets[range];
+	const auto bucket_tail = state.range_buckets[range + 1];
+	const auto offset = state.range_offsets[range];
+	const auto n = state.range_offsets[range + 1] - offset;
+	auto pointers = state.pointers.data() + offset;
+	auto pointers_tail = pointers;
+	for(identifier_type i = 0; i < state.bucketed_pointers.size(); ++i){
+		const auto &src = state.bucketed_pointers[i];
+		const auto &offsets = state.bucket_offsets[i];
+		pointers_tail = std::copy(
+			src.begin() + offsets[bucket_head],
+			src.begin() + offsets[bucket_tail],
+			pointers_tail);
+	}
+	assert(pointers_tail == pointers + n);
+	// Keys in a range share the bytes before the bucket depth
+	const auto depth =
+		state.bucket_depth & ~(sizeof(cache_type) - 1);
+	sort_record_pointers(
+		state.equals_to_left.data() + offset, pointers, n,
+		state.sort_options, depth);
+}
+
+void ShuffleLogicalTask::assemble_sorted_records(
+	ExecutionContext &context, ParallelSortState &state)
+{
+	auto &memory_manager = context.memory_manager();
+	auto &locality_manager = context.locality_manager();
+	const auto partition = state.partition;
+	SerializedBuffer dst_sb = write_grouped_records(
+		memory_manager, state.pointers.data(), state.equals_to_left.data(),
+		state.pointers.size(), locality_manager.partition_mapping(partition));
+	state.sources.clear();
+	state.bucketed_pointers.clear();
 	commit_fragment(
 		context, 0, partition, MemoryReference(dst_sb.raw_reference()));
 }
@@ -345,10 +1776,15 @@ void ShuffleLogicalTask::receive_fragment(
 	auto &scheduler = context.scheduler();
 	auto &locality_manager = context.locality_manager();
 	const auto mobj_loc = mobj.locality();
+	std::unique_ptr<PhysicalTaskCommandBase> command;
+	if(m_partitioning == Partitioning::RANGE){
+		command.reset(new ShuffleSampleCommand(this, std::move(mobj)));
+	}else{
+		command.reset(new ShufflePartitionCommand(this, std::move(mobj)));
+	}
 	const auto pid = scheduler.create_physical_task(
 		task_id(),
-		std::unique_ptr<PhysicalTaskCommandBase>(
-			new ShufflePartitionCommand(this, std::move(mobj))),
+		std::move(command),
 		LocalityOption(
 			locality_manager.random_worker_from_node(mobj_loc)));
 	scheduler
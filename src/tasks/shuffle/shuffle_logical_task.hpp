@@ -19,43 +19,157 @@
 #include <vector>
 #include <mutex>
 #include <memory>
+#include <atomic>
+#include <string>
+#include "m3bp/input_port.hpp"
 #include "tasks/logical_task_base.hpp"
 #include "memory/memory_reference.hpp"
+#include "tasks/shuffle/spilled_run.hpp"
+#include "tasks/shuffle/partitioner.hpp"
 
 namespace m3bp {
 
 class Scheduler;
 class MemoryManager;
-class ShuffleBuffer;
+class ScratchFile;
 
 class ShuffleLogicalTask : public LogicalTaskBase {
 
+public:
+	using CombinerType = InputPort::ValueCombinerType;
+	class ParallelSortState;
+
+	/**
+	 *  Records of a partition stored at the head of a memory object.
+	 */
+	struct RecordChunk {
+		MemoryReference memory;
+		size_type size;
+	};
+
+	struct LockedRecordChunk {
+		LockedMemoryReference memory;
+		size_type size;
+	};
+
 private:
 	class InProgressBuffer;
 
 	std::mutex m_mutex;
 	size_type m_partition_count;
-	std::vector<MemoryReference> m_partitioned_buffers;
+	CombinerType m_combiner;
+	Partitioning m_partitioning;
+	Grouping m_grouping;
+	std::unique_ptr<PartitionerBase> m_partitioner;
+	PhysicalTaskIdentifier m_seal_barrier;
+	PhysicalTaskIdentifier m_sort_barrier;
+	std::vector<std::string> m_sampled_keys;
+	std::vector<MemoryReference> m_sampled_fragments;
+	size_type m_parallel_sort_threshold;
+	std::vector<std::unique_ptr<InProgressBuffer>> m_in_progress_buffers;
+	std::vector<std::vector<RecordChunk>> m_partition_chunks;
+	std::vector<size_type> m_partition_record_counts;
+	std::vector<size_type> m_partition_sizes;
+	std::unique_ptr<ScratchFile> m_scratch_file;
+	std::vector<std::vector<SpilledRun>> m_spilled_runs;
+	std::atomic<size_type> m_sort_task_count;
+	std::atomic<size_type> m_range_sort_task_count;
+
+	void flush_in_progress_buffer(
+		ExecutionContext &context,
+		identifier_type worker,
+		bool force);
+
+	void store_partition_chunks(
+		ExecutionContext &context,
+		std::vector<std::vector<LockedRecordChunk>> partition_chunks,
+		const std::vector<size_type> &record_counts);
+
+	void create_parallel_sort_tasks(
+		ExecutionContext &context, identifier_type partition);
 
 public:
 	explicit ShuffleLogicalTask(size_type partition_count);
+	ShuffleLogicalTask(
+		size_type partition_count,
+		CombinerType combiner,
+		Partitioning partitioning = Partitioning::HASH,
+		Grouping grouping = Grouping::SORT);
+	~ShuffleLogicalTask();
 
 	virtual void create_physical_tasks(ExecutionContext &context) override;
 	virtual void commit_physical_tasks(ExecutionContext &context) override;
 
+	/**
+	 *  Sets the minimum number of records in a partition to sort it by
+	 *  multiple physical tasks.
+	 *
+	 *  A partition is sorted in parallel when it is larger than this
+	 *  threshold and holds more bytes than the fair share of a worker.
+	 */
+	ShuffleLogicalTask &parallel_sort_threshold(size_type threshold){
+		m_parallel_sort_threshold = threshold;
+		return *this;
+	}
+
+	/**
+	 *  Gets the number of physical tasks that have sorted whole partitions.
+	 *  A task may sort multiple coalesced partitions.
+	 */
+	size_type sort_task_count() const noexcept {
+		return m_sort_task_count.load();
+	}
+
+	/**
+	 *  Gets the number of physical tasks that have sorted ranges of
+	 *  partitions sorted in parallel.
+	 */
+	size_type range_sort_task_count() const noexcept {
+		return m_range_sort_task_count.load();
+	}
+
+	void sample_fragment(LockedMemoryReference mobj);
+
+	void create_partition_tasks(ExecutionContext &context);
 
 	void partition_fragment(
 		ExecutionContext &context,
 		const Locality &locality,
 		LockedMemoryReference mobj);
 
+	void create_seal_tasks(ExecutionContext &context);
+
+	void seal_in_progress_buffer(
+		ExecutionContext &context,
+		identifier_type worker);
+
 	void create_sort_tasks(ExecutionContext &context);
 
 	void sort_records(
 		ExecutionContext &context,
-		std::vector<LockedMemoryReference> mobjs,
+		std::vector<LockedRecordChunk> chunks,
 		identifier_type partition);
 
+	void collect_records(
+		ParallelSortState &state, identifier_type bucket_task);
+
+	void create_distribute_tasks(
+		ExecutionContext &context,
+		const std::shared_ptr<ParallelSortState> &state);
+
+	void bucket_records(
+		ParallelSortState &state, identifier_type bucket_task);
+
+	void create_range_sort_tasks(
+		ExecutionContext &context,
+		const std::shared_ptr<ParallelSortState> &state);
+
+	void sort_record_range(
+		ParallelSortState &state, identifier_type range);
+
+	void assemble_sorted_records(
+		ExecutionContext &context, ParallelSortState &state);
+
 protected:
 	virtual void receive_fragment(
 		ExecutionContext &context,
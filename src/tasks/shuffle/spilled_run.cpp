@@ -0,0 +1,70 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <cstring>
+#include "tasks/shuffle/spilled_run.hpp"
+#include "system/scratch_file.hpp"
+
+namespace m3bp {
+
+const size_type SpilledRunReader::DEFAULT_BUFFER_SIZE;
+
+SpilledRunReader::SpilledRunReader(
+	const ScratchFile &file, const SpilledRun &run)
+	: m_file(&file)
+	, m_next_offset(run.offset)
+	, m_end_offset(run.offset + run.length)
+	, m_buffer(std::min(DEFAULT_BUFFER_SIZE, run.length))
+	, m_head(0)
+	, m_tail(0)
+	, m_is_valid(false)
+{
+	load();
+}
+
+void SpilledRunReader::advance(){
+	const auto record_length =
+		reinterpret_cast<const size_type *>(m_buffer.data() + m_head)[0];
+	m_head += record_length + 2 * sizeof(size_type);
+	load();
+}
+
+bool SpilledRunReader::fill(size_type length){
+	if(m_tail - m_head >= length){ return true; }
+	const auto remaining = m_end_offset - m_next_offset;
+	if(m_tail - m_head + remaining < length){ return false; }
+	memmove(m_buffer.data(), m_buffer.data() + m_head, m_tail - m_head);
+	m_tail -= m_head;
+	m_head = 0;
+	if(m_buffer.size() < length){ m_buffer.resize(length); }
+	const auto read_length =
+		std::min(m_buffer.size() - m_tail, remaining);
+	m_file->read(m_buffer.data() + m_tail, read_length, m_next_offset);
+	m_next_offset += read_length;
+	m_tail += read_length;
+	return true;
+}
+
+void SpilledRunReader::load(){
+	m_is_valid = false;
+	if(!fill(2 * sizeof(size_type))){ return; }
+	const auto record_length =
+		reinterpret_cast<const size_type *>(m_buffer.data() + m_head)[0];
+	if(!fill(record_length + 2 * sizeof(size_type))){ return; }
+	m_is_valid = true;
+}
+
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef M3BP_TASKS_SHUFFLE_SPILLED_RUN_HPP
+#define M3BP_TASKS_SHUFFLE_SPILLED_RUN_HPP
+
+#include <vector>
+#include <cstdint>
+#include "m3bp/types.hpp"
+
+namespace m3bp {
+
+class ScratchFile;
+
+/**
+ *  A sorted sequence of shuffle records written to a scratch file.
+ *
+ *  Records are stored in the same format as record chunks of shuffle
+ *  tasks.
+ */
+struct SpilledRun {
+	size_type offset;
+	size_type length;
+	size_type record_count;
+};
+
+/**
+ *  Sequential reader of a spilled run.
+ *
+ *  The current record is kept contiguous in an internal buffer and the
+ *  pointer returned by current() is invalidated by advance().
+ */
+class SpilledRunReader {
+
+private:
+	static const size_type DEFAULT_BUFFER_SIZE = (64 << 10);
+
+	const ScratchFile *m_file;
+	size_type m_next_offset;
+	size_type m_end_offset;
+	std::vector<uint8_t> m_buffer;
+	size_type m_head;
+	size_type m_tail;
+	bool m_is_valid;
+
+	bool fill(size_type length);
+	void load();
+
+public:
+	SpilledRunReader(const ScratchFile &file, const SpilledRun &run);
+
+	const uint8_t *current() const noexcept {
+		return m_is_valid ? m_buffer.data() + m_head : nullptr;
+	}
+
+	void advance();
+
+};
+
+}
+
+#endif
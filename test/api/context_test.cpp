@@ -71,3 +71,41 @@ TEST(Context, NormalFlow){
 	workload.verify(*output);
 }
 
+
+TEST(Context, MemoryLimitedFlow){
+	using Workload =
+		util::workloads::HashJoinWorkload<int, int, int>;
+	using Input0Type = std::pair<int, int>;
+	using Input1Type = std::pair<int, int>;
+	using ResultType = std::pair<int, std::pair<int, int>>;
+	const auto config = m3bp::Configuration()
+		.max_concurrency(4)
+		.default_output_buffer_size(64 << 10)
+		.default_records_per_buffer(4 << 10)
+		.memory_limit(1 << 20);
+	Workload workload(1000, 40, 100);
+	const auto input0 = workload.input0();
+	const auto input1 = workload.input1();
+
+	m3bp::FlowGraph fgraph;
+	auto output = std::make_shared<std::vector<ResultType>>();
+	auto input0_vertex = fgraph.add_vertex(
+		"input0", util::processors::TestInputGenerator<Input0Type>(input0));
+	auto input1_vertex = fgraph.add_vertex(
+		"input1", util::processors::TestInputGenerator<Input1Type>(input1));
+	auto join_vertex = fgraph.add_vertex(
+		"join", util::processors::TestHashJoinProcessor<int, int, int>());
+	auto output_vertex = fgraph.add_vertex(
+		"output", util::processors::TestOutputReceiver<ResultType>(output));
+	fgraph
+		.add_edge(input0_vertex.output_port(0), join_vertex.input_port(0))
+		.add_edge(input1_vertex.output_port(0), join_vertex.input_port(1))
+		.add_edge(join_vertex.output_port(0), output_vertex.input_port(0));
+
+	m3bp::Context ctx;
+	ctx.set_configuration(config);
+	ctx.set_flow_graph(fgraph);
+	ctx.execute();
+	ctx.wait();
+	workload.verify(*output);
+}
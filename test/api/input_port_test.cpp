@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include <gtest/gtest.h>
+#include <cstring>
 #include "m3bp/input_port.hpp"
 
 TEST(InputPort, Parameters){
@@ -31,5 +32,30 @@ TEST(InputPort, Parameters){
 	EXPECT_EQ(&iport, &iport.value_comparator(f));
 	iport.value_comparator()(nullptr, nullptr);
 	EXPECT_EQ(100, value);
+	EXPECT_EQ(m3bp::Partitioning::HASH, iport.partitioning());
+	EXPECT_EQ(&iport, &iport.partitioning(m3bp::Partitioning::RANGE));
+	EXPECT_EQ(m3bp::Partitioning::RANGE, iport.partitioning());
+	EXPECT_EQ(m3bp::Grouping::SORT, iport.grouping());
+	EXPECT_EQ(&iport, &iport.grouping(m3bp::Grouping::HASH));
+	EXPECT_EQ(m3bp::Grouping::HASH, iport.grouping());
 }
 
+
+TEST(InputPort, ValueCombiner){
+	m3bp::InputPort iport("name");
+	EXPECT_FALSE(iport.value_combiner());
+	auto f = [](
+		void *dst,
+		const void *lhs, m3bp::size_type lhs_size,
+		const void *rhs, m3bp::size_type rhs_size) -> m3bp::size_type
+	{
+		memcpy(dst, lhs, lhs_size);
+		memcpy(static_cast<uint8_t *>(dst) + lhs_size, rhs, rhs_size);
+		return lhs_size + rhs_size;
+	};
+	EXPECT_EQ(&iport, &iport.value_combiner(f));
+	const char lhs[] = "abc", rhs[] = "de";
+	char dst[8] = { 0 };
+	EXPECT_EQ(6u, iport.value_combiner()(dst, lhs, 3, rhs, 3));
+	EXPECT_STREQ("abcde", dst);
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdio>
+#include "m3bp/context.hpp"
+#include "m3bp/configuration.hpp"
+#include "m3bp/flow_graph.hpp"
+#include "m3bp/task.hpp"
+#include "m3bp/mapped_file_input_processor.hpp"
+
+namespace {
+
+class TestStringReceiver : public m3bp::ProcessorBase {
+
+private:
+	std::shared_ptr<std::vector<std::string>> m_received;
+
+public:
+	explicit TestStringReceiver(
+		std::shared_ptr<std::vector<std::string>> destination)
+		: m3bp::ProcessorBase(
+			{
+				m3bp::InputPort("input0")
+					.movement(m3bp::Movement::ONE_TO_ONE)
+			},
+			{ })
+		, m_received(std::move(destination))
+	{
+		max_concurrency(1);
+	}
+
+	virtual void run(m3bp::Task &task) override {
+		const auto buffer = task.input(0).raw_buffer();
+		const auto data = static_cast<const char *>(buffer.key_buffer());
+		const auto offsets = buffer.key_offset_table();
+		for(m3bp::size_type i = 0; i < buffer.record_count(); ++i){
+			m_received->emplace_back(
+				data + offsets[i], data + offsets[i + 1]);
+		}
+	}
+
+};
+
+std::vector<std::string> read_file(
+	const std::string &path,
+	m3bp::size_type record_size,
+	m3bp::size_type split_size,
+	m3bp::size_type records_per_buffer = 0)
+{
+	m3bp::FlowGraph fgraph;
+	auto output = std::make_shared<std::vector<std::string>>();
+	auto input_vertex = fgraph.add_vertex(
+		"input",
+		m3bp::MappedFileInputProcessor(path, record_size, split_size));
+	auto output_vertex = fgraph.add_vertex(
+		"output", TestStringReceiver(output));
+	fgraph.add_edge(
+		input_vertex.output_port(0), output_vertex.input_port(0));
+
+	m3bp::Configuration config;
+	config.max_concurrency(4);
+	if(records_per_buffer > 0){
+		config.default_records_per_buffer(records_per_buffer);
+	}
+	m3bp::Context ctx;
+	ctx.set_configuration(config);
+	ctx.set_flow_graph(fgraph);
+	ctx.execute();
+	ctx.wait();
+	std::sort(output->begin(), output->end());
+	return *output;
+}
+
+}
+
+TEST(MappedFileInputProcessor, Lines){
+	const std::string path = "/tmp/m3bp-mapped-file-input-test";
+	std::vector<std::string> expected;
+	{
+		std::ofstream ofs(path);
+		for(int i = 0; i < 1000; ++i){
+			std::string line(i % 37, static_cast<char>('a' + i % 26));
+			line += std::to_string(i) + "\n";
+			ofs << line;
+			expected.push_back(line);
+		}
+		// The last line does not have a newline
+		ofs << "last";
+		expected.push_back("last");
+	}
+	std::sort(expected.begin(), expected.end());
+	EXPECT_EQ(expected, read_file(path, 0, 100));
+	EXPECT_EQ(expected, read_file(path, 0, 1 << 20));
+	// Each region is split into many buffers
+	EXPECT_EQ(expected, read_file(path, 0, 4096, 7));
+	EXPECT_EQ(expected, read_file(path, 0, 1 << 20, 3));
+	std::remove(path.c_str());
+}
+
+TEST(MappedFileInputProcessor, FixedSizeRecords){
+	const std::string path = "/tmp/m3bp-mapped-file-input-test";
+	std::vector<std::string> expected;
+	{
+		std::ofstream ofs(path);
+		for(int i = 0; i < 1000; ++i){
+			char record[8];
+			snprintf(record, sizeof(record), "%07d", i);
+			ofs.write(record, 7);
+			expected.emplace_back(record, record + 7);
+		}
+		ofs << "xyz";
+		expected.push_back("xyz");
+	}
+	std::sort(expected.begin(), expected.end());
+	EXPECT_EQ(expected, read_file(path, 7, 100));
+	std::remove(path.c_str());
+}
@@ -34,9 +34,44 @@ public:
 	virtual void run(m3bp::Task &) override { }
 };
 
+class TestHashGroupedJoinProcessor : public m3bp::ProcessorBase {
+public:
+	TestHashGroupedJoinProcessor()
+		: m3bp::ProcessorBase(
+			{
+				m3bp::InputPort("input0")
+					.movement(m3bp::Movement::SCATTER_GATHER),
+				m3bp::InputPort("input1")
+					.movement(m3bp::Movement::SCATTER_GATHER)
+					.grouping(m3bp::Grouping::HASH),
+			},
+			{ })
+	{ }
+	virtual void run(m3bp::Task &) override { }
+};
+
+class TestRangeJoinProcessor : public m3bp::ProcessorBase {
+public:
+	TestRangeJoinProcessor()
+		: m3bp::ProcessorBase(
+			{
+				m3bp::InputPort("input0")
+					.movement(m3bp::Movement::SCATTER_GATHER)
+					.partitioning(m3bp::Partitioning::RANGE),
+				m3bp::InputPort("input1")
+					.movement(m3bp::Movement::SCATTER_GATHER),
+			},
+			{ })
+	{ }
+	virtual void run(m3bp::Task &) override { }
+};
+
 }
 
 TEST(ProcessorBase, InvalidProcessor){
 	EXPECT_THROW(TestMixedProcessor(), m3bp::ProcessorDefinitionError);
+	EXPECT_THROW(TestRangeJoinProcessor(), m3bp::ProcessorDefinitionError);
+	EXPECT_THROW(
+		TestHashGroupedJoinProcessor(), m3bp::ProcessorDefinitionError);
 }
 
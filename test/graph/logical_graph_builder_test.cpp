@@ -233,3 +233,74 @@ TEST(LogicalGraphBuilder, SortJoin){
 	workload.verify(*output);
 }
 
+
+TEST(LogicalGraphBuilder, CombinedReduceByKey){
+	using Workload = util::workloads::ReduceByKeyWorkload<std::string, int>;
+	using PairType = std::pair<std::string, int>;
+	const auto config = m3bp::Configuration()
+		.max_concurrency(4);
+	Workload workload(200, 100, 100);
+	const auto input = workload.input();
+
+	m3bp::FlowGraph fgraph;
+	auto output0 = std::make_shared<std::vector<PairType>>();
+	auto output1 = std::make_shared<std::vector<PairType>>();
+	auto input_vertex = fgraph.add_vertex(
+		"input", util::processors::TestInputGenerator<PairType>(input));
+	auto reduce0_vertex = fgraph.add_vertex(
+		"reduce0",
+		util::processors::TestReduceByKeyProcessor<std::string, int>(true));
+	auto reduce1_vertex = fgraph.add_vertex(
+		"reduce1",
+		util::processors::TestReduceByKeyProcessor<std::string, int>());
+	auto output0_vertex = fgraph.add_vertex(
+		"output0", util::processors::TestOutputReceiver<PairType>(output0));
+	auto output1_vertex = fgraph.add_vertex(
+		"output1", util::processors::TestOutputReceiver<PairType>(output1));
+	fgraph
+		.add_edge(input_vertex.output_port(0), reduce0_vertex.input_port(0))
+		.add_edge(input_vertex.output_port(0), reduce1_vertex.input_port(0))
+		.add_edge(reduce0_vertex.output_port(0), output0_vertex.input_port(0))
+		.add_edge(reduce1_vertex.output_port(0), output1_vertex.input_port(0));
+
+	auto lgraph = m3bp::build_logical_graph(fgraph, config);
+	util::execute_logical_graph(lgraph, config.max_concurrency());
+	workload.verify(*output0);
+	workload.verify(*output1);
+}
+
+TEST(LogicalGraphBuilder, HashGroupedReduceByKey){
+	using Workload = util::workloads::ReduceByKeyWorkload<std::string, int>;
+	using PairType = std::pair<std::string, int>;
+	const auto config = m3bp::Configuration()
+		.max_concurrency(4);
+	Workload workload(200, 100, 100);
+	const auto input = workload.input();
+
+	m3bp::FlowGraph fgraph;
+	auto output0 = std::make_shared<std::vector<PairType>>();
+	auto output1 = std::make_shared<std::vector<PairType>>();
+	auto input_vertex = fgraph.add_vertex(
+		"input", util::processors::TestInputGenerator<PairType>(input));
+	auto reduce0_vertex = fgraph.add_vertex(
+		"reduce0",
+		util::processors::TestReduceByKeyProcessor<std::string, int>(
+			false, m3bp::Grouping::HASH));
+	auto reduce1_vertex = fgraph.add_vertex(
+		"reduce1",
+		util::processors::TestReduceByKeyProcessor<std::string, int>());
+	auto output0_vertex = fgraph.add_vertex(
+		"output0", util::processors::TestOutputReceiver<PairType>(output0));
+	auto output1_vertex = fgraph.add_vertex(
+		"output1", util::processors::TestOutputReceiver<PairType>(output1));
+	fgraph
+		.add_edge(input_vertex.output_port(0), reduce0_vertex.input_port(0))
+		.add_edge(input_vertex.output_port(0), reduce1_vertex.input_port(0))
+		.add_edge(reduce0_vertex.output_port(0), output0_vertex.input_port(0))
+		.add_edge(reduce1_vertex.output_port(0), output1_vertex.input_port(0));
+
+	auto lgraph = m3bp::build_logical_graph(fgraph, config);
+	util::execute_logical_graph(lgraph, config.max_concurrency());
+	workload.verify(*output0);
+	workload.verify(*output1);
+}
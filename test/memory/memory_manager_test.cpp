@@ -14,8 +14,14 @@
  * limitations under the License.
  */
 #include <gtest/gtest.h>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <set>
 #include "memory/memory_manager.hpp"
 #include "memory/memory_reference.hpp"
+#include "memory/memory_pool.hpp"
+#include "system/topology.hpp"
 
 namespace {
 
@@ -45,3 +51,153 @@ TEST(MemoryManager, SimpleAllocation){
 	EXPECT_EQ(0u, mm->total_memory_usage());
 }
 
+
+TEST(MemoryManager, WaitForMemory){
+	const size_t size = 1 << 20;
+	auto mm = std::make_shared<m3bp::MemoryManager>();
+	mm->memory_limit(2 * size);
+	auto mr0 = mm->allocate(size);
+	auto mr1 = mm->allocate(size);
+	EXPECT_TRUE(mm->is_memory_pressured());
+	std::thread releaser([&](){
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		mr0 = m3bp::MemoryReference();
+	});
+	mm->wait_for_memory(size);
+	EXPECT_EQ(size, mm->total_memory_usage());
+	releaser.join();
+	// Returns without releasing when no memory objects are released
+	mm->wait_for_memory(2 * size);
+	EXPECT_EQ(size, mm->total_memory_usage());
+	// Does not wait again until any memory object is released
+	const auto begin = std::chrono::steady_clock::now();
+	for(int i = 0; i < 10; ++i){ mm->wait_for_memory(2 * size); }
+	const auto elapsed = std::chrono::steady_clock::now() - begin;
+	EXPECT_GT(std::chrono::milliseconds(100), elapsed);
+}
+
+
+TEST(MemoryManager, SpillMemoryObjects){
+	const size_t size = 1 << 20;
+	auto mm = std::make_shared<m3bp::MemoryManager>();
+	mm->memory_limit(5 * size / 2);
+	mm->spill_memory_objects("/tmp");
+	auto mr0 = mm->allocate(size);
+	{
+		auto locked_mr0 = mr0.lock();
+		auto ptr = reinterpret_cast<uint32_t *>(locked_mr0.pointer());
+		for(size_t i = 0; i < size / sizeof(uint32_t); ++i){ ptr[i] = i; }
+	}
+	auto mr1 = mm->allocate(size);
+	auto locked_mr1 = mr1.lock();
+	// Exceeds the limit and spills mr0; mr1 is locked and stays in memory
+	auto mr2 = mm->allocate(size);
+	EXPECT_EQ(2 * size, mm->total_memory_usage());
+	{
+		auto locked_mr0 = mr0.lock();
+		EXPECT_EQ(3 * size, mm->total_memory_usage());
+		auto ptr = reinterpret_cast<const uint32_t *>(locked_mr0.pointer());
+		for(size_t i = 0; i < size / sizeof(uint32_t); ++i){
+			ASSERT_EQ(i, ptr[i]);
+		}
+	}
+	mr0 = m3bp::MemoryReference();
+	EXPECT_EQ(2 * size, mm->total_memory_usage());
+}
+
+
+TEST(MemoryManager, SpillScanInterval){
+	const size_t size = 1 << 20;
+	m3bp::MemoryPool::instance().trim();
+	auto mm = std::make_shared<m3bp::MemoryManager>();
+	mm->memory_limit(4 * size);
+	mm->spill_memory_objects("/tmp");
+	std::vector<m3bp::MemoryReference> refs;
+	std::vector<m3bp::LockedMemoryReference> locked_refs;
+	for(int i = 0; i < 4; ++i){
+		refs.emplace_back(mm->allocate(size));
+		locked_refs.emplace_back(refs.back().lock());
+	}
+	// Exceeds the limit but no objects can be spilled
+	auto mr4 = mm->allocate(1024);
+	EXPECT_EQ(4 * size + 1024, mm->total_memory_usage());
+	// Does not scan again right after the fruitless scan
+	locked_refs[0] = m3bp::LockedMemoryReference();
+	auto mr5 = mm->allocate(1024);
+	EXPECT_EQ(4 * size + 2048, mm->total_memory_usage());
+	// Spills the oldest idle object after enough allocations
+	auto mr6 = mm->allocate(size / 4);
+	EXPECT_EQ(3 * size + size / 4 + 2048, mm->total_memory_usage());
+}
+
+
+TEST(MemoryManager, PooledMemory){
+	const size_t size = 1 << 20;
+	auto &pool = m3bp::MemoryPool::instance();
+	pool.trim();
+	auto mm = std::make_shared<m3bp::MemoryManager>();
+	mm->memory_limit(2 * size);
+	auto mr0 = mm->allocate(size);
+	auto mr1 = mm->allocate(size);
+	mr0 = m3bp::MemoryReference();
+	mr1 = m3bp::MemoryReference();
+	// Released blocks are kept by the pool and still count as used
+	EXPECT_EQ(0u, mm->total_memory_usage());
+	EXPECT_EQ(2 * size, pool.pooled_bytes());
+	EXPECT_TRUE(mm->is_memory_pressured());
+	// Exceeds the limit and releases the blocks kept by the pool
+	auto mr2 = mm->allocate(3 * size / 2);
+	EXPECT_EQ(0u, pool.pooled_bytes());
+	EXPECT_FALSE(mm->is_memory_pressured());
+}
+
+
+TEST(MemoryManager, ConcurrentAllocation){
+	const int num_threads = 8, num_objects = 1000;
+	auto mm = std::make_shared<m3bp::MemoryManager>();
+	std::vector<std::vector<m3bp::MemoryReference>> refs(num_threads);
+	std::vector<std::thread> threads;
+	for(int i = 0; i < num_threads; ++i){
+		threads.emplace_back([&, i](){
+			for(int j = 0; j < num_objects; ++j){
+				refs[i].emplace_back(mm->allocate(16));
+			}
+		});
+	}
+	for(auto &t : threads){ t.join(); }
+	EXPECT_EQ(16u * num_threads * num_objects, mm->total_memory_usage());
+	std::set<m3bp::identifier_type> identifiers;
+	for(const auto &v : refs){
+		for(const auto &mr : v){ identifiers.insert(mr.identifier()); }
+	}
+	EXPECT_EQ(
+		static_cast<size_t>(num_threads * num_objects), identifiers.size());
+	refs.clear();
+	EXPECT_EQ(0u, mm->total_memory_usage());
+}
+
+
+TEST(MemoryManager, MigrateMemoryObject){
+	const size_t size = 1 << 20;
+	auto mm = std::make_shared<m3bp::MemoryManager>();
+	auto mr0 = mm->allocate(size, 0);
+	auto locked_mr0 = mr0.lock();
+	auto ptr = reinterpret_cast<uint32_t *>(locked_mr0.pointer());
+	for(size_t i = 0; i < size / sizeof(uint32_t); ++i){ ptr[i] = i; }
+	// Never moves objects to the node where they are
+	EXPECT_EQ(0u, locked_mr0.migrate(locked_mr0.numa_node()));
+	{
+		// Other holders may use the current buffer
+		auto locked_again = mr0.lock();
+		EXPECT_EQ(0u, locked_mr0.migrate(locked_mr0.numa_node() + 1));
+	}
+	if(m3bp::Topology::instance().numa_node_count() < 2){ return; }
+	const m3bp::identifier_type dst_node = (locked_mr0.numa_node() + 1) % 2;
+	EXPECT_EQ(size, locked_mr0.migrate(dst_node));
+	EXPECT_EQ(dst_node, locked_mr0.numa_node());
+	EXPECT_EQ(size, mm->total_memory_usage());
+	auto migrated = reinterpret_cast<const uint32_t *>(locked_mr0.pointer());
+	for(size_t i = 0; i < size / sizeof(uint32_t); ++i){
+		ASSERT_EQ(i, migrated[i]);
+	}
+}
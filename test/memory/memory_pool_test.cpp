@@ -0,0 +1,91 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstring>
+#include "memory/memory_pool.hpp"
+
+TEST(MemoryPool, SizeClass){
+	using m3bp::MemoryPool;
+	m3bp::size_type last_class = 0, last_rounded = 0;
+	for(m3bp::size_type size = MemoryPool::MIN_POOLED_SIZE;
+	    size <= MemoryPool::MAX_POOLED_SIZE;
+	    size += size / 7 + 1)
+	{
+		m3bp::size_type rounded = 0;
+		const auto sc = MemoryPool::size_class(size, rounded);
+		EXPECT_LE(size, rounded);
+		EXPECT_LE(rounded, size + size / 4);
+		EXPECT_LE(last_class, sc);
+		EXPECT_LE(last_rounded, rounded);
+		last_class = sc;
+		last_rounded = rounded;
+	}
+	m3bp::size_type rounded = 0;
+	MemoryPool::size_class(4 << 20, rounded);
+	EXPECT_EQ(4u << 20, rounded);
+}
+
+TEST(MemoryPool, Recycle){
+	auto &pool = m3bp::MemoryPool::instance();
+	const m3bp::size_type size = (4 << 20) - 100;
+	void *p0 = pool.allocate(size, 0);
+	memset(p0, 0xcd, size);
+	pool.release(p0, size, 0);
+	const auto hit_count = pool.hit_count();
+	void *p1 = pool.allocate(size - 1000, 0);
+	EXPECT_EQ(p0, p1);
+	EXPECT_EQ(hit_count + 1, pool.hit_count());
+	pool.release(p1, size - 1000, 0);
+}
+
+TEST(MemoryPool, BoundedCapacity){
+	auto &pool = m3bp::MemoryPool::instance();
+	const auto old_capacity = pool.capacity();
+	const m3bp::size_type size = (1 << 20);
+	std::vector<void *> blocks;
+	for(int i = 0; i < 64; ++i){ blocks.push_back(pool.allocate(size, 0)); }
+	pool.capacity(16 * size);
+	for(auto p : blocks){ pool.release(p, size, 0); }
+	EXPECT_LE(pool.retained_bytes(), 16 * size);
+	pool.capacity(0);
+	EXPECT_EQ(0u, pool.retained_bytes());
+	pool.capacity(old_capacity);
+}
+
+TEST(MemoryPool, SmallBlocks){
+	auto &pool = m3bp::MemoryPool::instance();
+	const auto hit_count = pool.hit_count();
+	const auto miss_count = pool.miss_count();
+	void *p = pool.allocate(100, 0);
+	EXPECT_NE(nullptr, p);
+	pool.release(p, 100, 0);
+	EXPECT_EQ(hit_count, pool.hit_count());
+	EXPECT_EQ(miss_count, pool.miss_count());
+}
+
+TEST(MemoryPool, Trim){
+	auto &pool = m3bp::MemoryPool::instance();
+	const m3bp::size_type size = (1 << 20);
+	pool.trim();
+	void *p = pool.allocate(size, 0);
+	const auto pooled_bytes = pool.pooled_bytes();
+	pool.release(p, size, 0);
+	EXPECT_EQ(pooled_bytes + size, pool.pooled_bytes());
+	pool.trim();
+	EXPECT_EQ(0u, pool.pooled_bytes());
+	EXPECT_EQ(0u, pool.retained_bytes());
+}
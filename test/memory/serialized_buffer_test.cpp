@@ -200,3 +200,37 @@ TEST(SerializedBuffer, AllocateGrouped){
 	EXPECT_EQ(0u, mm.total_memory_usage());
 }
 
+
+TEST(SerializedBuffer, ShrinkToFit){
+	auto memory_manager = std::make_shared<m3bp::MemoryManager>();
+	auto &mm = *memory_manager;
+	const m3bp::size_type maximum_record_count = 1000;
+	const m3bp::size_type total_record_size = 100000;
+	const m3bp::size_type record_count = 10;
+	{
+		auto sb = m3bp::SerializedBuffer::allocate_key_value_buffer(
+			mm, maximum_record_count, total_record_size);
+		auto data = reinterpret_cast<uint8_t *>(sb.values_data());
+		auto offsets = sb.values_offsets();
+		auto key_lengths = sb.key_lengths();
+		offsets[0] = 0;
+		for(m3bp::size_type i = 0; i < record_count; ++i){
+			offsets[i + 1] = offsets[i] + i + 1;
+			key_lengths[i] = i / 2;
+			for(m3bp::size_type j = offsets[i]; j < offsets[i + 1]; ++j){
+				data[j] = static_cast<uint8_t>(i);
+			}
+		}
+		sb.record_count(record_count);
+
+		auto shrunk = sb.shrink_to_fit(mm);
+		EXPECT_EQ(shrunk.allocated_size(), sb.used_size());
+		EXPECT_LT(shrunk.allocated_size(), sb.allocated_size());
+		EXPECT_EQ(record_count, shrunk.record_count());
+		EXPECT_EQ(sb.compute_hash(), shrunk.compute_hash());
+		for(m3bp::size_type i = 0; i < record_count; ++i){
+			EXPECT_EQ(sb.key_lengths()[i], shrunk.key_lengths()[i]);
+		}
+	}
+	EXPECT_EQ(0u, mm.total_memory_usage());
+}
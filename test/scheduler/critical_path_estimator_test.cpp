@@ -0,0 +1,42 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include "scheduler/critical_path_estimator.hpp"
+
+TEST(CriticalPathEstimator, Depth){
+	// 0 -> 1 -> 2 -> 3
+	// 4 -> 3
+	m3bp::CriticalPathEstimator estimator({ { 1 }, { 2 }, { 3 }, { }, { 3 } });
+	EXPECT_EQ(4u, estimator.rank(0));
+	EXPECT_EQ(3u, estimator.rank(1));
+	EXPECT_EQ(2u, estimator.rank(2));
+	EXPECT_EQ(1u, estimator.rank(3));
+	EXPECT_EQ(2u, estimator.rank(4));
+	EXPECT_EQ(0u, estimator.rank(5));
+}
+
+TEST(CriticalPathEstimator, ObservedTimes){
+	// 0 -> 2, 1 -> 2
+	m3bp::CriticalPathEstimator estimator({ { 2 }, { 2 }, { } });
+	EXPECT_EQ(estimator.rank(0), estimator.rank(1));
+	estimator.record(0, 100);
+	estimator.record(1, 1000);
+	estimator.record(1, 3000);
+	estimator.record(2, 10);
+	EXPECT_EQ(110u, estimator.rank(0));
+	EXPECT_EQ(2010u, estimator.rank(1));
+	EXPECT_EQ(10u, estimator.rank(2));
+}
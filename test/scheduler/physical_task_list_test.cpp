@@ -91,3 +91,27 @@ TEST(PhysicalTaskList, Synchronization){
 	sub_thread.join();
 }
 
+
+TEST(PhysicalTaskList, Priority){
+	std::vector<std::shared_ptr<m3bp::PhysicalTask>> tasks = {
+		std::make_shared<m3bp::PhysicalTask>(),
+		std::make_shared<m3bp::PhysicalTask>(),
+		std::make_shared<m3bp::PhysicalTask>(),
+		std::make_shared<m3bp::PhysicalTask>()
+	};
+	m3bp::PhysicalTaskList tlist;
+	tlist.push_back(tasks[0], 1);           // { 1: [ 0 ] }
+	tlist.push_back(tasks[1], 3);           // { 3: [ 1 ], 1: [ 0 ] }
+	tlist.push_back(tasks[2], 1);           // { 3: [ 1 ], 1: [ 0, 2 ] }
+	tlist.push_front(tasks[3], 3);          // { 3: [ 3, 1 ], 1: [ 0, 2 ] }
+	EXPECT_EQ(3u, tlist.highest_priority());
+	EXPECT_EQ(tasks[1], tlist.pop_back());  // { 3: [ 3 ], 1: [ 0, 2 ] }
+	EXPECT_EQ(tasks[3], tlist.pop_front()); // { 1: [ 0, 2 ] }
+	EXPECT_EQ(1u, tlist.highest_priority());
+	EXPECT_EQ(tasks[0], tlist.pop_front()); // { 1: [ 2 ] }
+	EXPECT_FALSE(tlist.empty());
+	EXPECT_EQ(tasks[2], tlist.pop_back());  // { }
+	EXPECT_TRUE(tlist.empty());
+	EXPECT_EQ(0u, tlist.highest_priority());
+	EXPECT_EQ(nullptr, tlist.pop_front().get());
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <thread>
+#include <chrono>
+#include <gtest/gtest.h>
+#include "scheduler/scheduler_synchronizer.hpp"
+
+TEST(SchedulerSynchronizer, NotifyRunning){
+	m3bp::SchedulerSynchronizer sync;
+	EXPECT_FALSE(sync.notify());
+	sync.set_is_sleeping();
+	sync.reset_is_sleeping();
+	EXPECT_FALSE(sync.notify());
+}
+
+TEST(SchedulerSynchronizer, NotifyBeforeWait){
+	m3bp::SchedulerSynchronizer sync;
+	sync.set_is_sleeping();
+	EXPECT_TRUE(sync.notify(false));
+	EXPECT_FALSE(sync.notify());
+	// Returns immediately without blocking
+	EXPECT_FALSE(sync.wait(0, 0));
+	sync.reset_is_sleeping();
+}
+
+TEST(SchedulerSynchronizer, WakeUpParkedThread){
+	m3bp::SchedulerSynchronizer sync;
+	sync.set_is_sleeping();
+	bool parked = false;
+	std::thread waiter([&](){ parked = sync.wait(16, 1); });
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	// Parked threads are skipped unless requested
+	EXPECT_FALSE(sync.notify(false));
+	EXPECT_TRUE(sync.notify());
+	waiter.join();
+	EXPECT_TRUE(parked);
+	EXPECT_LE(sync.notify_time(), m3bp::SchedulerSynchronizer::current_time());
+	sync.reset_is_sleeping();
+}
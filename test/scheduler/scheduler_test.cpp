@@ -14,8 +14,10 @@
  * limitations under the License.
  */
 #include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 #include "context/execution_context.hpp"
+#include "memory/memory_reference.hpp"
 #include "scheduler/locality.hpp"
 #include "scheduler/locality_option.hpp"
 #include "tasks/physical_task.hpp"
@@ -40,6 +42,19 @@ public:
 	}
 };
 
+class MemoryDeltaCommand : public TestCommand {
+private:
+	int64_t m_delta;
+public:
+	MemoryDeltaCommand(int *destination, int value, int64_t delta)
+		: TestCommand(destination, value)
+		, m_delta(delta)
+	{ }
+	virtual int64_t estimated_memory_delta() const override {
+		return m_delta;
+	}
+};
+
 struct EntryTerminalPair {
 	m3bp::PhysicalTaskIdentifier entry_id;
 	m3bp::PhysicalTaskIdentifier terminal_id;
@@ -250,3 +265,146 @@ TEST(Scheduler, IsFinished){
 	auto taken2 = scheduler.take_runnable_task(locality);
 	EXPECT_EQ(nullptr, taken2.get());
 }
+
+TEST(Scheduler, HoldBackProducers){
+	m3bp::ExecutionContext context(
+		m3bp::Configuration().max_concurrency(1).memory_limit(1 << 20));
+	auto &scheduler = context.scheduler();
+	const m3bp::LogicalTaskIdentifier lid(1);
+	const m3bp::Locality locality(0, 0);
+	auto mobj = context.memory_manager().allocate(1 << 20);
+	EXPECT_TRUE(context.memory_manager().is_memory_pressured());
+
+	int result = 0;
+	auto t0 = scheduler.create_physical_task(
+		lid, std::unique_ptr<TestCommand>(new TestCommand(&result, 10)),
+		m3bp::LocalityOption().memory_producer(true));
+	auto t1 = scheduler.create_physical_task(
+		lid, std::unique_ptr<TestCommand>(new TestCommand(&result, 20)),
+		m3bp::LocalityOption());
+	scheduler.commit_task(t0);
+	scheduler.commit_task(t1);
+
+	// The consumer is taken first while the memory usage is near the limit
+	auto taken0 = scheduler.take_runnable_task(locality);
+	EXPECT_EQ(t1, taken0->physical_task_id());
+	scheduler.notify_task_completion(taken0->physical_task_id());
+	// The producer is taken when there are no other tasks
+	auto taken1 = scheduler.take_runnable_task(locality);
+	EXPECT_EQ(t0, taken1->physical_task_id());
+	scheduler.notify_task_completion(taken1->physical_task_id());
+	EXPECT_TRUE(scheduler.is_finished());
+}
+
+TEST(Scheduler, PreferReleasingTasks){
+	m3bp::ExecutionContext context(
+		m3bp::Configuration().max_concurrency(1).memory_limit(1 << 20));
+	auto &scheduler = context.scheduler();
+	const m3bp::LogicalTaskIdentifier lid(1);
+	const m3bp::Locality locality(0, 0);
+	auto mobj = context.memory_manager().allocate(1 << 20);
+	EXPECT_TRUE(context.memory_manager().is_memory_pressured());
+
+	int result = 0;
+	auto t0 = scheduler.create_physical_task(
+		lid, std::unique_ptr<TestCommand>(
+			new MemoryDeltaCommand(&result, 10, 100)),
+		m3bp::LocalityOption().memory_producer(true));
+	auto t1 = scheduler.create_physical_task(
+		lid, std::unique_ptr<TestCommand>(
+			new MemoryDeltaCommand(&result, 20, -100)),
+		m3bp::LocalityOption().memory_producer(true));
+	auto t2 = scheduler.create_physical_task(
+		lid, std::unique_ptr<TestCommand>(new TestCommand(&result, 30)),
+		m3bp::LocalityOption());
+	auto t3 = scheduler.create_physical_task(
+		lid, std::unique_ptr<TestCommand>(
+			new MemoryDeltaCommand(&result, 40, -100)),
+		m3bp::LocalityOption());
+	auto t4 = scheduler.create_physical_task(
+		lid, std::unique_ptr<TestCommand>(
+			new MemoryDeltaCommand(&result, 50, -200)),
+		m3bp::LocalityOption());
+	for(const auto t : { t0, t1, t2, t3, t4 }){ scheduler.commit_task(t); }
+
+	// Tasks releasing more memory are taken first, then the others, and
+	// producers allocating less memory are preferred at last
+	for(const auto t : { t4, t3, t2, t1, t0 }){
+		auto taken = scheduler.take_runnable_task(locality);
+		ASSERT_NE(nullptr, taken.get());
+		EXPECT_EQ(t, taken->physical_task_id());
+		scheduler.notify_task_completion(taken->physical_task_id());
+	}
+	EXPECT_TRUE(scheduler.is_finished());
+}
+
+TEST(Scheduler, DependencyOnCompletedTask){
+	m3bp::ExecutionContext context(
+		m3bp::Configuration().max_concurrency(1));
+	auto &scheduler = context.scheduler();
+	const m3bp::LogicalTaskIdentifier lid(1);
+	const m3bp::Locality locality(0, 0);
+
+	int result = 0;
+	auto t0 = scheduler.create_physical_task(
+		lid, std::unique_ptr<TestCommand>(new TestCommand(&result, 10)),
+		m3bp::LocalityOption());
+	scheduler.commit_task(t0);
+	auto taken0 = scheduler.take_runnable_task(locality);
+	taken0->run(context, locality);
+	scheduler.notify_task_completion(taken0->physical_task_id());
+
+	// A dependency on a completed task is satisfied immediately
+	auto t1 = scheduler.create_physical_task(
+		lid, std::unique_ptr<TestCommand>(new TestCommand(&result, 20)),
+		m3bp::LocalityOption());
+	scheduler.add_dependency(t0, t1);
+	scheduler.commit_task(t1);
+	auto taken1 = scheduler.take_runnable_task(locality);
+	ASSERT_NE(nullptr, taken1.get());
+	EXPECT_EQ(t1, taken1->physical_task_id());
+	taken1->run(context, locality);
+	EXPECT_EQ(20, result);
+	scheduler.notify_task_completion(taken1->physical_task_id());
+	EXPECT_TRUE(scheduler.is_finished());
+}
+
+TEST(Scheduler, DependencyOnReleasedVertices){
+	m3bp::ExecutionContext context(
+		m3bp::Configuration().max_concurrency(1));
+	auto &scheduler = context.scheduler();
+	const m3bp::LogicalTaskIdentifier lid(1);
+	const m3bp::Locality locality(0, 0);
+
+	// Complete enough tasks to release whole segments of vertices
+	const int num_tasks = 10000;
+	int result = 0;
+	std::vector<m3bp::PhysicalTaskIdentifier> tasks;
+	for(int i = 0; i < num_tasks; ++i){
+		tasks.push_back(scheduler.create_physical_task(
+			lid, std::unique_ptr<TestCommand>(new TestCommand(&result, i)),
+			m3bp::LocalityOption()));
+	}
+	for(const auto t : tasks){ scheduler.commit_task(t); }
+	for(int i = 0; i < num_tasks; ++i){
+		auto taken = scheduler.take_runnable_task(locality);
+		ASSERT_NE(nullptr, taken.get());
+		taken->run(context, locality);
+		scheduler.notify_task_completion(taken->physical_task_id());
+	}
+	EXPECT_TRUE(scheduler.is_finished());
+
+	auto last = scheduler.create_physical_task(
+		lid, std::unique_ptr<TestCommand>(new TestCommand(&result, -1)),
+		m3bp::LocalityOption());
+	scheduler.add_dependency(tasks.front(), last);
+	scheduler.add_dependency(tasks.back(), last);
+	scheduler.commit_task(last);
+	auto taken = scheduler.take_runnable_task(locality);
+	ASSERT_NE(nullptr, taken.get());
+	EXPECT_EQ(last, taken->physical_task_id());
+	taken->run(context, locality);
+	EXPECT_EQ(-1, result);
+	scheduler.notify_task_completion(taken->physical_task_id());
+	EXPECT_TRUE(scheduler.is_finished());
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <gtest/gtest.h>
+#include "tasks/physical_task.hpp"
+#include "tasks/physical_task_command_base.hpp"
+#include "scheduler/work_stealing_deque.hpp"
+
+TEST(WorkStealingDeque, PushTakeSteal){
+	std::vector<std::shared_ptr<m3bp::PhysicalTask>> tasks;
+	for(int i = 0; i < 200; ++i){
+		tasks.emplace_back(std::make_shared<m3bp::PhysicalTask>());
+	}
+	m3bp::WorkStealingDeque deque;
+	EXPECT_TRUE(deque.empty());
+	EXPECT_EQ(nullptr, deque.take().get());
+	EXPECT_EQ(nullptr, deque.steal().get());
+
+	// The owner takes the newest task and thieves steal the oldest one
+	for(const auto &t : tasks){ deque.push(t); }
+	EXPECT_FALSE(deque.empty());
+	EXPECT_EQ(tasks.back(), deque.take());
+	EXPECT_EQ(tasks.front(), deque.steal());
+	for(size_t i = 1; i + 1 < tasks.size(); ++i){
+		EXPECT_EQ(tasks[i], deque.steal());
+	}
+	EXPECT_TRUE(deque.empty());
+
+	// Remaining tasks are released with the deque
+	deque.push(std::make_shared<m3bp::PhysicalTask>());
+}
+
+TEST(WorkStealingDeque, Priority){
+	std::vector<std::shared_ptr<m3bp::PhysicalTask>> tasks;
+	for(int i = 0; i < 100; ++i){
+		tasks.emplace_back(std::make_shared<m3bp::PhysicalTask>());
+	}
+	m3bp::WorkStealingDeque deque;
+	EXPECT_EQ(0u, deque.bottom_priority());
+	EXPECT_EQ(0u, deque.top_priority());
+
+	// Priorities follow the tasks at both ends, also across growth
+	for(size_t i = 0; i < tasks.size(); ++i){ deque.push(tasks[i], i + 1); }
+	EXPECT_EQ(tasks.size(), deque.bottom_priority());
+	EXPECT_EQ(1u, deque.top_priority());
+	EXPECT_EQ(tasks.back(), deque.take());
+	EXPECT_EQ(tasks.size() - 1, deque.bottom_priority());
+	EXPECT_EQ(tasks.front(), deque.steal());
+	EXPECT_EQ(2u, deque.top_priority());
+	while(deque.take()){ }
+	EXPECT_EQ(0u, deque.bottom_priority());
+	EXPECT_EQ(0u, deque.top_priority());
+}
+
+TEST(WorkStealingDeque, ConcurrentSteal){
+	const int num_thieves = 4, num_tasks = 100000;
+	std::vector<std::shared_ptr<m3bp::PhysicalTask>> tasks;
+	for(int i = 0; i < num_tasks; ++i){
+		tasks.emplace_back(std::make_shared<m3bp::PhysicalTask>());
+	}
+	m3bp::WorkStealingDeque deque;
+	std::atomic<int> taken_count(0);
+	std::atomic<bool> finished(false);
+	std::vector<std::thread> thieves;
+	for(int i = 0; i < num_thieves; ++i){
+		thieves.emplace_back([&](){
+			while(!finished.load()){
+				if(deque.steal()){ ++taken_count; }
+			}
+		});
+	}
+	for(int i = 0; i < num_tasks; ++i){
+		deque.push(tasks[i]);
+		if(i % 3 == 0 && deque.take()){ ++taken_count; }
+	}
+	while(deque.take()){ ++taken_count; }
+	while(taken_count.load() < num_tasks && !deque.empty()){
+		std::this_thread::yield();
+	}
+	finished = true;
+	for(auto &t : thieves){ t.join(); }
+	EXPECT_EQ(num_tasks, taken_count.load());
+	// Every task is referenced only from the vector again
+	for(const auto &t : tasks){ ASSERT_EQ(1, t.use_count()); }
+}
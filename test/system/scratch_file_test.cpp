@@ -0,0 +1,67 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <vector>
+#include <thread>
+#include "system/scratch_file.hpp"
+
+TEST(ScratchFile, AppendAndRead){
+	m3bp::ScratchFile file("/tmp");
+	EXPECT_EQ(0u, file.size());
+	const std::string a = "hello", b = "scratch file";
+	EXPECT_EQ(0u, file.append(a.data(), a.size()));
+	EXPECT_EQ(a.size(), file.append(b.data(), b.size()));
+	EXPECT_EQ(a.size() + b.size(), file.size());
+	std::vector<char> buffer(b.size());
+	file.read(buffer.data(), b.size(), a.size());
+	EXPECT_EQ(b, std::string(buffer.begin(), buffer.end()));
+	file.read(buffer.data(), a.size(), 0);
+	EXPECT_EQ(a, std::string(buffer.begin(), buffer.begin() + a.size()));
+}
+
+TEST(ScratchFile, ConcurrentWrite){
+	const int thread_count = 4;
+	const m3bp::size_type block_size = 1 << 16;
+	m3bp::ScratchFile file("/tmp");
+	std::vector<m3bp::size_type> offsets(thread_count);
+	std::vector<std::thread> threads;
+	for(int i = 0; i < thread_count; ++i){
+		threads.emplace_back([&, i](){
+			const std::vector<uint8_t> data(block_size, i);
+			offsets[i] = file.reserve(block_size);
+			file.write(data.data(), block_size, offsets[i]);
+		});
+	}
+	for(auto &t : threads){ t.join(); }
+	EXPECT_EQ(thread_count * block_size, file.size());
+	for(int i = 0; i < thread_count; ++i){
+		std::vector<uint8_t> data(block_size);
+		file.read(data.data(), block_size, offsets[i]);
+		EXPECT_EQ(std::vector<uint8_t>(block_size, i), data);
+	}
+}
+
+TEST(ScratchFile, InvalidDirectory){
+	EXPECT_THROW(
+		m3bp::ScratchFile("/nonexistent-m3bp-directory"),
+		std::system_error);
+}
+
+TEST(ScratchFile, ReadBeyondEnd){
+	m3bp::ScratchFile file("/tmp");
+	char buffer[4];
+	EXPECT_THROW(file.read(buffer, sizeof(buffer), 0), std::runtime_error);
+}
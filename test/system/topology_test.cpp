@@ -81,3 +81,33 @@ TEST(Topology, MemoryBind){
 	}
 }
 
+TEST(Topology, MemoryLocation){
+	const auto n = 1 << 20;
+	auto &topo = m3bp::Topology::instance();
+	const auto num_nodes = topo.numa_node_count();
+	for(m3bp::identifier_type i = 0; i < num_nodes; ++i){
+		auto p = reinterpret_cast<uint8_t *>(topo.allocate_membind(n, i));
+		std::fill(p, p + n, 0xcc);
+		EXPECT_EQ(i, topo.memory_location(p, n));
+		topo.release_membind(p, n);
+	}
+}
+
+
+TEST(Topology, HugePages){
+	const auto n = 5 << 20;
+	auto &topo = m3bp::Topology::instance();
+	const auto num_nodes = topo.numa_node_count();
+	for(m3bp::identifier_type i = 0; i < num_nodes; ++i){
+		const auto before = topo.huge_page_bytes() + topo.thp_advised_bytes();
+		auto p = reinterpret_cast<uint8_t *>(
+			topo.allocate_membind(n, i, 4 << 20));
+		std::fill(p, p + n, 0xcc);
+		const auto after = topo.huge_page_bytes() + topo.thp_advised_bytes();
+		// Falls back to small pages when huge pages are not available
+		EXPECT_TRUE(after == before || after == before + (6 << 20));
+		topo.release_membind(p, n);
+		// Counters track live mappings
+		EXPECT_EQ(before, topo.huge_page_bytes() + topo.thp_advised_bytes());
+	}
+}
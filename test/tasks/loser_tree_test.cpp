@@ -0,0 +1,72 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "tasks/shuffle/loser_tree.hpp"
+
+namespace {
+
+void run_test(m3bp::size_type stream_count, m3bp::size_type max_length){
+	std::mt19937 engine(stream_count);
+	std::uniform_int_distribution<m3bp::size_type> length_dist(0, max_length);
+	std::uniform_int_distribution<int> value_dist(0, 1000);
+	std::vector<std::vector<int>> streams(stream_count);
+	std::vector<int> expected;
+	for(auto &s : streams){
+		s.resize(length_dist(engine));
+		for(auto &x : s){ x = value_dist(engine); }
+		std::sort(s.begin(), s.end());
+		expected.insert(expected.end(), s.begin(), s.end());
+	}
+	std::sort(expected.begin(), expected.end());
+
+	std::vector<m3bp::size_type> cursors(stream_count);
+	auto tree = m3bp::make_loser_tree(
+		stream_count,
+		[&](m3bp::identifier_type a, m3bp::identifier_type b){
+			if(cursors[a] == streams[a].size()){ return false; }
+			if(cursors[b] == streams[b].size()){ return true; }
+			return streams[a][cursors[a]] < streams[b][cursors[b]];
+		});
+	std::vector<int> actual;
+	while(stream_count > 0){
+		const auto top = tree.top();
+		if(cursors[top] == streams[top].size()){ break; }
+		actual.push_back(streams[top][cursors[top]++]);
+		tree.update();
+	}
+	EXPECT_EQ(expected, actual);
+}
+
+}
+
+TEST(LoserTree, SingleStream){
+	run_test(1, 100);
+}
+
+TEST(LoserTree, PowerOfTwoStreams){
+	run_test(16, 100);
+}
+
+TEST(LoserTree, ArbitraryStreams){
+	run_test(13, 100);
+}
+
+TEST(LoserTree, ShortStreams){
+	run_test(37, 2);
+}
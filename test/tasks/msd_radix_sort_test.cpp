@@ -0,0 +1,157 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <array>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include "tasks/shuffle/msd_radix_sort.hpp"
+#include "tasks/shuffle/partitioner.hpp"
+
+namespace {
+
+class RecordSet {
+private:
+	std::vector<std::vector<uint8_t>> m_records;
+public:
+	void add(const std::vector<uint8_t> &key){
+		std::vector<uint8_t> record(2 * sizeof(m3bp::size_type) + key.size());
+		const auto header = reinterpret_cast<m3bp::size_type *>(record.data());
+		header[0] = key.size();
+		header[1] = key.size();
+		std::copy(key.begin(), key.end(), record.begin() + 2 * sizeof(*header));
+		m_records.push_back(std::move(record));
+	}
+	std::vector<const uint8_t *> pointers() const {
+		std::vector<const uint8_t *> result;
+		for(const auto &r : m_records){ result.push_back(r.data()); }
+		return result;
+	}
+};
+
+int compare_records(const uint8_t *a, const uint8_t *b){
+	return m3bp::compare_padded_keys(
+		m3bp::get_key_pointer(a), m3bp::get_key_length(a),
+		m3bp::get_key_pointer(b), m3bp::get_key_length(b));
+}
+
+void verify_sorted(
+	const std::vector<const uint8_t *> &pointers,
+	const std::vector<uint8_t> &equals_to_left)
+{
+	for(m3bp::identifier_type i = 1; i < pointers.size(); ++i){
+		const auto c = compare_records(pointers[i - 1], pointers[i]);
+		EXPECT_GE(0, c);
+		EXPECT_EQ(c == 0, equals_to_left[i] != 0);
+	}
+}
+
+void run_test(const RecordSet &records){
+	const auto expected = records.pointers();
+	const auto n = expected.size();
+	{
+		auto pointers = expected;
+		std::vector<uint8_t> equals_to_left(n);
+		std::vector<m3bp::cache_type> cache(n), cache_work(n);
+		std::vector<const uint8_t *> pointers_work(n);
+		m3bp::msd_radix_sort(
+			equals_to_left.data(), cache.data(), pointers.data(),
+			cache_work.data(), pointers_work.data(), n);
+		verify_sorted(pointers, equals_to_left);
+	}
+	{
+		auto pointers = expected;
+		std::vector<uint8_t> equals_to_left(n);
+		std::vector<m3bp::cache_type> cache(n), cache_work(n);
+		std::vector<const uint8_t *> pointers_work(n);
+		m3bp::msd_radix_sort(
+			equals_to_left.data(), cache.data(), pointers.data(),
+			cache_work.data(), pointers_work.data(), n, 0, false, true);
+		verify_sorted(pointers, equals_to_left);
+	}
+	{
+		auto pointers = expected;
+		std::vector<uint8_t> equals_to_left(n);
+		std::vector<m3bp::cache_type> cache(n);
+		m3bp::msd_radix_sort_in_place(
+			equals_to_left.data(), cache.data(), pointers.data(), n);
+		verify_sorted(pointers, equals_to_left);
+		auto sorted_expected = expected, sorted_actual = pointers;
+		std::sort(sorted_expected.begin(), sorted_expected.end());
+		std::sort(sorted_actual.begin(), sorted_actual.end());
+		EXPECT_EQ(sorted_expected, sorted_actual);
+	}
+}
+
+RecordSet generate_records(
+	m3bp::size_type n, m3bp::size_type max_length, int alphabet)
+{
+	std::default_random_engine engine;
+	std::uniform_int_distribution<m3bp::size_type> length_dist(0, max_length);
+	std::uniform_int_distribution<int> byte_dist(0, alphabet - 1);
+	RecordSet records;
+	for(m3bp::identifier_type i = 0; i < n; ++i){
+		std::vector<uint8_t> key(length_dist(engine));
+		for(auto &x : key){ x = static_cast<uint8_t>(byte_dist(engine)); }
+		records.add(key);
+	}
+	return records;
+}
+
+}
+
+TEST(MsdRadixSort, Empty){
+	run_test(RecordSet());
+}
+
+TEST(MsdRadixSort, EmptyKeys){
+	RecordSet records;
+	for(int i = 0; i < 1000; ++i){ records.add({ }); }
+	run_test(records);
+}
+
+TEST(MsdRadixSort, PaddedKeys){
+	RecordSet records;
+	for(int i = 0; i < 500; ++i){
+		records.add({ 1, 2 });
+		records.add({ 1, 2, 0, 0 });
+		records.add({ 1 });
+		records.add({ 1, 2, 0, 0, 0, 0, 0, 0, 0, 1 });
+	}
+	run_test(records);
+}
+
+TEST(MsdRadixSort, ShortRandomKeys){
+	run_test(generate_records(100000, 3, 256));
+}
+
+TEST(MsdRadixSort, LongRandomKeys){
+	run_test(generate_records(50000, 40, 4));
+}
+
+TEST(MsdRadixSort, CommonPrefix){
+	std::default_random_engine engine;
+	std::uniform_int_distribution<int> byte_dist(0, 255);
+	RecordSet records;
+	for(int i = 0; i < 100000; ++i){
+		std::vector<uint8_t> key(19, 'x');
+		key.push_back(static_cast<uint8_t>(byte_dist(engine)));
+		key.push_back(static_cast<uint8_t>(byte_dist(engine)));
+		records.add(key);
+	}
+	run_test(records);
+}
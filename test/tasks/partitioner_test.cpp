@@ -0,0 +1,93 @@
+/*
+ * Copyright 2016 Fixstars Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "tasks/shuffle/partitioner.hpp"
+
+namespace {
+
+m3bp::identifier_type partition_of(
+	const m3bp::PartitionerBase &partitioner, const std::string &key)
+{
+	return partitioner.partition(key.data(), key.size());
+}
+
+}
+
+TEST(Partitioner, ComparePaddedKeys){
+	const auto compare = [](const std::string &a, const std::string &b){
+		return m3bp::compare_padded_keys(
+			reinterpret_cast<const uint8_t *>(a.data()), a.size(),
+			reinterpret_cast<const uint8_t *>(b.data()), b.size());
+	};
+	EXPECT_EQ(0, compare("abc", "abc"));
+	EXPECT_EQ(0, compare("abc", std::string("abc\0\0", 5)));
+	EXPECT_GT(0, compare("abc", "abd"));
+	EXPECT_LT(0, compare("abcd", "abc"));
+	EXPECT_GT(0, compare("", "a"));
+}
+
+TEST(Partitioner, Hash){
+	const m3bp::HashPartitioner partitioner(13);
+	for(int i = 0; i < 100; ++i){
+		const auto key = std::to_string(i);
+		const auto p = partition_of(partitioner, key);
+		EXPECT_GT(13u, p);
+		EXPECT_EQ(m3bp::hash_byte_sequence(key.data(), key.size(), 13), p);
+	}
+}
+
+TEST(Partitioner, Range){
+	const m3bp::RangePartitioner partitioner({ "b", "d", "f" });
+	EXPECT_EQ(0u, partition_of(partitioner, ""));
+	EXPECT_EQ(0u, partition_of(partitioner, "a"));
+	EXPECT_EQ(1u, partition_of(partitioner, "b"));
+	EXPECT_EQ(1u, partition_of(partitioner, std::string("b\0", 2)));
+	EXPECT_EQ(1u, partition_of(partitioner, "c"));
+	EXPECT_EQ(2u, partition_of(partitioner, "d"));
+	EXPECT_EQ(2u, partition_of(partitioner, "ezz"));
+	EXPECT_EQ(3u, partition_of(partitioner, "f"));
+	EXPECT_EQ(3u, partition_of(partitioner, "z"));
+}
+
+TEST(Partitioner, RangeFromSamples){
+	std::vector<std::string> samples;
+	for(char c = 'z'; c >= 'a'; --c){ samples.emplace_back(1, c); }
+	const auto partitioner =
+		m3bp::RangePartitioner::from_samples(samples, 2);
+	ASSERT_EQ(1u, partitioner.split_points().size());
+	EXPECT_EQ("n", partitioner.split_points()[0]);
+	EXPECT_EQ(0u, partition_of(partitioner, "m"));
+	EXPECT_EQ(1u, partition_of(partitioner, "n"));
+}
+
+TEST(Partitioner, RangeFromDuplicatedSamples){
+	const std::vector<std::string> samples(10, "x");
+	const auto partitioner =
+		m3bp::RangePartitioner::from_samples(samples, 4);
+	ASSERT_EQ(1u, partitioner.split_points().size());
+	EXPECT_EQ(0u, partition_of(partitioner, "a"));
+	EXPECT_EQ(1u, partition_of(partitioner, "x"));
+	EXPECT_EQ(1u, partition_of(partitioner, "y"));
+}
+
+TEST(Partitioner, RangeFromNoSamples){
+	const auto partitioner =
+		m3bp::RangePartitioner::from_samples({ }, 4);
+	EXPECT_TRUE(partitioner.split_points().empty());
+	EXPECT_EQ(0u, partition_of(partitioner, "a"));
+}
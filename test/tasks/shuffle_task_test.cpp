@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 #include <gtest/gtest.h>
+#include <map>
+#include <atomic>
+#include <random>
+#include <cstring>
 #include "tasks/shuffle/shuffle_logical_task.hpp"
 #include "graph/logical_graph.hpp"
 #include "common/hash_function.hpp"
@@ -25,29 +29,29 @@
 namespace {
 
 template <typename KeyType, typename ValueType>
-void run_test(
+std::shared_ptr<m3bp::ShuffleLogicalTask> run_test(
 	m3bp::size_type partition_count,
-	m3bp::size_type fragment_count,
-	m3bp::size_type record_count)
+	const std::vector<std::vector<std::pair<KeyType, ValueType>>> &dataset,
+	const m3bp::Configuration &config,
+	m3bp::size_type parallel_sort_threshold,
+	m3bp::Grouping grouping = m3bp::Grouping::SORT)
 {
 	using PairType = std::pair<KeyType, ValueType>;
-	std::vector<std::vector<PairType>> dataset(fragment_count);
-	for(m3bp::identifier_type i = 0; i < fragment_count; ++i){
-		for(m3bp::identifier_type j = 0; j < record_count; ++j){
-			dataset[i].emplace_back(
-				util::generate_random<KeyType>(),
-				util::generate_random<ValueType>());
-		}
-	}
-
 	m3bp::LogicalGraph graph;
 	auto receiver = std::make_shared<
 		util::GroupedReceiverTask<KeyType, ValueType>>(partition_count);
 	const auto sender_id = graph.add_logical_task(
 		std::make_shared<util::SenderTask<PairType>>(
 			dataset.begin(), dataset.end()));
-	const auto shuffle_id = graph.add_logical_task(
-		std::make_shared<m3bp::ShuffleLogicalTask>(partition_count));
+	auto shuffle = std::make_shared<m3bp::ShuffleLogicalTask>(
+		partition_count,
+		m3bp::ShuffleLogicalTask::CombinerType(),
+		m3bp::Partitioning::HASH,
+		grouping);
+	if(parallel_sort_threshold > 0){
+		shuffle->parallel_sort_threshold(parallel_sort_threshold);
+	}
+	const auto shuffle_id = graph.add_logical_task(shuffle);
 	const auto receiver_id = graph.add_logical_task(receiver);
 	graph
 		.add_edge(
@@ -58,7 +62,7 @@ void run_test(
 			m3bp::LogicalGraph::Port(shuffle_id, 0),
 			m3bp::LogicalGraph::Port(receiver_id, 0),
 			m3bp::LogicalGraph::PhysicalSuccessor::BARRIER);
-	util::execute_logical_graph(graph);
+	util::execute_logical_graph(graph, config);
 
 	using BinaryPair = std::pair<std::vector<uint8_t>, PairType>;
 	std::vector<std::vector<BinaryPair>> partitioned(partition_count);
@@ -93,8 +97,380 @@ void run_test(
 		for(auto &g : actual_groups){
 			std::sort(g.second.begin(), g.second.end());
 		}
+		if(grouping == m3bp::Grouping::HASH){
+			// Groups are not ordered but each key must appear only once
+			std::vector<std::pair<std::vector<uint8_t>, GroupType>> keyed;
+			for(auto &g : actual_groups){
+				std::vector<uint8_t> buf(util::binary_length(g.first));
+				util::write_binary(buf.data(), g.first);
+				keyed.emplace_back(std::move(buf), std::move(g));
+			}
+			std::sort(keyed.begin(), keyed.end());
+			actual_groups.clear();
+			for(auto &g : keyed){
+				actual_groups.push_back(std::move(g.second));
+			}
+		}
 		EXPECT_EQ(expected_groups, actual_groups);
 	}
+	return shuffle;
+}
+
+template <typename KeyType, typename ValueType>
+std::shared_ptr<m3bp::ShuffleLogicalTask> run_test(
+	m3bp::size_type partition_count,
+	m3bp::size_type fragment_count,
+	m3bp::size_type record_count,
+	const m3bp::Configuration &config =
+		m3bp::Configuration().max_concurrency(4),
+	m3bp::size_type parallel_sort_threshold = 0)
+{
+	using PairType = std::pair<KeyType, ValueType>;
+	std::vector<std::vector<PairType>> dataset(fragment_count);
+	for(m3bp::identifier_type i = 0; i < fragment_count; ++i){
+		for(m3bp::identifier_type j = 0; j < record_count; ++j){
+			dataset[i].emplace_back(
+				util::generate_random<KeyType>(),
+				util::generate_random<ValueType>());
+		}
+	}
+	return run_test(
+		partition_count, dataset, config, parallel_sort_threshold);
+}
+
+template <typename KeyType, typename ValueType>
+void run_hash_grouped_test(
+	m3bp::size_type partition_count,
+	m3bp::size_type fragment_count,
+	m3bp::size_type record_count,
+	m3bp::size_type key_kinds,
+	const m3bp::Configuration &config =
+		m3bp::Configuration().max_concurrency(4))
+{
+	using PairType = std::pair<KeyType, ValueType>;
+	const auto keys =
+		util::generate_distinct_random_sequence<KeyType>(key_kinds);
+	std::uniform_int_distribution<> key_dist(0, key_kinds - 1);
+	std::vector<std::vector<PairType>> dataset(fragment_count);
+	for(m3bp::identifier_type i = 0; i < fragment_count; ++i){
+		for(m3bp::identifier_type j = 0; j < record_count; ++j){
+			dataset[i].emplace_back(
+				keys[key_dist(util::g_random_engine)],
+				util::generate_random<ValueType>());
+		}
+	}
+	run_test(
+		partition_count, dataset, config, 0, m3bp::Grouping::HASH);
+}
+
+// Keys that differ only in trailing zeros must belong to the same group
+void run_padded_key_test(m3bp::Grouping grouping){
+	using PairType = std::pair<std::string, int>;
+	const m3bp::size_type fragment_count = 8, record_count = 1000;
+	const auto keys =
+		util::generate_distinct_random_sequence<std::string>(100);
+	std::uniform_int_distribution<> key_dist(0, keys.size() - 1);
+	std::uniform_int_distribution<> padding_dist(0, 3);
+	std::vector<std::vector<PairType>> dataset(fragment_count);
+	std::map<std::string, std::vector<int>> expected;
+	for(m3bp::identifier_type i = 0; i < fragment_count; ++i){
+		for(m3bp::identifier_type j = 0; j < record_count; ++j){
+			const auto &key = keys[key_dist(util::g_random_engine)];
+			const auto value = util::generate_random<int>();
+			dataset[i].emplace_back(
+				key + std::string(padding_dist(util::g_random_engine), '\0'),
+				value);
+			expected[key].push_back(value);
+		}
+	}
+
+	m3bp::LogicalGraph graph;
+	auto receiver =
+		std::make_shared<util::GroupedReceiverTask<std::string, int>>(1);
+	const auto sender_id = graph.add_logical_task(
+		std::make_shared<util::SenderTask<PairType>>(
+			dataset.begin(), dataset.end()));
+	const auto shuffle_id = graph.add_logical_task(
+		std::make_shared<m3bp::ShuffleLogicalTask>(
+			1, m3bp::ShuffleLogicalTask::CombinerType(),
+			m3bp::Partitioning::HASH, grouping));
+	const auto receiver_id = graph.add_logical_task(receiver);
+	graph
+		.add_edge(
+			m3bp::LogicalGraph::Port(sender_id, 0),
+			m3bp::LogicalGraph::Port(shuffle_id, 0),
+			m3bp::LogicalGraph::PhysicalSuccessor::BARRIER)
+		.add_edge(
+			m3bp::LogicalGraph::Port(shuffle_id, 0),
+			m3bp::LogicalGraph::Port(receiver_id, 0),
+			m3bp::LogicalGraph::PhysicalSuccessor::BARRIER);
+	util::execute_logical_graph(
+		graph, m3bp::Configuration().max_concurrency(4));
+
+	for(auto &x : expected){ std::sort(x.second.begin(), x.second.end()); }
+	std::map<std::string, std::vector<int>> actual;
+	for(const auto &g : receiver->received_data(0)){
+		EXPECT_EQ(0u, actual.count(g.first));
+		auto &values = actual[g.first];
+		values = g.second;
+		std::sort(values.begin(), values.end());
+	}
+	EXPECT_EQ(expected, actual);
+}
+
+template <typename KeyType, typename ValueType>
+void run_skewed_test(
+	m3bp::size_type partition_count,
+	m3bp::size_type fragment_count,
+	m3bp::size_type record_count,
+	double hot_key_ratio,
+	m3bp::size_type parallel_sort_threshold)
+{
+	using PairType = std::pair<KeyType, ValueType>;
+	const auto hot_key = util::generate_random<KeyType>();
+	std::bernoulli_distribution hot_dist(hot_key_ratio);
+	std::vector<std::vector<PairType>> dataset(fragment_count);
+	for(m3bp::identifier_type i = 0; i < fragment_count; ++i){
+		for(m3bp::identifier_type j = 0; j < record_count; ++j){
+			dataset[i].emplace_back(
+				hot_dist(util::g_random_engine)
+					? hot_key
+					: util::generate_random<KeyType>(),
+				util::generate_random<ValueType>());
+		}
+	}
+	run_test(
+		partition_count, dataset,
+		m3bp::Configuration().max_concurrency(4),
+		parallel_sort_threshold);
+}
+
+// Keys share a long prefix, so the first byte does not distribute them
+void run_common_prefix_test(
+	m3bp::size_type fragment_count,
+	m3bp::size_type record_count,
+	m3bp::size_type parallel_sort_threshold)
+{
+	using PairType = std::pair<std::string, int>;
+	const std::string prefix = "user_000000000000";
+	std::vector<std::vector<PairType>> dataset(fragment_count);
+	for(m3bp::identifier_type i = 0; i < fragment_count; ++i){
+		for(m3bp::identifier_type j = 0; j < record_count; ++j){
+			dataset[i].emplace_back(
+				prefix + util::generate_random<std::string>(),
+				util::generate_random<int>());
+		}
+	}
+	const auto shuffle = run_test(
+		1, dataset, m3bp::Configuration().max_concurrency(4),
+		parallel_sort_threshold);
+	EXPECT_LT(1u, shuffle->range_sort_task_count());
+}
+
+template <typename KeyType>
+void run_combined_test(
+	m3bp::size_type partition_count,
+	m3bp::size_type fragment_count,
+	m3bp::size_type record_count,
+	m3bp::size_type key_kinds)
+{
+	using ValueType = unsigned long long;
+	using PairType = std::pair<KeyType, ValueType>;
+	const auto keys =
+		util::generate_distinct_random_sequence<KeyType>(key_kinds);
+	std::uniform_int_distribution<> key_dist(0, key_kinds - 1);
+	std::vector<std::vector<PairType>> dataset(fragment_count);
+	std::vector<std::map<KeyType, ValueType>> expected(partition_count);
+	for(m3bp::identifier_type i = 0; i < fragment_count; ++i){
+		for(m3bp::identifier_type j = 0; j < record_count; ++j){
+			const auto key = keys[key_dist(util::g_random_engine)];
+			const auto value = util::generate_random<ValueType>();
+			dataset[i].emplace_back(key, value);
+			expected[util::compute_hash(key, partition_count)][key] += value;
+		}
+	}
+
+	std::atomic<m3bp::size_type> combine_count(0);
+	auto combiner = [&combine_count](
+		void *dst,
+		const void *lhs, m3bp::size_type lhs_size,
+		const void *rhs, m3bp::size_type rhs_size) -> m3bp::size_type
+	{
+		EXPECT_EQ(sizeof(ValueType), lhs_size);
+		EXPECT_EQ(sizeof(ValueType), rhs_size);
+		const auto x = util::read_binary<ValueType>(lhs).first;
+		const auto y = util::read_binary<ValueType>(rhs).first;
+		util::write_binary(dst, x + y);
+		++combine_count;
+		return sizeof(ValueType);
+	};
+
+	m3bp::LogicalGraph graph;
+	auto receiver = std::make_shared<
+		util::GroupedReceiverTask<KeyType, ValueType>>(partition_count);
+	const auto sender_id = graph.add_logical_task(
+		std::make_shared<util::SenderTask<PairType>>(
+			dataset.begin(), dataset.end()));
+	const auto shuffle_id = graph.add_logical_task(
+		std::make_shared<m3bp::ShuffleLogicalTask>(
+			partition_count, combiner));
+	const auto receiver_id = graph.add_logical_task(receiver);
+	graph
+		.add_edge(
+			m3bp::LogicalGraph::Port(sender_id, 0),
+			m3bp::LogicalGraph::Port(shuffle_id, 0),
+			m3bp::LogicalGraph::PhysicalSuccessor::BARRIER)
+		.add_edge(
+			m3bp::LogicalGraph::Port(shuffle_id, 0),
+			m3bp::LogicalGraph::Port(receiver_id, 0),
+			m3bp::LogicalGraph::PhysicalSuccessor::BARRIER);
+	util::execute_logical_graph(graph);
+
+	m3bp::size_type received_count = 0;
+	for(m3bp::identifier_type i = 0; i < partition_count; ++i){
+		std::map<KeyType, ValueType> actual;
+		for(const auto &g : receiver->received_data(i)){
+			EXPECT_EQ(0u, actual.count(g.first));
+			ValueType sum = 0;
+			for(const auto &v : g.second){ sum += v; }
+			actual[g.first] = sum;
+			received_count += g.second.size();
+		}
+		EXPECT_EQ(expected[i], actual);
+	}
+	// each fragment contributes at most one value per key
+	EXPECT_GE(fragment_count * key_kinds, received_count);
+	EXPECT_EQ(fragment_count * record_count, received_count + combine_count);
+}
+
+// Concatenates values so that merged values grow with each combination
+void run_concatenated_test(
+	m3bp::size_type partition_count,
+	m3bp::size_type record_count,
+	m3bp::size_type key_kinds)
+{
+	using PairType = std::pair<int, std::string>;
+	std::vector<std::vector<PairType>> dataset(1);
+	std::map<int, std::string> expected;
+	for(m3bp::identifier_type j = 0; j < record_count; ++j){
+		const int key = static_cast<int>(j % key_kinds);
+		const std::string value(1, static_cast<char>('a' + j % 26));
+		dataset[0].emplace_back(key, value);
+		expected[key] += value;
+	}
+
+	auto combiner = [](
+		void *dst,
+		const void *lhs, m3bp::size_type lhs_size,
+		const void *rhs, m3bp::size_type rhs_size) -> m3bp::size_type
+	{
+		// drop the terminator of the left hand side
+		const auto p = static_cast<char *>(dst);
+		memcpy(p, lhs, lhs_size - 1);
+		memcpy(p + lhs_size - 1, rhs, rhs_size);
+		return lhs_size - 1 + rhs_size;
+	};
+
+	m3bp::LogicalGraph graph;
+	auto receiver = std::make_shared<
+		util::GroupedReceiverTask<int, std::string>>(partition_count);
+	const auto sender_id = graph.add_logical_task(
+		std::make_shared<util::SenderTask<PairType>>(
+			dataset.begin(), dataset.end()));
+	const auto shuffle_id = graph.add_logical_task(
+		std::make_shared<m3bp::ShuffleLogicalTask>(
+			partition_count, combiner));
+	const auto receiver_id = graph.add_logical_task(receiver);
+	graph
+		.add_edge(
+			m3bp::LogicalGraph::Port(sender_id, 0),
+			m3bp::LogicalGraph::Port(shuffle_id, 0),
+			m3bp::LogicalGraph::PhysicalSuccessor::BARRIER)
+		.add_edge(
+			m3bp::LogicalGraph::Port(shuffle_id, 0),
+			m3bp::LogicalGraph::Port(receiver_id, 0),
+			m3bp::LogicalGraph::PhysicalSuccessor::BARRIER);
+	util::execute_logical_graph(graph);
+
+	std::map<int, std::string> actual;
+	for(m3bp::identifier_type i = 0; i < partition_count; ++i){
+		for(const auto &g : receiver->received_data(i)){
+			ASSERT_EQ(1u, g.second.size());
+			EXPECT_EQ(0u, actual.count(g.first));
+			actual[g.first] = g.second[0];
+		}
+	}
+	// values in a fragment are merged in the order of records
+	EXPECT_EQ(expected, actual);
+}
+
+template <typename KeyType, typename ValueType>
+void run_range_test(
+	m3bp::size_type partition_count,
+	m3bp::size_type fragment_count,
+	m3bp::size_type record_count)
+{
+	using PairType = std::pair<KeyType, ValueType>;
+	std::vector<std::vector<PairType>> dataset(fragment_count);
+	std::map<std::vector<uint8_t>, std::vector<ValueType>> expected;
+	for(m3bp::identifier_type i = 0; i < fragment_count; ++i){
+		for(m3bp::identifier_type j = 0; j < record_count; ++j){
+			const auto key = util::generate_random<KeyType>();
+			const auto value = util::generate_random<ValueType>();
+			dataset[i].emplace_back(key, value);
+			std::vector<uint8_t> buf(util::binary_length(key));
+			util::write_binary(buf.data(), key);
+			expected[buf].push_back(value);
+		}
+	}
+
+	m3bp::LogicalGraph graph;
+	auto receiver = std::make_shared<
+		util::GroupedReceiverTask<KeyType, ValueType>>(partition_count);
+	const auto sender_id = graph.add_logical_task(
+		std::make_shared<util::SenderTask<PairType>>(
+			dataset.begin(), dataset.end()));
+	const auto shuffle_id = graph.add_logical_task(
+		std::make_shared<m3bp::ShuffleLogicalTask>(
+			partition_count,
+			m3bp::ShuffleLogicalTask::CombinerType(),
+			m3bp::Partitioning::RANGE));
+	const auto receiver_id = graph.add_logical_task(receiver);
+	graph
+		.add_edge(
+			m3bp::LogicalGraph::Port(sender_id, 0),
+			m3bp::LogicalGraph::Port(shuffle_id, 0),
+			m3bp::LogicalGraph::PhysicalSuccessor::BARRIER)
+		.add_edge(
+			m3bp::LogicalGraph::Port(shuffle_id, 0),
+			m3bp::LogicalGraph::Port(receiver_id, 0),
+			m3bp::LogicalGraph::PhysicalSuccessor::BARRIER);
+	util::execute_logical_graph(graph);
+
+	// Concatenation of all partitions must be sorted by keys
+	const auto total_count = fragment_count * record_count;
+	auto expected_it = expected.begin();
+	for(m3bp::identifier_type i = 0; i < partition_count; ++i){
+		const auto groups = receiver->received_data(i);
+		m3bp::size_type partition_record_count = 0;
+		for(const auto &g : groups){
+			ASSERT_TRUE(expected_it != expected.end());
+			std::vector<uint8_t> buf(util::binary_length(g.first));
+			util::write_binary(buf.data(), g.first);
+			EXPECT_EQ(expected_it->first, buf);
+			auto expected_values = expected_it->second;
+			auto actual_values = g.second;
+			std::sort(expected_values.begin(), expected_values.end());
+			std::sort(actual_values.begin(), actual_values.end());
+			EXPECT_EQ(expected_values, actual_values);
+			partition_record_count += g.second.size();
+			++expected_it;
+		}
+		// Split points are computed from samples, so partitions must be
+		// roughly balanced
+		EXPECT_GE(3 * total_count / partition_count, partition_record_count);
+	}
+	EXPECT_TRUE(expected_it == expected.end());
 }
 
 }
@@ -123,3 +499,153 @@ TEST(ShuffleTask, RandomVarLenKeyAndVarLenValue){
 	run_test<std::string, std::string>(24, 19, 1000);
 }
 
+
+TEST(ShuffleTask, ParallelSortFixedKey){
+	const auto config = m3bp::Configuration().max_concurrency(4);
+	run_test<int, unsigned long long>(1, 7, 1000, config, 100);
+}
+
+TEST(ShuffleTask, ParallelSortVarLenKey){
+	const auto config = m3bp::Configuration().max_concurrency(4);
+	run_test<std::string, std::string>(3, 10, 1000, config, 100);
+}
+
+TEST(ShuffleTask, ParallelSortSingleFragment){
+	const auto config = m3bp::Configuration().max_concurrency(4);
+	run_test<std::string, int>(1, 1, 5000, config, 100);
+}
+
+TEST(ShuffleTask, SkewedHotKey){
+	run_skewed_test<int, int>(32, 8, 2000, 0.5, 100);
+}
+
+TEST(ShuffleTask, SkewedVarLenKey){
+	run_skewed_test<std::string, std::string>(16, 8, 1000, 0.3, 100);
+}
+
+TEST(ShuffleTask, ParallelSortCommonPrefix){
+	run_common_prefix_test(8, 1000, 100);
+}
+
+TEST(ShuffleTask, CoalescedPartitions){
+	// 4000 records of 24 bytes are coalesced into sort tasks that hold at
+	// least 64 KiB except for the last one
+	const auto shuffle = run_test<int, int>(97, 4, 1000);
+	EXPECT_LE(1u, shuffle->sort_task_count());
+	EXPECT_GE(3u, shuffle->sort_task_count());
+}
+
+TEST(ShuffleTask, SpillAllFragments){
+	const auto config = m3bp::Configuration()
+		.max_concurrency(4)
+		.memory_limit(1);
+	run_test<std::string, std::string>(5, 10, 1000, config);
+}
+
+TEST(ShuffleTask, SpillSomeFragments){
+	const auto config = m3bp::Configuration()
+		.max_concurrency(4)
+		.memory_limit(256 << 10);
+	run_test<int, std::string>(7, 40, 1000, config);
+}
+
+TEST(ShuffleTask, SpillEmptyFragments){
+	const auto config = m3bp::Configuration()
+		.max_concurrency(4)
+		.memory_limit(1);
+	run_test<int, int>(3, 5, 0, config);
+}
+
+TEST(ShuffleTask, PresortedFixedKey){
+	const auto config = m3bp::Configuration()
+		.max_concurrency(4)
+		.presort_shuffle_runs(true);
+	run_test<int, unsigned long long>(11, 7, 1000, config);
+}
+
+TEST(ShuffleTask, PresortedVarLenKey){
+	const auto config = m3bp::Configuration()
+		.max_concurrency(4)
+		.presort_shuffle_runs(true);
+	run_test<std::string, std::string>(24, 19, 1000, config);
+}
+
+TEST(ShuffleTask, PresortedAndSpilled){
+	const auto config = m3bp::Configuration()
+		.max_concurrency(4)
+		.presort_shuffle_runs(true)
+		.memory_limit(256 << 10);
+	run_test<std::string, int>(7, 40, 1000, config);
+}
+
+TEST(ShuffleTask, CombinedFixedKey){
+	run_combined_test<int>(11, 7, 1000, 50);
+}
+
+TEST(ShuffleTask, CombinedVarLenKey){
+	run_combined_test<std::string>(16, 10, 1000, 300);
+}
+
+TEST(ShuffleTask, CombinedGrowingValues){
+	run_concatenated_test(3, 20000, 5);
+}
+
+TEST(ShuffleTask, RangeFixedKey){
+	run_range_test<int, int>(8, 10, 1000);
+}
+
+TEST(ShuffleTask, RangeVarLenKey){
+	run_range_test<std::string, std::string>(13, 7, 1000);
+}
+
+TEST(ShuffleTask, RangeEmptyFragment){
+	run_range_test<int, int>(4, 1, 0);
+}
+
+TEST(ShuffleTask, HashGroupedFixedKey){
+	run_hash_grouped_test<int, unsigned long long>(11, 7, 1000, 300);
+}
+
+TEST(ShuffleTask, HashGroupedVarLenKey){
+	run_hash_grouped_test<std::string, std::string>(16, 10, 1000, 2000);
+}
+
+TEST(ShuffleTask, HashGroupedAndSpilled){
+	const auto config = m3bp::Configuration()
+		.max_concurrency(4)
+		.memory_limit(256 << 10);
+	run_hash_grouped_test<std::string, int>(7, 40, 1000, 500, config);
+}
+
+TEST(ShuffleTask, PaddedKey){
+	run_padded_key_test(m3bp::Grouping::SORT);
+}
+
+TEST(ShuffleTask, HashGroupedPaddedKey){
+	run_padded_key_test(m3bp::Grouping::HASH);
+}
+
+TEST(ShuffleTask, InPlaceSortFixedKey){
+	const auto config = m3bp::Configuration()
+		.max_concurrency(4)
+		.in_place_shuffle_sort(true);
+	run_test<int, unsigned long long>(11, 7, 1000, config);
+}
+
+TEST(ShuffleTask, WideDigitSort){
+	const auto config = m3bp::Configuration()
+		.max_concurrency(4)
+		.wide_radix_sort_digits(true);
+	run_test<unsigned long long, int>(1, 2, 50000, config);
+}
+
+TEST(ShuffleTask, InPlaceSortVarLenKey){
+	const auto config = m3bp::Configuration()
+		.max_concurrency(4)
+		.in_place_shuffle_sort(true);
+	run_test<std::string, std::string>(3, 10, 1000, config, 100);
+}
+
+TEST(ShuffleTask, ManySmallFragments){
+	run_test<std::string, int>(13, 500, 10);
+}
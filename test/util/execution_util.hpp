@@ -29,10 +29,10 @@
 namespace util {
 
 static void execute_logical_graph(
-	m3bp::LogicalGraph &graph, int concurrency = 4)
+	m3bp::LogicalGraph &graph, const m3bp::Configuration &config)
 {
-	m3bp::ExecutionContext context(
-		m3bp::Configuration().max_concurrency(concurrency));
+	const int concurrency = config.max_concurrency();
+	m3bp::ExecutionContext context(config);
 	auto &scheduler = context.scheduler();
 	auto &memory_manager = context.memory_manager();
 
@@ -58,6 +58,13 @@ static void execute_logical_graph(
 	memory_manager.log_memory_leaks();
 }
 
+static void execute_logical_graph(
+	m3bp::LogicalGraph &graph, int concurrency = 4)
+{
+	execute_logical_graph(
+		graph, m3bp::Configuration().max_concurrency(concurrency));
+}
+
 }
 
 #endif
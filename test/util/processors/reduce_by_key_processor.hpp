@@ -32,12 +32,31 @@ namespace processors {
 template <typename KeyType, typename ValueType>
 class TestReduceByKeyProcessor : public TestProcessorBase {
 
+private:
+	static m3bp::size_type combine_values(
+		void *dst,
+		const void *lhs, m3bp::size_type,
+		const void *rhs, m3bp::size_type)
+	{
+		const auto x = read_binary<ValueType>(lhs).first;
+		const auto y = read_binary<ValueType>(rhs).first;
+		const ValueType z = x + y;
+		write_binary(dst, z);
+		return binary_length(z);
+	}
+
 public:
-	TestReduceByKeyProcessor()
+	explicit TestReduceByKeyProcessor(
+		bool use_combiner = false,
+		m3bp::Grouping grouping = m3bp::Grouping::SORT)
 		: TestProcessorBase(
 			{
 				m3bp::InputPort("input0")
 					.movement(m3bp::Movement::SCATTER_GATHER)
+					.value_combiner(use_combiner
+						? m3bp::InputPort::ValueCombinerType(combine_values)
+						: m3bp::InputPort::ValueCombinerType())
+					.grouping(grouping)
 			},
 			{
 				m3bp::OutputPort("output0")